@@ -30,6 +30,7 @@
 
 #include "GuardZone.h"
 #include "RadarMarpa.h"
+#include "core/SpokeKernels.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -47,35 +48,56 @@ GuardZone::GuardZone(radar_pi* pi, RadarInfo* ri, int zone) {
   m_arpa_on = 0;
   m_alarm_on = 0;
   m_show_time = 0;
-  CLEAR_STRUCT(arpa_update_time);
+  m_scanned_blobs = 0;
+  m_spokes_pixels_per_meter = 0.;
+  m_range_start = 0;
+  m_range_end = 0;
   ResetBogeys();
 }
 
-void GuardZone::ProcessSpoke(SpokeBearing angle, uint8_t* data, uint8_t* hist, size_t len) {
-  size_t range_start = m_inner_range * m_ri->m_pixels_per_meter;  // Convert from meters to [0..spoke_len_max>
-  size_t range_end = m_outer_range * m_ri->m_pixels_per_meter;    // Convert from meters to [0..spoke_len_max>
+void GuardZone::UpdateSpokes() {
+  m_spokes_pixels_per_meter = m_ri->m_pixels_per_meter;
+  m_range_start = m_inner_range * m_spokes_pixels_per_meter;  // Convert from meters to [0..spoke_len_max>
+  m_range_end = m_outer_range * m_spokes_pixels_per_meter;    // Convert from meters to [0..spoke_len_max>
+
+  m_in_arc.assign((m_ri->m_spokes + 63) / 64, 0);
+  for (size_t angle = 0; angle < m_ri->m_spokes; angle++) {
+    AngleDegrees degAngle = SCALE_SPOKES_TO_DEGREES(angle);
+
+    if ((degAngle >= m_start_bearing && degAngle < m_end_bearing) ||
+        (m_start_bearing >= m_end_bearing && (degAngle >= m_start_bearing || degAngle < m_end_bearing))) {
+      m_in_arc[angle >> 6] |= (uint64_t)1 << (angle & 63);
+    }
+  }
+  m_spokes_valid = true;
+}
+
+void GuardZone::ProcessSpoke(SpokeBearing angle, uint8_t* data, const uint64_t* above_blue, const uint32_t* counts, size_t len) {
+  if (!m_spokes_valid || m_spokes_pixels_per_meter != m_ri->m_pixels_per_meter || m_in_arc.size() * 64 < m_ri->m_spokes) {
+    UpdateSpokes();
+  }
+
+  size_t range_start = m_range_start;
+  size_t range_end = m_range_end;
   bool in_guard_zone = false;
-  AngleDegrees degAngle = SCALE_SPOKES_TO_DEGREES(angle);
+  SpokeBearing spoke = MOD_SPOKES(angle);
 
   switch (m_type) {
     case GZ_ARC:
-      if ((degAngle >= m_start_bearing && degAngle < m_end_bearing) ||
-          (m_start_bearing >= m_end_bearing && (degAngle >= m_start_bearing || degAngle < m_end_bearing))) {
+      if ((m_in_arc[spoke >> 6] >> (spoke & 63)) & 1) {
         if (range_start < len) {
-          if (range_end > len) {
-            range_end = len;
+          if (range_end >= len) {
+            range_end = len - 1;
           }
-          for (size_t r = range_start; r <= range_end; r++) {
-            if (data[r] >= m_pi->m_settings.threshold_blue) {
-              m_running_count++;
-            }
+          m_running_count += SpokeBitsCountPrefix(counts, above_blue, range_start, range_end);
 #ifdef TEST_GUARD_ZONE_LOCATION
-            // Zap guard zone computation location to green so this is visible on screen
-            else {
+          // Zap guard zone computation location to green so this is visible on screen
+          for (size_t r = range_start; r <= range_end; r++) {
+            if (data[r] < m_pi->m_settings.threshold_blue) {
               data[r] = m_pi->m_settings.threshold_green;
             }
-#endif
           }
+#endif
         }
         in_guard_zone = true;
       }
@@ -83,21 +105,19 @@ void GuardZone::ProcessSpoke(SpokeBearing angle, uint8_t* data, uint8_t* hist, s
 
     case GZ_CIRCLE:
       if (range_start < len) {
-        if (range_end > len) {
-          range_end = len;
+        if (range_end >= len) {
+          range_end = len - 1;
         }
 
-        for (size_t r = range_start; r <= range_end; r++) {
-          if (data[r] >= m_pi->m_settings.threshold_blue) {
-            m_running_count++;
-          }
+        m_running_count += SpokeBitsCountPrefix(counts, above_blue, range_start, range_end);
 #ifdef TEST_GUARD_ZONE_LOCATION
-          // Zap guard zone computation location to green so this is visible on screen
-          else {
+        // Zap guard zone computation location to green so this is visible on screen
+        for (size_t r = range_start; r <= range_end; r++) {
+          if (data[r] < m_pi->m_settings.threshold_blue) {
             data[r] = m_pi->m_settings.threshold_green;
           }
-#endif
         }
+#endif
         if (angle > m_last_angle) {
           in_guard_zone = true;
         }
@@ -123,6 +143,7 @@ void GuardZone::ProcessSpoke(SpokeBearing angle, uint8_t* data, uint8_t* hist, s
       m_end_bearing += m_pi->m_settings.guard_zone_debug_inc;
       m_start_bearing %= DEGREES_PER_ROTATION;
       m_end_bearing %= DEGREES_PER_ROTATION;
+      m_spokes_valid = false;
     }
   }
 
@@ -179,35 +200,52 @@ void GuardZone::SearchTargets() {
     }
     if (range_end < range_start) return;
 
-    // loop with +2 increments as target must be larger than 2 pixels in width
-    for (int angleIter = start_bearing; angleIter < end_bearing; angleIter += 2) {
-      SpokeBearing angle = MOD_SPOKES(angleIter);
-      wxLongLong time1 = m_ri->m_history[angle].time;
-      // time2 must be timed later than the pass 2 in refresh, otherwise target may be found multiple times
-      wxLongLong time2 = m_ri->m_history[MOD_SPOKES(angle + 3 * SCAN_MARGIN)].time;
-
-      // check if target has been refreshed since last time
-      // and if the beam has passed the target location with SCAN_MARGIN spokes
-      if ((time1 > (arpa_update_time[angle] + SCAN_MARGIN2) && time2 >= time1)) {  // the beam sould have passed our "angle" AND a
-                                                                                   // point SCANMARGIN further set new refresh time
-        arpa_update_time[angle] = time1;
-        for (int rrr = (int)range_start; rrr < (int)range_end; rrr++) {
-          if (m_ri->m_arpa->GetTargetCount() >= MAX_NUMBER_OF_TARGETS - 1) {
-            LOG_INFO(wxT("radar_pi: No more scanning for ARPA targets in loop, maximum number of targets reached"));
-            return;
-          }
-          if (m_ri->m_arpa->MultiPix(angle, rrr)) {
-            bool next_r = false;
-            if (next_r) continue;
-            // pixel found that does not belong to a known target
-            Polar pol;
-            pol.angle = angle;
-            pol.r = rrr;
-            int target_i = m_ri->m_arpa->AcquireNewARPATarget(pol, 0);
-            if (target_i == -1) break;
-          }
+    // Look at the blobs completed since the last search, once the beam has passed them by
+    // 3 * SCAN_MARGIN spokes, so that the refresh of the known targets has cleared theirs.
+    std::vector<Polar> seeds;
+    {
+      wxCriticalSectionLocker lock(m_ri->m_exclusive);
+      HistoryBlobs *blobs = m_ri->m_blobs;
+      uint32_t swept = blobs->GetSweptSpokes();
+      uint32_t n = m_scanned_blobs;
+
+      if (n - blobs->GetBegin() > blobs->GetEnd() - blobs->GetBegin()) {
+        n = blobs->GetBegin();  // Blobs were cleared, or overwritten after a long pause
+      }
+      for (; n != blobs->GetEnd(); n++) {
+        const HistoryBlob &blob = blobs->Get(n);
+        if (swept - blob.swept < 3 * SCAN_MARGIN) {
+          break;
+        }
+        int offset = MOD_SPOKES(blob.angle_min - start_bearing);
+        if ((offset >= end_bearing - start_bearing && offset + blob.angle_max - blob.angle_min < (int)m_ri->m_spokes) ||
+            blob.r_max < (int)range_start || blob.r_min >= (int)range_end) {
+          continue;  // not in the zone
         }
+        // skip the blob when the next sweep has overwritten it, or a known target has taken it
+        if (m_ri->m_history->Time(blob.seed_angle) != blob.time ||
+            !m_ri->m_history->Test(HISTORY_TARGET, blob.seed_angle, blob.seed_r)) {
+          continue;
+        }
+        Polar pol;
+        pol.angle = blob.seed_angle;
+        pol.r = blob.seed_r;
+        seeds.push_back(pol);
+      }
+      m_scanned_blobs = n;
+    }
+
+    for (size_t i = 0; i < seeds.size(); i++) {
+      if (m_ri->m_arpa->GetTargetCount() >= MAX_NUMBER_OF_TARGETS - 1) {
+        LOG_INFO(wxT("radar_pi: No more scanning for ARPA targets in loop, maximum number of targets reached"));
+        return;
+      }
+      // a target acquired from an earlier seed may have taken this blob as well
+      if (!m_ri->m_history->Test(HISTORY_TARGET, seeds[i].angle, seeds[i].r)) {
+        continue;
       }
+      int target_i = m_ri->m_arpa->AcquireNewARPATarget(seeds[i], 0);
+      if (target_i == -1) break;
     }
   }
   return;
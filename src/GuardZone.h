@@ -46,9 +46,9 @@ class GuardZone {
   int m_alarm_on;
   int m_arpa_on;
   time_t m_show_time;
-  wxLongLong arpa_update_time[SPOKES_MAX];
 
   void ResetBogeys() {
+    m_spokes_valid = false;
     m_bogey_count = -1;
     m_running_count = 0;
     m_last_in_guard_zone = false;
@@ -87,11 +87,13 @@ class GuardZone {
   };
 
   /*
-   * Check if data is in this GuardZone, if so update bogeyCount
+   * Check if data is in this GuardZone, if so update bogeyCount from 'above_blue',
+   * the cells of the spoke at or above threshold_blue (see SpokeHistory::GuardRow()),
+   * and 'counts', see SpokeHistory::CountGuardRow().
    */
-  void ProcessSpoke(SpokeBearing angle, uint8_t *data, uint8_t *hist, size_t len);
+  void ProcessSpoke(SpokeBearing angle, uint8_t *data, const uint64_t *above_blue, const uint32_t *counts, size_t len);
 
-  // Find targets inside the zone
+  // Find targets inside the zone, in the blobs that were completed since the last search
   void SearchTargets();
 
   int GetBogeyCount() {
@@ -112,9 +114,19 @@ class GuardZone {
   wxString m_log_name;
   bool m_last_in_guard_zone;
   SpokeBearing m_last_angle;
-  int m_bogey_count;    // complete cycle
-  int m_running_count;  // current swipe
-
+  int m_bogey_count;          // complete cycle
+  int m_running_count;        // current swipe
+  uint32_t m_scanned_blobs;   // m_ri->m_blobs->GetEnd() at the last SearchTargets()
+
+  // Which spokes and cells are in the zone, recomputed by UpdateSpokes() when the zone or the
+  // range changes instead of for every spoke
+  bool m_spokes_valid;
+  double m_spokes_pixels_per_meter;  // m_ri->m_pixels_per_meter that the ranges were computed for
+  size_t m_range_start;              // first cell in the zone
+  size_t m_range_end;                // last cell in the zone
+  std::vector<uint64_t> m_in_arc;    // bit per spoke, set when the spoke is within the bearings
+
+  void UpdateSpokes();
   void UpdateSettings();
 };
 
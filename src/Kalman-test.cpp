@@ -29,10 +29,133 @@
  ***************************************************************************
  */
 
-#include "Kalman.h"
+#include <math.h>
+#include <string.h>
+#include "core/Kalman.h"
+
+using namespace std;
 
 PLUGIN_BEGIN_NAMESPACE
 
+// A value in [-range, range>, now and then exactly 0 or -0
+static double RandomValue(double range) {
+  int choice = rand() % 16;
+  if (choice == 0) return 0.;
+  if (choice == 1) return -0.;
+  return (rand() / (double)RAND_MAX * 2. - 1.) * range;
+}
+
+static bool SameBits(double a, double b) { return memcmp(&a, &b, sizeof(double)) == 0; }
+
+// Check that the unrolled operator*() gives bit for bit what the loop in MatrixProduct() gives
+template <int N, int M, int P>
+static bool CheckProduct() {
+  for (int round = 0; round < 1000; round++) {
+    Matrix<double, N, M> a;
+    Matrix<double, M, P> b;
+    for (int e = 0; e < N * M; e++) a.flatten[e] = RandomValue(1000.);
+    for (int e = 0; e < M * P; e++) b.flatten[e] = RandomValue(1000.);
+
+    Matrix<double, N, P> fast = a * b;
+    Matrix<double, N, P> generic = MatrixProduct(a, b);
+    for (int e = 0; e < N * P; e++) {
+      if (!SameBits(fast.flatten[e], generic.flatten[e])) {
+        cout << "ERROR: " << N << "x" << M << " * " << M << "x" << P << " product element " << e << " is " << fast.flatten[e]
+             << " instead of " << generic.flatten[e] << "\n";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+#define BATCH_FILTERS (8)
+
+static bool SameState(KalmanFilter *filter, KalmanBatch &batch, int f, const LocalPosition &x, const LocalPosition &y) {
+  for (int r = 0; r < 4; r++) {
+    for (int c = 0; c < 4; c++) {
+      if (!SameBits(filter->P(r, c), batch.P(f, r, c))) {
+        cout << "ERROR: P(" << r << "," << c << ") of batch filter " << f << " is " << batch.P(f, r, c) << " instead of "
+             << filter->P(r, c) << "\n";
+        return false;
+      }
+    }
+  }
+  if (!SameBits(x.pos.lat, y.pos.lat) || !SameBits(x.pos.lon, y.pos.lon) || !SameBits(x.dlat_dt, y.dlat_dt) ||
+      !SameBits(x.dlon_dt, y.dlon_dt) || !SameBits(x.sd_speed_m_s, y.sd_speed_m_s)) {
+    cout << "ERROR: position of batch filter " << f << " is lat=" << y.pos.lat << " lon=" << y.pos.lon << " instead of lat="
+         << x.pos.lat << " lon=" << x.pos.lon << "\n";
+    return false;
+  }
+  return true;
+}
+
+// Check that KalmanBatch follows KalmanFilter bit for bit, doing the steps in the order the
+// ARPA targets do them: all filters predict at once, then each one updates on its own.
+static bool CheckBatch() {
+  KalmanFilter *filters[BATCH_FILTERS];
+  KalmanBatch batch(2048);
+  LocalPosition x[BATCH_FILTERS], y[BATCH_FILTERS];
+  int index[BATCH_FILTERS];
+  double delta_t[BATCH_FILTERS];
+
+  batch.Resize(BATCH_FILTERS);
+  for (int f = 0; f < BATCH_FILTERS; f++) {
+    filters[f] = new KalmanFilter(2048);
+    index[f] = f;
+  }
+  bool ok = true;
+  for (int step = 0; step < 2000 && ok; step++) {
+    for (int f = 0; f < BATCH_FILTERS; f++) {
+      x[f].pos.lat = RandomValue(5000.);
+      x[f].pos.lon = RandomValue(5000.);
+      x[f].dlat_dt = RandomValue(10.);
+      x[f].dlon_dt = RandomValue(10.);
+      x[f].sd_speed_m_s = 0.;
+      y[f] = x[f];
+      delta_t[f] = rand() % 8 == 0 ? 0. : rand() / (double)RAND_MAX * 5.;
+      filters[f]->Predict(&x[f], delta_t[f]);
+    }
+    batch.Predict(BATCH_FILTERS, index, y, delta_t);
+    for (int f = 0; f < BATCH_FILTERS && ok; f++) {
+      ok = SameState(filters[f], batch, f, x[f], y[f]);
+      switch (rand() % 8) {
+        case 0:
+          filters[f]->ResetFilter();
+          batch.ResetFilter(f);
+          break;
+        case 1:
+        case 2:
+          filters[f]->Update_P();
+          batch.Update_P(1, &f);
+          break;
+        default: {
+          Polar pol, expected;
+          pol.angle = rand() % 2048;
+          pol.r = rand() % 1024;
+          pol.time = 0;
+          expected.angle = (pol.angle + rand() % 21 - 10 + 2048) % 2048;
+          expected.r = pol.r + rand() % 21 - 10;
+          expected.time = 0;
+          if (x[f].pos.lat == 0. && x[f].pos.lon == 0.) {
+            break;  // no bearing to the target
+          }
+          filters[f]->Update_P();
+          batch.Update_P(1, &f);
+          filters[f]->SetMeasurement(&pol, &x[f], &expected, 512. / 4000.);
+          batch.SetMeasurement(1, &f, &pol, &y[f], &expected, 512. / 4000.);
+          break;
+        }
+      }
+      ok = ok && SameState(filters[f], batch, f, x[f], y[f]);
+    }
+  }
+  for (int f = 0; f < BATCH_FILTERS; f++) {
+    delete filters[f];
+  }
+  return ok;
+}
+
 int main() {
   int ret = 0;
   KalmanFilter *filter = new KalmanFilter(2048);
@@ -85,7 +208,7 @@ int main() {
   expected.time = 6000;
 
   filter->SetMeasurement(&pol, &x_local, &expected, 512. / 4000.);        // pol is measured position in polar coordinates
-  filter->Predict(&x_local, (expected.time - pol.time).GetLo() / 1000.);  // x_local is new estimated local position of the target
+  filter->Predict(&x_local, (double)(expected.time - pol.time) / 1000.);  // x_local is new estimated local position of the target
 
   cout << "INFO: The predicted location is: lat=" << x_local.pos.lat << " lon=" << x_local.pos.lon << "\n";
   cout << "INFO: Delta lat=" << x_local.dlat_dt << " Delta lon=" << x_local.dlon_dt << "\n";
@@ -101,6 +224,19 @@ int main() {
   ASSERT_VALUE("lon", x_local.pos.lon, 5);
   ASSERT_VALUE("stddev", x_local.sd_speed_m_s, 2.03224);
 
+  srand(1);
+  if (!CheckProduct<2, 2, 2>() || !CheckProduct<2, 2, 1>() || !CheckProduct<2, 4, 2>() || !CheckProduct<2, 4, 4>() ||
+      !CheckProduct<4, 2, 1>() || !CheckProduct<4, 2, 2>() || !CheckProduct<4, 2, 4>() || !CheckProduct<4, 4, 1>() ||
+      !CheckProduct<4, 4, 2>() || !CheckProduct<4, 4, 4>()) {
+    cout << "ERROR: unrolled matrix product differs from the generic one\n";
+    ret = 1;
+  }
+
+  if (!CheckBatch()) {
+    cout << "ERROR: KalmanBatch differs from KalmanFilter\n";
+    ret = 1;
+  }
+
   if (ret == 0) {
     cout << "INFO: TEST PASSED\n";
   } else {
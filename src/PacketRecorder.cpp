@@ -0,0 +1,208 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "PacketRecorder.h"
+#include <wx/datetime.h>
+#include <wx/filename.h>
+#include "RadarInfo.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+PacketRecorder *PacketRecorder::Create(radar_pi *pi, RadarInfo *ri) {
+  wxString dir = pi->m_settings.record_directory;
+
+  if (dir.IsEmpty() || ri->m_radar_type == RT_EMULATOR || ri->m_replay) {
+    // The emulator does not receive any packets and a replay is already a recording, nothing to record
+    return 0;
+  }
+  if (!wxDirExists(dir) && !wxMkdir(dir)) {
+    wxLogError(wxT("radar_pi: %s cannot create recording directory %s"), ri->m_name.c_str(), dir.c_str());
+    return 0;
+  }
+
+  wxFileName filename(dir, wxString::Format(wxT("radar%d-%s"), (int)ri->m_radar,
+                                            wxDateTime::Now().Format(wxT("%Y%m%d-%H%M%S")).c_str()),
+                      RECORD_FILE_EXTENSION);
+
+  PacketRecorder *recorder = new PacketRecorder(ri);
+  if (!recorder->Open(filename.GetFullPath())) {
+    delete recorder;
+    return 0;
+  }
+  return recorder;
+}
+
+PacketRecorder::PacketRecorder(RadarInfo *ri) {
+  m_ri = ri;
+  m_chunk = (uint8_t *)malloc(RECORD_CHUNK_SIZE);
+  if (!m_chunk) {
+    wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
+    wxAbort();
+  }
+  m_chunk_len = sizeof(RecordChunkHeader);
+  m_chunk_packets = 0;
+  m_chunk_sequence = 0;
+  m_chunk_first_time = 0;
+  m_chunk_last_time = 0;
+  m_index_entries = 0;
+  m_previous_index = -1;
+  m_dropped = 0;
+}
+
+PacketRecorder::~PacketRecorder() {
+  if (m_file.IsOpened()) {
+    if (m_chunk_packets > 0) {
+      WriteChunk();
+    }
+    // Always write a final index, even an empty one, so the trailer has something to point at
+    WriteIndex();
+
+    RecordTrailer trailer;
+    trailer.magic = RECORD_TRAILER_MAGIC;
+    trailer.chunks = m_chunk_sequence;
+    trailer.index_offset = m_previous_index;
+    m_file.Write(&trailer, sizeof(trailer));
+    m_file.Close();
+
+    LOG_INFO(wxT("radar_pi: %s recorded %u chunks to %s, %u packets dropped"), m_ri->m_name.c_str(), m_chunk_sequence,
+             m_filename.c_str(), (unsigned)m_dropped);
+  }
+  free(m_chunk);
+}
+
+bool PacketRecorder::Open(const wxString &filename) {
+  RecordFileHeader header;
+
+  if (!m_file.Open(filename, wxT("wb"))) {
+    wxLogError(wxT("radar_pi: %s cannot open recording file %s"), m_ri->m_name.c_str(), filename.c_str());
+    return false;
+  }
+  m_filename = filename;
+
+  CLEAR_STRUCT(header);
+  memcpy(header.magic, RECORD_FILE_MAGIC, sizeof(header.magic));
+  header.version = RECORD_FILE_VERSION;
+  header.radar_type = m_ri->m_radar_type;
+  strncpy(header.radar_name, wxString(RadarTypeName[m_ri->m_radar_type]).mb_str(), sizeof(header.radar_name) - 1);
+  header.spokes = m_ri->m_spokes;
+  header.spoke_len_max = m_ri->m_spoke_len_max;
+  header.chunk_size = RECORD_CHUNK_SIZE;
+  header.start_time_us = wxGetUTCTimeUSec().GetValue();
+
+  if (m_file.Write(&header, sizeof(header)) != sizeof(header)) {
+    wxLogError(wxT("radar_pi: %s cannot write recording file %s"), m_ri->m_name.c_str(), filename.c_str());
+    m_file.Close();
+    return false;
+  }
+
+  LOG_INFO(wxT("radar_pi: %s recording received packets to %s"), m_ri->m_name.c_str(), filename.c_str());
+  return true;
+}
+
+/*
+ * Add one received datagram to the capture. Called from the receive thread.
+ */
+void PacketRecorder::Record(RecordSocketRole role, const uint8_t *data, size_t len) {
+  int64_t now = wxGetUTCTimeUSec().GetValue();
+  size_t needed = sizeof(RecordPacketHeader) + len;
+
+  if (!m_file.IsOpened() || len > UINT16_MAX || needed > RECORD_CHUNK_SIZE - sizeof(RecordChunkHeader)) {
+    m_dropped++;
+    return;
+  }
+  if (m_chunk_len + needed > RECORD_CHUNK_SIZE) {
+    WriteChunk();
+  }
+
+  RecordPacketHeader *header = (RecordPacketHeader *)(m_chunk + m_chunk_len);
+  header->time_us = now;
+  header->length = (uint16_t)len;
+  header->role = (uint8_t)role;
+  header->radar_type = (uint8_t)m_ri->m_radar_type;
+  memcpy(m_chunk + m_chunk_len + sizeof(RecordPacketHeader), data, len);
+  m_chunk_len += needed;
+
+  if (m_chunk_packets == 0) {
+    m_chunk_first_time = now;
+  }
+  m_chunk_last_time = now;
+  m_chunk_packets++;
+}
+
+void PacketRecorder::WriteChunk() {
+  RecordChunkHeader *header = (RecordChunkHeader *)m_chunk;
+
+  header->magic = RECORD_CHUNK_MAGIC;
+  header->length = (uint32_t)(m_chunk_len - sizeof(RecordChunkHeader));
+  header->packets = m_chunk_packets;
+  header->sequence = m_chunk_sequence;
+  header->first_time_us = m_chunk_first_time;
+  header->last_time_us = m_chunk_last_time;
+
+  m_index[m_index_entries].offset = m_file.Tell();
+  m_index[m_index_entries].first_time_us = m_chunk_first_time;
+
+  if (m_file.Write(m_chunk, m_chunk_len) != m_chunk_len) {
+    wxLogError(wxT("radar_pi: %s write error on recording file %s, recording stopped"), m_ri->m_name.c_str(), m_filename.c_str());
+    m_dropped += m_chunk_packets;
+    m_file.Close();
+  } else {
+    m_index_entries++;
+    m_chunk_sequence++;
+  }
+
+  m_chunk_len = sizeof(RecordChunkHeader);
+  m_chunk_packets = 0;
+
+  if (m_index_entries == RECORD_INDEX_INTERVAL) {
+    WriteIndex();
+  }
+}
+
+void PacketRecorder::WriteIndex() {
+  RecordIndexHeader header;
+
+  if (!m_file.IsOpened()) {
+    return;
+  }
+
+  header.magic = RECORD_INDEX_MAGIC;
+  header.entries = m_index_entries;
+  header.previous_offset = m_previous_index;
+
+  m_previous_index = m_file.Tell();
+  m_file.Write(&header, sizeof(header));
+  m_file.Write(m_index, m_index_entries * sizeof(RecordIndexEntry));
+  m_index_entries = 0;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,160 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _PACKET_RECORDER_H_
+#define _PACKET_RECORDER_H_
+
+#include <wx/ffile.h>
+#include "radar_pi.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Capture file format
+// -------------------
+//
+// A capture file contains the raw UDP datagrams received from one radar, as they were
+// seen by the receive thread. All integers are stored in host (little endian) order.
+//
+//   RecordFileHeader
+//   { RecordChunkHeader { RecordPacketHeader <packet data> }* }*
+//   { RecordIndexHeader RecordIndexEntry* }   -- after every RECORD_INDEX_INTERVAL chunks
+//   RecordIndexHeader RecordIndexEntry* RecordTrailer  -- written on a clean close
+//
+// Chunks are self-delimiting so a file that was not closed properly can still be read
+// sequentially. The index blocks link back to their predecessor, and the trailer points
+// at the last index block, so a reader can seek by time without scanning all chunks.
+//
+
+#define RECORD_FILE_MAGIC "RADARREC"
+#define RECORD_FILE_VERSION (1)
+#define RECORD_CHUNK_MAGIC (0x4b4e4843)    // "CHNK"
+#define RECORD_INDEX_MAGIC (0x58444e49)    // "INDX"
+#define RECORD_TRAILER_MAGIC (0x524c5254)  // "TRLR"
+#define RECORD_CHUNK_SIZE (1024 * 1024)    // Bytes per chunk, including the chunk header
+#define RECORD_INDEX_INTERVAL (64)         // Chunks per index block
+#define RECORD_FILE_EXTENSION wxT("rrec")
+
+enum RecordSocketRole { RECORD_DATA = 0, RECORD_REPORT = 1 };
+
+#pragma pack(push, 1)
+
+struct RecordFileHeader {
+  char magic[8];           // RECORD_FILE_MAGIC, not 0 terminated
+  uint32_t version;        // RECORD_FILE_VERSION
+  uint32_t radar_type;     // RadarType of the radar that was recorded
+  char radar_name[32];     // RadarTypeName, 0 terminated
+  uint32_t spokes;         // m_spokes at time of recording
+  uint32_t spoke_len_max;  // m_spoke_len_max at time of recording
+  uint32_t chunk_size;     // RECORD_CHUNK_SIZE at time of recording
+  int64_t start_time_us;   // UTC time in microseconds when the file was created
+};
+
+struct RecordChunkHeader {
+  uint32_t magic;         // RECORD_CHUNK_MAGIC
+  uint32_t length;        // Number of bytes of packet records following this header
+  uint32_t packets;       // Number of packet records in this chunk
+  uint32_t sequence;      // Chunk number, starting at 0
+  int64_t first_time_us;  // Receive time of the first packet in the chunk
+  int64_t last_time_us;   // Receive time of the last packet in the chunk
+};
+
+struct RecordPacketHeader {
+  int64_t time_us;     // UTC receive time in microseconds
+  uint16_t length;     // Number of bytes of packet data following this header
+  uint8_t role;        // RecordSocketRole
+  uint8_t radar_type;  // RadarType
+};
+
+struct RecordIndexEntry {
+  int64_t offset;         // File offset of the RecordChunkHeader
+  int64_t first_time_us;  // Copy of RecordChunkHeader::first_time_us
+};
+
+struct RecordIndexHeader {
+  uint32_t magic;           // RECORD_INDEX_MAGIC
+  uint32_t entries;         // Number of RecordIndexEntry following this header
+  int64_t previous_offset;  // File offset of the previous RecordIndexHeader, or -1
+};
+
+struct RecordTrailer {
+  uint32_t magic;        // RECORD_TRAILER_MAGIC
+  uint32_t chunks;       // Total number of chunks in the file
+  int64_t index_offset;  // File offset of the last RecordIndexHeader
+};
+
+#pragma pack(pop)
+
+//
+// Writes the datagrams received by one RadarReceive thread to a capture file.
+//
+// Record() is called from the receive thread only. Packets are copied into a
+// pre-allocated chunk buffer, and only full chunks are written to disk, so
+// recording does not allocate memory per packet and produces one sequential
+// write stream.
+//
+class PacketRecorder {
+ public:
+  // Returns a recorder if recording is enabled in the settings, otherwise 0.
+  static PacketRecorder *Create(radar_pi *pi, RadarInfo *ri);
+
+  ~PacketRecorder();
+
+  void Record(RecordSocketRole role, const uint8_t *data, size_t len);
+
+ private:
+  PacketRecorder(RadarInfo *ri);
+  bool Open(const wxString &filename);
+  void WriteChunk();
+  void WriteIndex();
+
+  RadarInfo *m_ri;
+  wxFFile m_file;
+  wxString m_filename;
+
+  uint8_t *m_chunk;    // RECORD_CHUNK_SIZE bytes, starts with a RecordChunkHeader
+  size_t m_chunk_len;  // Bytes used in m_chunk, including the header
+  uint32_t m_chunk_packets;
+  uint32_t m_chunk_sequence;
+  int64_t m_chunk_first_time;
+  int64_t m_chunk_last_time;
+
+  RecordIndexEntry m_index[RECORD_INDEX_INTERVAL];
+  uint32_t m_index_entries;
+  int64_t m_previous_index;
+
+  size_t m_dropped;  // Packets that could not be written
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _PACKET_RECORDER_H_ */
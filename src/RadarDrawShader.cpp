@@ -31,6 +31,7 @@
 
 #include "RadarDrawShader.h"
 #include "RadarInfo.h"
+#include "core/SpokeKernels.h"
 #include "drawutil.h"
 #include "shaderutil.h"
 
@@ -241,32 +242,22 @@ void RadarDrawShader::ProcessRadarSpoke(int transparency, SpokeBearing angle, ui
   }
 
   if (m_channels == SHADER_COLOR_CHANNELS) {
-    unsigned char *d = m_data + (angle * m_spoke_len_max) * m_channels;
-    for (size_t r = 0; r < len; r++) {
-      GLubyte strength = data[r];
-      BlobColour colour = m_ri->m_colour_map[strength];
-      d[0] = m_ri->m_colour_map_rgb[colour].Red();
-      d[1] = m_ri->m_colour_map_rgb[colour].Green();
-      d[2] = m_ri->m_colour_map_rgb[colour].Blue();
-      d[3] = colour != BLOB_NONE ? alpha : 0;
-      d += m_channels;
-    }
-    for (size_t r = len; r < m_spoke_len_max; r++) {
-      *d++ = 0;
-      *d++ = 0;
-      *d++ = 0;
-      *d++ = 0;
+    uint8_t rgba[UINT8_MAX + 1][4];
+    for (int strength = 0; strength <= UINT8_MAX; strength++) {
+      BlobColour colour = (BlobColour)m_ri->m_colour_map[strength];
+      rgba[strength][0] = m_ri->m_colour_map_rgb[colour].Red();
+      rgba[strength][1] = m_ri->m_colour_map_rgb[colour].Green();
+      rgba[strength][2] = m_ri->m_colour_map_rgb[colour].Blue();
+      rgba[strength][3] = colour != BLOB_NONE ? alpha : 0;
     }
+    SpokeToRGBA(m_data + (angle * m_spoke_len_max) * m_channels, m_spoke_len_max, data, len, rgba);
   } else {
-    unsigned char *d = m_data + (angle * m_spoke_len_max);
-    for (size_t r = 0; r < len; r++) {
-      GLubyte strength = data[r];
-      BlobColour colour = m_ri->m_colour_map[strength];
-      *d++ = (m_ri->m_colour_map_rgb[colour].Red() * alpha) >> 8;
-    }
-    for (size_t r = len; r < m_spoke_len_max; r++) {
-      *d++ = 0;
+    uint8_t luminance[UINT8_MAX + 1];
+    for (int strength = 0; strength <= UINT8_MAX; strength++) {
+      BlobColour colour = (BlobColour)m_ri->m_colour_map[strength];
+      luminance[strength] = (m_ri->m_colour_map_rgb[colour].Red() * alpha) >> 8;
     }
+    SpokeToLuminance(m_data + (angle * m_spoke_len_max), m_spoke_len_max, data, len, luminance);
   }
 }
 
@@ -119,13 +119,8 @@ void RadarDrawVertex::SetBlob(VertexLine* line, int angle_begin, int angle_end,
 
 void RadarDrawVertex::ProcessRadarSpoke(int transparency, SpokeBearing angle, uint8_t* data, size_t len, GeoPosition spoke_pos) {
   GLubyte alpha = 255 * (MAX_OVERLAY_TRANSPARENCY - transparency) / MAX_OVERLAY_TRANSPARENCY;
-  BlobColour previous_colour = BLOB_NONE;
-  GLubyte strength = 0;
   time_t now = time(0);
-  uint8_t red, green, blue;
   wxCriticalSectionLocker lock(m_exclusive);
-  int r_begin = 0;
-  int r_end = 0;
 
   if (angle < 0 || angle >= (int)m_spokes || len > m_spoke_len_max || !m_vertices) {
     return;
@@ -150,35 +145,10 @@ void RadarDrawVertex::ProcessRadarSpoke(int transparency, SpokeBearing angle, ui
   line->count = 0;
   line->timeout = now + m_ri->m_pi->m_settings.max_age;
   line->spoke_pos = spoke_pos;
-  for (size_t radius = 0; radius < len; radius++) {
-    strength = data[radius];
-    BlobColour actual_colour = m_ri->m_colour_map[strength];
-
-    if (actual_colour == previous_colour) {
-      // continue with same color, just register it
-      r_end++;
-    } else if (previous_colour == BLOB_NONE && actual_colour != BLOB_NONE) {
-      // blob starts, no display, just register
-      r_begin = radius;
-      r_end = r_begin + 1;
-      previous_colour = actual_colour;  // new color
-    } else if (previous_colour != BLOB_NONE && (previous_colour != actual_colour)) {
-      red = m_ri->m_colour_map_rgb[previous_colour].Red();
-      green = m_ri->m_colour_map_rgb[previous_colour].Green();
-      blue = m_ri->m_colour_map_rgb[previous_colour].Blue();
-      SetBlob(line, angle, angle + 1, r_begin, r_end, red, green, blue, alpha);
-      previous_colour = actual_colour;
-      if (actual_colour != BLOB_NONE) {  // change of color, start new blob
-        r_begin = radius;
-        r_end = r_begin + 1;
-      }
-    }
-  }
-  if (previous_colour != BLOB_NONE) {  // Draw final blob
-    red = m_ri->m_colour_map_rgb[previous_colour].Red();
-    green = m_ri->m_colour_map_rgb[previous_colour].Green();
-    blue = m_ri->m_colour_map_rgb[previous_colour].Blue();
-    SetBlob(line, angle, angle + 1, r_begin, r_end, red, green, blue, alpha);
+  size_t blobs = SpokeToBlobs(m_blobs, data, len, m_ri->m_colour_map);
+  for (size_t b = 0; b < blobs; b++) {
+    PixelColour &colour = m_ri->m_colour_map_rgb[m_blobs[b].colour];
+    SetBlob(line, angle, angle + 1, m_blobs[b].r_begin, m_blobs[b].r_end, colour.Red(), colour.Green(), colour.Blue(), alpha);
   }
 }
 
@@ -33,6 +33,7 @@
 #define _RADARDRAWVERTEX_H_
 
 #include "RadarDraw.h"
+#include "core/SpokeKernels.h"
 #include "drawutil.h"
 
 PLUGIN_BEGIN_NAMESPACE
@@ -94,6 +95,7 @@ class RadarDrawVertex : public RadarDraw {
   void Reset();
   wxCriticalSection m_exclusive;  // protects the following
   VertexLine* m_vertices;
+  SpokeBlob m_blobs[MAX_BLOBS_PER_LINE];
   unsigned int m_count;
   bool m_oom;
 };
@@ -39,8 +39,13 @@
 #include "RadarMarpa.h"
 #include "RadarPanel.h"
 #include "RadarReceive.h"
+#include "SpokeQueue.h"
 #include "TrailBuffer.h"
+#include "WorkerThread.h"
+#include "core/SpokeDecode.h"
+#include "core/SpokeKernels.h"
 #include "drawutil.h"
+#include "replay/ReplayReceive.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -61,8 +66,6 @@ RadarInfo::RadarInfo(radar_pi *pi, int radar) {
   m_timed_idle.Update(1, RCS_OFF);
   m_course_index = 0;
   m_old_range = 0;
-  m_dir_lat = 0;
-  m_dir_lon = 0;
   m_pixels_per_meter = 0.;
   m_previous_auto_range_meters = 0;
   m_previous_orientation = ORIENTATION_HEAD_UP;
@@ -70,8 +73,10 @@ RadarInfo::RadarInfo(radar_pi *pi, int radar) {
   m_radar_timeout = 0;
   m_data_timeout = 0;
   m_history = 0;
+  m_blobs = 0;
   m_polar_lookup = 0;
   m_spokes = 0;
+  m_full_resolution = false;
   m_spoke_len_max = 0;
   m_trails = 0;
   m_idle_standby = 0;
@@ -79,7 +84,6 @@ RadarInfo::RadarInfo(radar_pi *pi, int radar) {
   m_showManualValueInAuto = false;
   m_timed_idle_hardware = false;
   m_status_text_hide = false;
-  CLEAR_STRUCT(m_statistics);
   CLEAR_STRUCT(m_course_log);
 
   m_mouse_pos.lat = NAN;
@@ -94,6 +98,11 @@ RadarInfo::RadarInfo(radar_pi *pi, int radar) {
   }
   m_control = 0;
   m_receive = 0;
+  m_receive_attached = false;
+  m_replay = false;
+  m_spoke_queue = 0;
+  m_spoke_process = 0;
+  m_trail_zoom = new TrailZoomTask;
   m_draw_panel.draw = 0;
   m_draw_overlay.draw = 0;
   m_draw_time_ms = 1000;  // Assume really bad draw time until we actually measure it to prevent fast redraw at start
@@ -119,8 +128,13 @@ RadarInfo::RadarInfo(radar_pi *pi, int radar) {
 void RadarInfo::Shutdown() {
   if (m_receive) {
     wxLongLong threadStartWait = wxGetUTCTimeMillis();
-    m_receive->Shutdown();
-    m_receive->Wait();
+    if (m_receive_attached) {
+      m_receive->Detach();
+      m_receive_attached = false;
+    } else {
+      m_receive->Shutdown();
+      m_receive->Wait();
+    }
     wxLongLong threadEndWait = wxGetUTCTimeMillis();
 
 #ifdef NEVER
@@ -156,6 +170,20 @@ void RadarInfo::Shutdown() {
     m_receive = 0;
   }
 
+  // Only stop processing once nothing can be added to the spoke queue anymore
+  if (m_spoke_process) {
+    m_spoke_process->Shutdown();
+    m_spoke_process->Wait();
+    delete m_spoke_process;
+    m_spoke_process = 0;
+  }
+  for (size_t i = 0; i < m_trail_zoom_threads.size(); i++) {
+    m_trail_zoom_threads[i]->Shutdown();
+    m_trail_zoom_threads[i]->Wait();
+    delete m_trail_zoom_threads[i];
+  }
+  m_trail_zoom_threads.clear();
+
   if (m_control_dialog) {
     delete m_control_dialog;
     m_control_dialog = 0;
@@ -197,6 +225,8 @@ RadarInfo::~RadarInfo() {
     delete m_trails;
     m_trails = 0;
   }
+  delete m_trail_zoom;
+  m_trail_zoom = 0;
   for (size_t z = 0; z < GUARD_ZONES; z++) {
     if (m_guard_zone[z]) {
       delete m_guard_zone[z];
@@ -205,12 +235,20 @@ RadarInfo::~RadarInfo() {
   }
 
   if (m_history) {
-    for (size_t i = 0; i < m_spokes; i++) {
-      if (m_history[i].line) {
-        free(m_history[i].line);
-      }
-    }
-    free(m_history);
+    delete m_history;
+    m_history = 0;
+  }
+  if (m_blobs) {
+    delete m_blobs;
+    m_blobs = 0;
+  }
+  if (m_spoke_queue) {
+    delete m_spoke_queue;
+    m_spoke_queue = 0;
+  }
+  if (m_polar_lookup) {
+    m_polar_lookup->Release();
+    m_polar_lookup = 0;
   }
 }
 
@@ -223,15 +261,50 @@ RadarInfo::~RadarInfo() {
  */
 bool RadarInfo::Init() {
   m_verbose = M_SETTINGS.verbose;
+  if (m_radar_type == RT_REPLAY) {
+    // Take on the identity of the radar that was recorded, so that its spoke geometry,
+    // ranges and decoder are used unchanged. ReplayReceive feeds that decoder.
+    RadarType recorded = ReplayReceive::GetRecordedRadarType(M_SETTINGS.replay_file);
+    if (recorded != RT_MAX) {
+      m_radar_type = recorded;
+      m_replay = true;
+    }
+  }
   m_name = RadarTypeName[m_radar_type];
   m_spokes = RadarSpokes[m_radar_type];
   m_spoke_len_max = RadarSpokeLenMax[m_radar_type];
+  switch (m_radar_type) {
+    case RT_BR24:
+    case RT_3G:
+    case RT_4GA:
+    case RT_4GB:
+    case RT_HaloA:
+    case RT_HaloB:
+      if (m_full_resolution) {
+        m_spokes = NAVICO_SPOKES_FULL;
+        LOG_INFO(wxT("radar_pi: %s using full resolution, %u spokes per rotation"), m_name.c_str(), (unsigned)m_spokes);
+      }
+      break;
+
+    default:
+      break;
+  }
 
-  m_history = (line_history *)calloc(sizeof(line_history), m_spokes);
-  for (size_t i = 0; i < m_spokes; i++) {
-    m_history[i].line = (uint8_t *)calloc(sizeof(uint8_t), m_spoke_len_max);
+  SpokeDecodeInit();  // Also selects the vector code for the threshold pass in ProcessRadarSpoke
+  // Init() runs again after the radars are reselected, while the threads of this radar use the
+  // history and its blobs, so keep them. A radar of another type gets a new RadarInfo, so the size
+  // stays the same.
+  if (!m_history) {
+    m_history = new SpokeHistory(m_spokes, m_spoke_len_max);
+  }
+  if (!m_blobs) {
+    m_blobs = new HistoryBlobs(m_spokes, m_spoke_len_max);
+  }
+  PolarToCartesianLookup *previous_lookup = m_polar_lookup;
+  m_polar_lookup = PolarToCartesianLookup::Acquire(m_spokes, m_spoke_len_max);
+  if (previous_lookup) {
+    previous_lookup->Release();
   }
-  m_polar_lookup = new PolarToCartesianLookup(m_spokes, m_spoke_len_max);
 
   ComputeColourMap();
 
@@ -266,10 +339,36 @@ bool RadarInfo::Init() {
 
   UpdateControlState(true);
 
+  if (!m_spoke_queue) {
+    // Buffer up to one revolution of spokes between the receive thread and the process thread
+    m_spoke_queue = new SpokeQueue(m_spokes, m_spoke_len_max);
+  }
+  if (m_trail_zoom_threads.empty()) {
+    int helpers = wxMin(wxThread::GetCPUCount(), TRAIL_ZOOM_THREADS) - 1;
+    for (int i = 0; i < helpers; i++) {
+      WorkerThread *helper = new WorkerThread(m_name + wxT(" trail zoom"), m_trail_zoom, &m_trail_zoom_done);
+      if (helper->Run() != wxTHREAD_NO_ERROR) {
+        delete helper;
+        break;
+      }
+      m_trail_zoom_threads.push_back(helper);
+    }
+  }
+  if (!m_spoke_process) {
+    m_spoke_process = new SpokeProcessThread(this, m_spoke_queue);
+    if (m_spoke_process->Run() != wxTHREAD_NO_ERROR) {
+      LOG_INFO(wxT("radar_pi: %s unable to start spoke process thread."), m_name.c_str());
+      delete m_spoke_process;
+      m_spoke_process = 0;
+    }
+  }
+
   if (!m_receive) {
     LOG_RECEIVE(wxT("radar_pi: %s starting receive thread"), m_name.c_str());
-    m_receive = RadarFactory::MakeRadarReceive(m_radar_type, m_pi, this);
-    if (!m_receive || (m_receive->Run() != wxTHREAD_NO_ERROR)) {
+    m_receive = RadarFactory::MakeRadarReceive(m_replay ? RT_REPLAY : m_radar_type, m_pi, this);
+    if (m_receive && m_pi->m_reactor && m_receive->Attach(m_pi->m_reactor)) {
+      m_receive_attached = true;
+    } else if (!m_receive || (m_receive->Run() != wxTHREAD_NO_ERROR)) {
       LOG_INFO(wxT("radar_pi: %s unable to start receive thread."), m_name.c_str());
       if (m_receive) {
         delete m_receive;
@@ -392,12 +491,8 @@ void RadarInfo::ResetSpokes() {
   LOG_VERBOSE(wxT("radar_pi: reset spokes"));
 
   CLEAR_STRUCT(zap);
-  for (size_t i = 0; i < m_spokes; i++) {
-    memset(m_history[i].line, 0, m_spoke_len_max);
-    m_history[i].time = 0;
-    m_history[i].pos.lat = 0.;
-    m_history[i].pos.lon = 0.;
-  }
+  m_history->Clear();
+  m_blobs->Clear();
 
   if (m_draw_panel.draw) {
     for (size_t r = 0; r < m_spokes; r++) {
@@ -479,20 +574,22 @@ void RadarInfo::ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, uint
   int stabilized_mode = orientation != ORIENTATION_HEAD_UP;
   uint8_t weakest_normal_blob = m_pi->m_settings.threshold_red;
 
-  uint8_t *hist_data = m_history[bearing].line;
-  m_history[bearing].time = time_rec;
-  memset(hist_data, 0, m_spoke_len_max);
-  GetRadarPosition(&m_history[bearing].pos);
-  for (size_t radius = 0; radius < len; radius++) {
-    if (data[radius] >= weakest_normal_blob) {
-      // and add 1 if above threshold and set the left 2 bits, used for ARPA
-      hist_data[radius] = 192;
-    }
+  m_history->Time(bearing) = time_rec.GetValue();
+  GetRadarPosition(&m_history->Pos(bearing));
+  m_history->SetSpoke(bearing, data, len, weakest_normal_blob, m_pi->m_settings.threshold_blue);
+  m_blobs->SetMinContourLength(m_min_contour_length);
+  m_blobs->AddSpoke(bearing, m_history->Row(HISTORY_TARGET, bearing), m_history->Time(bearing));
+  if (m_arpa && m_blobs->GetSweptSpokes() % (m_spokes / ARPA_TRACKS_PER_SWEEP) == 0) {
+    m_arpa->WakeTracker();
   }
 
+  const uint32_t *guard_counts = 0;  // Counted once for all zones, when there is one
   for (size_t z = 0; z < GUARD_ZONES; z++) {
     if (m_guard_zone[z]->m_alarm_on) {
-      m_guard_zone[z]->ProcessSpoke(angle, data, m_history[bearing].line, len);
+      if (!guard_counts) {
+        guard_counts = m_history->CountGuardRow();
+      }
+      m_guard_zone[z]->ProcessSpoke(angle, data, m_history->GuardRow(), guard_counts, len);
     }
   }
 
@@ -504,9 +601,10 @@ void RadarInfo::ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, uint
 
   bool draw_trails_on_overlay = M_SETTINGS.trails_on_overlay;
   if (m_draw_overlay.draw && !draw_trails_on_overlay) {
-    m_draw_overlay.draw->ProcessRadarSpoke(M_SETTINGS.overlay_transparency.GetValue(), bearing, data, len, m_history[bearing].pos);
+    m_draw_overlay.draw->ProcessRadarSpoke(M_SETTINGS.overlay_transparency.GetValue(), bearing, data, len, m_history->Pos(bearing));
   }
 
+  m_trails->StartSpoke(bearing);
   m_trails->UpdateTrailPosition();
 
   // True trails
@@ -516,11 +614,28 @@ void RadarInfo::ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, uint
   m_trails->UpdateRelativeTrails(angle, data, trail_len);
 
   if (m_draw_overlay.draw && draw_trails_on_overlay) {
-    m_draw_overlay.draw->ProcessRadarSpoke(M_SETTINGS.overlay_transparency.GetValue(), bearing, data, len, m_history[bearing].pos);
+    m_draw_overlay.draw->ProcessRadarSpoke(M_SETTINGS.overlay_transparency.GetValue(), bearing, data, len, m_history->Pos(bearing));
   }
 
   if (m_draw_panel.draw) {
-    m_draw_panel.draw->ProcessRadarSpoke(4, stabilized_mode ? bearing : angle, data, len, m_history[bearing].pos);
+    m_draw_panel.draw->ProcessRadarSpoke(4, stabilized_mode ? bearing : angle, data, len, m_history->Pos(bearing));
+  }
+}
+
+/*
+ * Called by the spoke process thread when the receive thread has queued spokes.
+ *
+ * This is where the lock that the receive threads used to take is taken now, so
+ * a long draw in the GUI thread only delays processing, it does not stop reception.
+ */
+void RadarInfo::ProcessQueuedSpokes() {
+  SpokeQueueItem *spoke;
+
+  wxCriticalSectionLocker lock(m_exclusive);
+
+  while ((spoke = m_spoke_queue->Front()) != 0) {
+    ProcessRadarSpoke(spoke->angle, spoke->bearing, spoke->data, spoke->len, spoke->range_meters, spoke->time_rec);
+    m_spoke_queue->Pop();
   }
 }
 
@@ -37,6 +37,8 @@
 #include "ControlsDialog.h"
 #include "RadarControlItem.h"
 #include "RadarReceive.h"
+#include "core/HistoryBlobs.h"
+#include "core/SpokeHistory.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -46,6 +48,10 @@ class RadarPanel;
 class GuardZoneBogey;
 class RadarInfo;
 class TrailBuffer;
+class SpokeQueue;
+class SpokeProcessThread;
+class TrailZoomTask;
+class WorkerThread;
 
 struct DrawInfo {
   RadarDraw *draw;
@@ -67,7 +73,9 @@ class RadarInfo {
   radar_pi *m_pi;          // Pointer back to the plugin
   size_t m_radar;          // Which radar this is [0..RADARS>
   RadarType m_radar_type;  // Which radar type
+  bool m_replay;           // Selected as RT_REPLAY; m_radar_type is then the type that was recorded
   size_t m_spokes;         // # of spokes per rotation
+  bool m_full_resolution;  // Navico: NAVICO_SPOKES_FULL instead of NAVICO_SPOKES spokes, see NavicoCommon.h
   size_t m_spoke_len_max;  // Max # of bytes per spoke
 
   // Digital radars cannot produce just any range. When asked for a particular value
@@ -136,6 +144,12 @@ class RadarInfo {
 
   RadarControl *m_control;
   RadarReceive *m_receive;
+  bool m_receive_attached;                           // m_receive runs on m_pi->m_reactor instead of its own thread
+  SpokeQueue *m_spoke_queue;                         // Spokes handed from m_receive to m_spoke_process
+  SpokeProcessThread *m_spoke_process;               // Runs ProcessRadarSpoke for spokes in m_spoke_queue
+  TrailZoomTask *m_trail_zoom;                       // How m_spoke_process zooms the trails, see TrailBuffer::ZoomTrails()
+  std::vector<WorkerThread *> m_trail_zoom_threads;  // Help m_spoke_process run m_trail_zoom
+  wxSemaphore m_trail_zoom_done;                     // Posted by each of them when no part is left to zoom
   ControlsDialog *m_control_dialog;
   RadarPanel *m_radar_panel;
   RadarCanvas *m_radar_canvas;
@@ -159,17 +173,13 @@ class RadarInfo {
   double m_vrm[BEARING_LINES];
   receive_statistics m_statistics;
 
-  struct line_history {
-    uint8_t *line;
-    wxLongLong time;
-    GeoPosition pos;
-  };
+  SpokeHistory *m_history;
 
-  line_history *m_history;
+  // The blobs in m_history, labelled as the spokes come in so that ARPA can look them up,
+  // see GuardZone::SearchTargets() and ArpaTarget::GetTarget(). Use under m_exclusive.
+  HistoryBlobs *m_blobs;
 
   int m_old_range;
-  int m_dir_lat;
-  int m_dir_lon;
   TrailBuffer *m_trails;
 
   // Timed Transmit
@@ -189,11 +199,10 @@ class RadarInfo {
   void SetAutoRangeMeters(int meters);
   bool SetControlValue(ControlType controlType, RadarControlItem &item, RadarControlButton *button);
   void ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, uint8_t *data, size_t len, int range_meters, wxLongLong time);
+  void ProcessQueuedSpokes();
   void RefreshDisplay();
   void RenderGuardZone();
   void ResetRadarImage();
-  void ShiftImageLonToCenter();
-  void ShiftImageLatToCenter();
   void RenderRadarImage1(wxPoint center, double scale, double rotation, bool overlay);
   void ShowRadarWindow(bool show);
   void ShowControlDialog(bool show, bool reparent);
@@ -258,7 +267,7 @@ class RadarInfo {
 
   // Speedup lookup tables of color to r,g,b, set dependent on m_settings.display_option.
   PixelColour m_colour_map_rgb[BLOB_COLOURS];
-  BlobColour m_colour_map[UINT8_MAX + 1];
+  uint8_t m_colour_map[UINT8_MAX + 1];  // BlobColour for each sample value
 
   // Speedup PolarToCartesian lookup (angle,radius) -> (x, y)
   PolarToCartesianLookup *m_polar_lookup;
@@ -292,7 +301,7 @@ class RadarInfo {
 
   wxString m_range_text;
 
-  BlobColour m_trail_colour[TRAIL_MAX_REVOLUTIONS + 1];
+  uint8_t m_trail_colour[TRAIL_MAX_REVOLUTIONS + 1];  // BlobColour for each trail age
 
   int m_previous_orientation;
 
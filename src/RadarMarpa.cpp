@@ -30,6 +30,9 @@
  */
 
 #include "RadarMarpa.h"
+
+#include <algorithm>
+
 #include "GuardZone.h"
 #include "RadarCanvas.h"
 #include "RadarInfo.h"
@@ -40,29 +43,82 @@ PLUGIN_BEGIN_NAMESPACE
 
 static int target_id_count = 0;
 
-RadarArpa::RadarArpa(radar_pi* pi, RadarInfo* ri) {
+RadarArpa::RadarArpa(radar_pi* pi, RadarInfo* ri)
+    : m_kalman(ri->m_spokes), m_track_task(this, &RadarArpa::TrackTargets), m_refresh_task(this, &RadarArpa::RefreshGroups) {
   m_ri = ri;
   m_pi = pi;
   m_number_of_targets = 0;
-  CLEAR_STRUCT(m_targets);
-}
-
-ArpaTarget::~ArpaTarget() {
-  if (m_kalman) {
-    delete m_kalman;
-    m_kalman = 0;
+  m_clear_contours = false;
+  m_draw_front = 0;
+  m_sectors = 0;
+  m_sectors_spoke_len = 0;
+  m_next_group = 0;
+  m_pass_dist = 0;
+  m_refresh_usec = 0;
+  m_refresh_count = 0;
+  m_refresh_groups = 0;
+  m_lock_usec = 0;
+  m_lock_max_usec = 0;
+  int helpers = wxMin(wxThread::GetCPUCount(), ARPA_REFRESH_THREADS) - 1;
+  for (int i = 0; i < helpers; i++) {
+    WorkerThread* helper = new WorkerThread(ri->m_name + wxT(" ARPA refresh"), &m_refresh_task, &m_helpers_done);
+    if (helper->Run() != wxTHREAD_NO_ERROR) {
+      delete helper;
+      break;
+    }
+    m_helpers.push_back(helper);
+  }
+  m_tracker = new WorkerThread(ri->m_name + wxT(" ARPA tracker"), &m_track_task, 0, ARPA_TRACK_TIMEOUT);
+  if (m_tracker->Run() != wxTHREAD_NO_ERROR) {
+    LOG_INFO(wxT("radar_pi: %s unable to start ARPA tracker thread."), m_ri->m_name.c_str());
+    delete m_tracker;
+    m_tracker = 0;
   }
 }
 
+ArpaTarget::~ArpaTarget() {}
+
 RadarArpa::~RadarArpa() {
-  int n = m_number_of_targets;
+  if (m_tracker) {
+    m_tracker->Shutdown();
+    m_tracker->Wait();
+    delete m_tracker;
+    m_tracker = 0;
+  }
+  for (size_t i = 0; i < m_helpers.size(); i++) {
+    m_helpers[i]->Shutdown();
+    m_helpers[i]->Wait();
+    delete m_helpers[i];
+  }
+  m_helpers.clear();
+  if (m_sectors) {
+    delete m_sectors;
+    m_sectors = 0;
+  }
   m_number_of_targets = 0;
-  for (int i = 0; i < n; i++) {
-    if (m_targets[i]) {
-      delete m_targets[i];
-      m_targets[i] = 0;
-    }
+  m_targets.clear();
+  for (size_t i = 0; i < m_pool.size(); i++) {
+    delete m_pool[i];
   }
+  m_pool.clear();
+}
+
+ArpaTarget* RadarArpa::NewTarget() {
+  // make new target or re-use a lost one
+  ArpaTarget* target;
+  if (!m_free_slots.empty()) {
+    target = m_pool[m_free_slots.back()];
+    m_free_slots.pop_back();
+  } else {
+    target = new ArpaTarget(m_pi, m_ri);
+    target->m_slot = (int)m_pool.size();
+    m_pool.push_back(target);
+    m_kalman.Resize(m_pool.size());  // a new filter is reset, as are those of lost targets
+    target->m_kalman = &m_kalman;
+  }
+  m_targets.push_back(target);
+  m_number_of_targets = (int)m_targets.size();
+  return target;
 }
 
 ExtendedPosition ArpaTarget::Polar2Pos(Polar pol, ExtendedPosition own_ship) {
@@ -91,23 +147,14 @@ Polar ArpaTarget::Pos2Polar(ExtendedPosition p, ExtendedPosition own_ship) {
   return pol;
 }
 
-bool RadarArpa::Pix(int ang, int rad) {
-  if (rad <= 0 || rad >= (int)m_ri->m_spoke_len_max) {
-    return false;
-  }
-  return ((m_ri->m_history[MOD_SPOKES(ang)].line[rad] & 128) != 0);
-}
-
 bool ArpaTarget::Pix(int ang, int rad) {
   if (rad <= 0 || rad >= (int)m_ri->m_spoke_len_max) {
     return false;
   }
   if (m_check_for_duplicate) {
-    // check bit 1
-    return ((m_ri->m_history[MOD_SPOKES(ang)].line[rad] & 64) != 0);
+    return m_ri->m_history->Test(HISTORY_DUPLICATE, MOD_SPOKES(ang), rad);
   } else {
-    // check bit 0
-    return ((m_ri->m_history[MOD_SPOKES(ang)].line[rad] & 128) != 0);
+    return m_ri->m_history->Test(HISTORY_TARGET, MOD_SPOKES(ang), rad);
   }
 }
 
@@ -115,7 +162,7 @@ bool ArpaTarget::MultiPix(int ang, int rad) {  // checks if the blob has a conto
   // pol must start on the contour of the blob
   // false if not
   // if false clears out pixels of the blob in hist
-  wxCriticalSectionLocker lock(ArpaTarget::m_ri->m_exclusive);
+  // called with m_ri->m_exclusive held, see RadarArpa::RefreshPass()
   int length = m_ri->m_min_contour_length;
   Polar start;
   start.angle = ang;
@@ -208,113 +255,7 @@ bool ArpaTarget::MultiPix(int ang, int rad) {  // checks if the blob has a conto
     max_angle.angle += m_ri->m_spokes;
   }
   for (int a = min_angle.angle; a <= max_angle.angle; a++) {
-    for (int r = min_r.r; r <= max_r.r; r++) {
-      m_ri->m_history[MOD_SPOKES(a)].line[r] &= 63;
-    }
-  }
-  return false;
-}
-
-bool RadarArpa::MultiPix(int ang, int rad) {
-  // checks the blob has a contour of at least length pixels
-  // pol must start on the contour of the blob
-  // false if not
-  // if false clears out pixels of th blob in hist
-  //    wxCriticalSectionLocker lock(ArpaTarget::m_ri->m_exclusive);
-  int length = m_ri->m_min_contour_length;
-  Polar start;
-  start.angle = ang;
-  start.r = rad;
-  if (!Pix(start.angle, start.r)) {
-    return false;
-  }
-  Polar current = start;  // the 4 possible translations to move from a point on the contour to the next
-  Polar max_angle;
-  Polar min_angle;
-  Polar max_r;
-  Polar min_r;
-  Polar transl[4];  //   = { 0, 1,   1, 0,   0, -1,   -1, 0 };
-  transl[0].angle = 0;
-  transl[0].r = 1;
-  transl[1].angle = 1;
-  transl[1].r = 0;
-  transl[2].angle = 0;
-  transl[2].r = -1;
-  transl[3].angle = -1;
-  transl[3].r = 0;
-  int count = 0;
-  int aa;
-  int rr;
-  bool succes = false;
-  int index = 0;
-  max_r = current;
-  max_angle = current;
-  min_r = current;
-  min_angle = current;  // check if p inside blob
-  if (start.r >= (int)m_ri->m_spoke_len_max) {
-    return false;  //  r too large
-  }
-  if (start.r < 3) {
-    return false;  //  r too small
-  }
-  // first find the orientation of border point p
-  for (int i = 0; i < 4; i++) {
-    index = i;
-    aa = current.angle + transl[index].angle;
-    rr = current.r + transl[index].r;
-    succes = !Pix(aa, rr);
-    if (succes) break;
-  }
-  if (!succes) {
-    return false;
-  }
-  index += 1;  // determines starting direction
-  if (index > 3) index -= 4;
-  while (current.r != start.r || current.angle != start.angle ||
-         count == 0) {  // try all translations to find the next point  // start with the "left most" translation relative to the
-    // previous one
-    index += 3;  // we will turn left all the time if possible
-    for (int i = 0; i < 4; i++) {
-      if (index > 3) index -= 4;
-      aa = current.angle + transl[index].angle;
-      rr = current.r + transl[index].r;
-      succes = Pix(aa, rr);
-      if (succes) {  // next point found
-        break;
-      }
-      index += 1;
-    }
-    if (!succes) {
-      return false;  // no next point found
-    }                // next point found
-    current.angle = aa;
-    current.r = rr;
-    if (count >= length) {
-      return true;
-    }
-    count++;
-    if (current.angle > max_angle.angle) {
-      max_angle = current;
-    }
-    if (current.angle < min_angle.angle) {
-      min_angle = current;
-    }
-    if (current.r > max_r.r) {
-      max_r = current;
-    }
-    if (current.r < min_r.r) {
-      min_r = current;
-    }
-  }  // contour length is less than m_min_contour_length
-  // before returning false erase this blob so we do not have to check this one again
-  if (min_angle.angle < 0) {
-    min_angle.angle += m_ri->m_spokes;
-    max_angle.angle += m_ri->m_spokes;
-  }
-  for (int a = min_angle.angle; a <= max_angle.angle; a++) {
-    for (int r = min_r.r; r <= max_r.r; r++) {
-      m_ri->m_history[MOD_SPOKES(a)].line[r] &= 63;
-    }
+    m_ri->m_history->ClearCells(MOD_SPOKES(a), min_r.r, max_r.r, HISTORY_ALL_PLANES);
   }
   return false;
 }
@@ -330,22 +271,16 @@ void RadarArpa::AcquireOrDeleteMarpaTarget(ExtendedPosition target_pos, int stat
   // returns in X metric coordinates of click
   // constructs Kalman filter
   // make new target
-  int i_target;
-  if (m_number_of_targets < MAX_NUMBER_OF_TARGETS - 1 ||
-      (m_number_of_targets == MAX_NUMBER_OF_TARGETS - 1 && status == FOR_DELETION)) {
-    if (m_targets[m_number_of_targets] == 0) {
-      m_targets[m_number_of_targets] = new ArpaTarget(m_pi, m_ri);
-    }
-    i_target = m_number_of_targets;
-    m_number_of_targets++;
-  } else {
+  wxCriticalSectionLocker lock(m_targets_lock);
+  if (m_number_of_targets >= MAX_NUMBER_OF_TARGETS - 1 &&
+      (m_number_of_targets != MAX_NUMBER_OF_TARGETS - 1 || status != FOR_DELETION)) {
     LOG_INFO(wxT("radar_pi: RadarArpa:: Error, max targets exceeded "));
     return;
   }
 
   LOG_ARPA(wxT("radar_pi: Adding (M)ARPA target at position %f / %f"), target_pos.pos.lat, target_pos.pos.lon);
 
-  ArpaTarget* target = m_targets[i_target];
+  ArpaTarget* target = NewTarget();
   target->m_position = target_pos;  // Expected position
   target->m_position.time = 0;
   target->m_position.dlat_dt = 0.;
@@ -357,9 +292,6 @@ void RadarArpa::AcquireOrDeleteMarpaTarget(ExtendedPosition target_pos, int stat
   target->m_max_r.r = 0;
   target->m_min_r.r = 0;
 
-  if (!target->m_kalman) {
-    target->m_kalman = new KalmanFilter(m_ri->m_spokes);
-  }
   target->m_automatic = false;
   return;
 }
@@ -392,11 +324,11 @@ bool ArpaTarget::FindContourFromInside(Polar* pol) {  // moves pol to contour of
  * Find a contour from the given start position on the edge of a blob.
  *
  * Follows the contour in a clockwise manner.
+ * Called with m_ri->m_exclusive held, see RadarArpa::RefreshPass().
  *
  * Returns 0 if ok, or a small integer on error (but nothing is done with this)
  */
-int ArpaTarget::GetContour(Polar* pol) {
-  wxCriticalSectionLocker lock(ArpaTarget::m_ri->m_exclusive);
+int ArpaTarget::GetContour(Polar* pol, Polar* contour) {
   // the 4 possible translations to move from a point on the contour to the next
   Polar transl[4];  //   = { 0, 1,   1, 0,   0, -1,   -1, 0 };
   transl[0].angle = 0;
@@ -472,10 +404,10 @@ int ArpaTarget::GetContour(Polar* pol) {
     current.angle = aa;
     current.r = rr;
     if (count < MAX_CONTOUR_LENGTH - 2) {
-      m_contour[count] = current;
+      contour[count] = current;
     }
     if (count == MAX_CONTOUR_LENGTH - 2) {
-      m_contour[count] = start;  // shortcut to the beginning for drawing the contour
+      contour[count] = start;  // shortcut to the beginning for drawing the contour
       current = start;           // this will cause the while to terminate
     }
     if (count < MAX_CONTOUR_LENGTH - 1) {
@@ -511,8 +443,8 @@ int ArpaTarget::GetContour(Polar* pol) {
     pol->angle -= m_ri->m_spokes;
   }
   pol->r = (m_max_r.r + m_min_r.r) / 2;
-  pol->time = m_ri->m_history[MOD_SPOKES(pol->angle)].time;
-  m_radar_pos = m_ri->m_history[MOD_SPOKES(pol->angle)].pos;
+  pol->time = m_ri->m_history->Time(MOD_SPOKES(pol->angle));
+  m_radar_pos = m_ri->m_history->Pos(MOD_SPOKES(pol->angle));
 
   double poslat = m_radar_pos.lat;
   double poslon = m_radar_pos.lon;
@@ -523,10 +455,7 @@ int ArpaTarget::GetContour(Polar* pol) {
   return 0;  //  success, blob found
 }
 
-void RadarArpa::DrawContour(ArpaTarget* target) {
-  if (target->m_lost_count > 0) {
-    return;  // don't draw targets that were not seen last sweep
-  }
+void RadarArpa::DrawContour(const Polar* contour, int length) {
   wxColor arpa = m_pi->m_settings.arpa_colour;
   glColor4ub(arpa.Red(), arpa.Green(), arpa.Blue(), arpa.Alpha());
   glLineWidth(3.0);
@@ -534,9 +463,9 @@ void RadarArpa::DrawContour(ArpaTarget* target) {
   glEnableClientState(GL_VERTEX_ARRAY);
 
   Point vertex_array[MAX_CONTOUR_LENGTH + 1];
-  for (int i = 0; i < target->m_contour_length; i++) {
-    int angle = target->m_contour[i].angle + (DEGREES_PER_ROTATION + OPENGL_ROTATION) * m_ri->m_spokes / DEGREES_PER_ROTATION;
-    int radius = target->m_contour[i].r;
+  for (int i = 0; i < length; i++) {
+    int angle = contour[i].angle + (DEGREES_PER_ROTATION + OPENGL_ROTATION) * m_ri->m_spokes / DEGREES_PER_ROTATION;
+    int radius = contour[i].r;
     if (radius <= 0 || radius >= (int)m_ri->m_spoke_len_max) {
       LOG_INFO(wxT("radar_pi: wrong values in DrawContour"));
       return;
@@ -547,7 +476,7 @@ void RadarArpa::DrawContour(ArpaTarget* target) {
   }
 
   glVertexPointer(2, GL_FLOAT, 0, vertex_array);
-  glDrawArrays(GL_LINE_STRIP, 0, target->m_contour_length);
+  glDrawArrays(GL_LINE_STRIP, 0, length);
 
   glDisableClientState(GL_VERTEX_ARRAY);  // disable vertex arrays
 }
@@ -555,44 +484,38 @@ void RadarArpa::DrawContour(ArpaTarget* target) {
 void RadarArpa::DrawArpaTargetsOverlay(double scale, double arpa_rotate) {
   wxPoint boat_center;
   GeoPosition radar_pos;
-  if (!m_pi->m_settings.drawing_method && m_ri->GetRadarPosition(&radar_pos)) {
-    for (int i = 0; i < m_number_of_targets; i++) {
-      if (!m_targets[i]) {
-        continue;
-      }
-      if (m_targets[i]->m_status == LOST) {
-        continue;
-      }
-      double poslat = m_targets[i]->m_radar_pos.lat;
-      double poslon = m_targets[i]->m_radar_pos.lon;
+  // GetRadarPosition() takes m_ri->m_exclusive, so not while m_draw_lock is held
+  bool have_radar_pos = m_ri->GetRadarPosition(&radar_pos);
+  wxCriticalSectionLocker lock(m_draw_lock);
+  const ArpaDrawTargets& draw = m_draw[m_draw_front];
+
+  if (!m_pi->m_settings.drawing_method && have_radar_pos) {
+    for (size_t i = 0; i < draw.targets.size(); i++) {
+      const ArpaDrawTarget& target = draw.targets[i];
+      double poslat = target.radar_pos.lat;
+      double poslon = target.radar_pos.lon;
       // some additional logging, to be removed later
       if (poslat > 90. || poslat < -90. || poslon > 180. || poslon < -180.) {
-        LOG_INFO(wxT("**error wrong target pos, nr = %i, poslat = %f, poslon = %f"), i, poslat, poslon);
+        LOG_INFO(wxT("**error wrong target pos, nr = %i, poslat = %f, poslon = %f"), (int)i, poslat, poslon);
         continue;
       }
 
-      GetCanvasPixLL(m_ri->m_pi->m_vp, &boat_center, m_targets[i]->m_radar_pos.lat, m_targets[i]->m_radar_pos.lon);
+      GetCanvasPixLL(m_ri->m_pi->m_vp, &boat_center, poslat, poslon);
       glPushMatrix();
       glTranslated(boat_center.x, boat_center.y, 0);
       glRotated(arpa_rotate, 0.0, 0.0, 1.0);
       glScaled(scale, scale, 1.);
-      DrawContour(m_targets[i]);
+      DrawContour(&draw.contour[target.first], target.length);
       glPopMatrix();
     }
   } else {
-    m_ri->GetRadarPosition(&radar_pos);
     GetCanvasPixLL(m_ri->m_pi->m_vp, &boat_center, radar_pos.lat, radar_pos.lon);
     glPushMatrix();
     glTranslated(boat_center.x, boat_center.y, 0);
     glRotated(arpa_rotate, 0.0, 0.0, 1.0);
     glScaled(scale, scale, 1.);
-    for (int i = 0; i < m_number_of_targets; i++) {
-      if (!m_targets[i]) {
-        continue;
-      }
-      if (m_targets[i]->m_status != LOST) {
-        DrawContour(m_targets[i]);
-      }
+    for (size_t i = 0; i < draw.targets.size(); i++) {
+      DrawContour(&draw.contour[draw.targets[i].first], draw.targets[i].length);
     }
     glPopMatrix();
   }
@@ -603,17 +526,14 @@ void RadarArpa::DrawArpaTargetsPanel(double scale, double arpa_rotate) {
   GeoPosition radar_pos, target_pos;
   double offset_lat = 0.;
   double offset_lon = 0.;
-
-  if (!m_pi->m_settings.drawing_method && m_ri->GetRadarPosition(&radar_pos)) {
-    m_ri->GetRadarPosition(&radar_pos);
-    for (int i = 0; i < m_number_of_targets; i++) {
-      if (!m_targets[i]) {
-        continue;
-      }
-      if (m_targets[i]->m_status == LOST) {
-        continue;
-      }
-      target_pos = m_targets[i]->m_radar_pos;
+  // GetRadarPosition() takes m_ri->m_exclusive, so not while m_draw_lock is held
+  bool have_radar_pos = m_ri->GetRadarPosition(&radar_pos);
+  wxCriticalSectionLocker lock(m_draw_lock);
+  const ArpaDrawTargets& draw = m_draw[m_draw_front];
+
+  if (!m_pi->m_settings.drawing_method && have_radar_pos) {
+    for (size_t i = 0; i < draw.targets.size(); i++) {
+      target_pos = draw.targets[i].radar_pos;
       offset_lat = (radar_pos.lat - target_pos.lat) * 60. * 1852. * m_ri->m_panel_zoom / m_ri->m_range.GetValue();
       offset_lon = (radar_pos.lon - target_pos.lon) * 60. * 1852. * cos(deg2rad(target_pos.lat)) * m_ri->m_panel_zoom /
                    m_ri->m_range.GetValue();
@@ -621,7 +541,7 @@ void RadarArpa::DrawArpaTargetsPanel(double scale, double arpa_rotate) {
       glRotated(arpa_rotate, 0.0, 0.0, 1.0);
       glTranslated(-offset_lon, offset_lat, 0);
       glScaled(scale, scale, 1.);
-      DrawContour(m_targets[i]);
+      DrawContour(&draw.contour[draw.targets[i].first], draw.targets[i].length);
       glPopMatrix();
     }
   }
@@ -631,126 +551,334 @@ void RadarArpa::DrawArpaTargetsPanel(double scale, double arpa_rotate) {
     glTranslated(0., 0., 0.);
     glRotated(arpa_rotate, 0.0, 0.0, 1.0);
     glScaled(scale, scale, 1.);
-    for (int i = 0; i < m_number_of_targets; i++) {
-      if (!m_targets[i]) {
-        continue;
-      }
-      if (m_targets[i]->m_status == LOST) {
-        continue;
-      }
-      DrawContour(m_targets[i]);
+    for (size_t i = 0; i < draw.targets.size(); i++) {
+      DrawContour(&draw.contour[draw.targets[i].first], draw.targets[i].length);
     }
     glPopMatrix();
   }
 }
 
 void RadarArpa::CleanUpLostTargets() {
-  // remove targets with status LOST and put them at the end
-  // adjust m_number_of_targets
-  int ii = 0;
-  while (ii < m_number_of_targets) {
-    if (m_targets[ii]) {
-      if (m_targets[ii]->m_status == LOST) {
-        // we keep the lost target for later use, destruction and construction is expensive
-        ArpaTarget* lost = m_targets[ii];
-        int len = sizeof(ArpaTarget*);
-        // move rest of larget list up to keep them in sequence
-        memmove(&m_targets[ii], &m_targets[ii] + 1, (m_number_of_targets - ii) * len);
-        m_number_of_targets--;
-        // set the lost target at the last position
-        m_targets[m_number_of_targets] = lost;
-      } else {
-        ii++;
-      }
+  // remove targets with status LOST, keep the others in sequence
+  size_t n = 0;
+  for (size_t i = 0; i < m_targets.size(); i++) {
+    ArpaTarget* target = m_targets[i];
+    if (target->m_status == LOST) {
+      // we keep the lost target for later use, destruction and construction is expensive
+      m_contours.Release(target->m_slot);
+      m_free_slots.push_back(target->m_slot);
+    } else {
+      m_targets[n++] = target;
     }
   }
+  m_targets.resize(n);
+  m_number_of_targets = (int)n;
 }
 
-void RadarArpa::RefreshArpaTargets() {
-  CleanUpLostTargets();
-  int target_to_delete = -1;
-  // find a target with status FOR_DELETION if it is there
-  for (int i = 0; i < m_number_of_targets; i++) {
-    if (!m_targets[i]) continue;
+void RadarArpa::DeleteMarkedTargets() {
+  // delete the target that is closest to each target with status FOR_DELETION, and that target itself
+  bool marked = false;
+  for (size_t i = 0; i < m_targets.size(); i++) {
     if (m_targets[i]->m_status == FOR_DELETION) {
-      target_to_delete = i;
+      marked = true;
+      break;
     }
   }
-  if (target_to_delete != -1) {
-    // delete the target that is closest to the target with status FOR_DELETION
-    ExtendedPosition* deletePosition = &m_targets[target_to_delete]->m_position;
-    double min_dist = 1000;
-    int del_target = -1;
-    for (int i = 0; i < m_number_of_targets; i++) {
-      if (!m_targets[i]) continue;
-      if (i == target_to_delete || m_targets[i]->m_status == LOST) continue;
-      double dif_lat = deletePosition->pos.lat - m_targets[i]->m_position.pos.lat;
-      double dif_lon = (deletePosition->pos.lon - m_targets[i]->m_position.pos.lon) * cos(deg2rad(deletePosition->pos.lat));
-      double dist2 = dif_lat * dif_lat + dif_lon * dif_lon;
-      if (dist2 < min_dist) {
-        min_dist = dist2;
-        del_target = i;
-      }
+  if (!marked) {
+    return;
+  }
+
+  // index the other targets in meters relative to the first one, so the nearest target is found
+  // by looking at the few grid cells around each marked target
+  GeoPosition origin = m_targets[0]->m_position.pos;
+  double lon_scale = cos(deg2rad(origin.lat));
+  m_grid_points.clear();
+  for (size_t i = 0; i < m_targets.size(); i++) {
+    ArpaTarget* target = m_targets[i];
+    if (target->m_status != FOR_DELETION) {
+      TargetGridPoint point;
+      point.x = (target->m_position.pos.lon - origin.lon) * lon_scale * 60. * 1852.;
+      point.y = (target->m_position.pos.lat - origin.lat) * 60. * 1852.;
+      point.id = target->m_slot;
+      m_grid_points.push_back(point);
+    }
+  }
+  m_grid.Build(m_grid_points);
+
+  for (size_t i = 0; i < m_targets.size(); i++) {
+    ArpaTarget* target = m_targets[i];
+    if (target->m_status != FOR_DELETION) {
+      continue;
     }
-    // del_target is the index of the target closest to target with index target_to_delete
-    if (del_target != -1) {
-      m_targets[del_target]->SetStatusLost();
+    double x = (target->m_position.pos.lon - origin.lon) * lon_scale * 60. * 1852.;
+    double y = (target->m_position.pos.lat - origin.lat) * 60. * 1852.;
+    int slot = m_grid.Nearest(x, y, HUGE_VAL, -1);
+    if (slot >= 0 && m_pool[slot]->m_status != LOST) {
+      m_pool[slot]->SetStatusLost();
+      m_pool[slot]->Commit();
     }
-    m_targets[target_to_delete]->SetStatusLost();
-    // now first clean up the lost targets again
-    CleanUpLostTargets();
+    target->SetStatusLost();
+    target->Commit();
   }
+  // now first clean up the lost targets again
+  CleanUpLostTargets();
+}
+
+void RadarArpa::RefreshArpaTargets() {
+  if (m_clear_contours) {
+    m_clear_contours = false;
+    for (size_t i = 0; i < m_targets.size(); i++) {
+      m_targets[i]->m_contour_length = 0;
+      m_contours.Release(m_targets[i]->m_slot);
+    }
+  }
+  CleanUpLostTargets();
+  DeleteMarkedTargets();
 
-  ArpaTarget t;
-  KalmanFilter k(m_ri->m_spokes);
   // main target refresh loop
+  RefreshPass(PASS1, TARGET_SEARCH_RADIUS1);
+  RefreshPass(PASS2, TARGET_SEARCH_RADIUS2);
 
-  // pass 1 of target refresh
-  int dist = TARGET_SEARCH_RADIUS1;
-  for (int i = 0; i < m_number_of_targets; i++) {
-    if (!m_targets[i]) {
-      LOG_INFO(wxT("radar_pi:  error target non existent i=%i"), i);
-      continue;
+  for (int i = 0; i < GUARD_ZONES; i++) m_ri->m_guard_zone[i]->SearchTargets();
+}
+
+// Refresh the targets that take part in this pass.
+//
+// The Kalman filters of all of them predict at once. When there are enough targets they are then
+// split in groups that touch different cells of the history, and the groups are refreshed on the
+// tracker and the helper threads. Within a group the targets are refreshed in their own order, so
+// each target ends up the same as when all of them are refreshed one after the other. The history
+// is locked while that runs, so the spoke process thread cannot change the cells the groups were
+// split on. Targets that are refreshed by the tracker alone take the lock ARPA_LOCK_TARGETS at a
+// time, so the spoke process thread is not held up by a long pass. What a target sends to OCPN,
+// and the target ids, are done by Commit() after the pass, in the order of the targets.
+void RadarArpa::RefreshPass(PassN pass, int dist) {
+  m_pass_targets.clear();
+  for (size_t i = 0; i < m_targets.size(); i++) {
+    ArpaTarget* target = m_targets[i];
+    if (pass == PASS1) {
+      target->m_pass_nr = PASS1;
+      if (target->m_pass1_result == NOT_FOUND_IN_PASS1) continue;
+    } else {
+      if (target->m_pass1_result == UNKNOWN) continue;
+      target->m_pass_nr = PASS2;
+    }
+    m_pass_targets.push_back(target);
+  }
+  if (m_pass_targets.empty() || !m_ri->GetRadarPosition(&m_pass_own_pos.pos)) {
+    return;
+  }
+  m_pass_dist = dist;
+
+  size_t groups = 1;
+  {
+    wxCriticalSectionLocker lock(m_ri->m_exclusive);
+    wxLongLong locked = wxGetUTCTimeUSec();
+
+    // the Kalman filters of the targets that are refreshed now predict all at once
+    m_predict_slots.clear();
+    m_predict_x.clear();
+    m_predict_delta_t.clear();
+    size_t n = 0;
+    for (size_t i = 0; i < m_pass_targets.size(); i++) {
+      ArpaTarget* target = m_pass_targets[i];
+      if (target->StartUpdate(m_pass_own_pos)) {
+        m_pass_targets[n++] = target;
+        m_predict_slots.push_back(target->m_slot);
+        m_predict_x.push_back(target->m_predicted);
+        m_predict_delta_t.push_back(target->m_delta_t);
+      }
+    }
+    m_pass_targets.resize(n);
+    if (!m_pass_targets.empty()) {
+      m_kalman.Predict(m_pass_targets.size(), &m_predict_slots[0], &m_predict_x[0], &m_predict_delta_t[0]);
     }
-    m_targets[i]->m_pass_nr = PASS1;
-    if (m_targets[i]->m_pass1_result == NOT_FOUND_IN_PASS1) continue;
-    m_targets[i]->RefreshTarget(dist);
-    if (m_targets[i]->m_pass1_result == NOT_FOUND_IN_PASS1) {
+    for (size_t i = 0; i < m_pass_targets.size(); i++) {
+      m_pass_targets[i]->m_predicted = m_predict_x[i];
     }
+
+    if (!m_helpers.empty() && m_pass_targets.size() >= ARPA_PARALLEL_TARGETS) {
+      groups = PartitionTargets();
+    }
+    if (groups > 1) {
+      size_t helpers = wxMin(m_helpers.size(), groups - 1);
+      m_next_group = 0;
+      for (size_t i = 0; i < helpers; i++) {
+        m_helpers[i]->Wake();
+      }
+      RefreshGroups();
+      for (size_t i = 0; i < helpers; i++) {
+        m_helpers_done.Wait();
+      }
+    }
+    CountLockHeld(locked);
+  }
+  if (groups == 1) {
+    for (size_t first = 0; first < m_pass_targets.size(); first += ARPA_LOCK_TARGETS) {
+      size_t last = wxMin(first + ARPA_LOCK_TARGETS, m_pass_targets.size());
+      wxCriticalSectionLocker lock(m_ri->m_exclusive);
+      wxLongLong locked = wxGetUTCTimeUSec();
+
+      for (size_t i = first; i < last; i++) {
+        m_pass_targets[i]->FinishUpdate(dist, m_pass_own_pos);
+      }
+      CountLockHeld(locked);
+    }
+  }
+  m_refresh_groups += groups;
+
+  for (size_t i = 0; i < m_targets.size(); i++) {
+    m_targets[i]->Commit();
+  }
+}
+
+// Add the time since 'locked' to the time that the tracker held m_ri->m_exclusive, which the spoke
+// process thread may have waited for.
+void RadarArpa::CountLockHeld(wxLongLong locked) {
+  wxLongLong held = wxGetUTCTimeUSec() - locked;
+
+  m_lock_usec += held;
+  if (held > m_lock_max_usec) {
+    m_lock_max_usec = held;
   }
+}
 
-  // pass 2 of target refresh
-  dist = TARGET_SEARCH_RADIUS2;
-  for (int i = 0; i < m_number_of_targets; i++) {
-    if (!m_targets[i]) {
-      LOG_INFO(wxT("radar_pi: error target non existent i=%i"), i);
+// Orders groups by the number of targets in them, see RadarArpa::PartitionTargets()
+struct GroupIsLarger {
+  const std::vector<size_t>& first;
+
+  GroupIsLarger(const std::vector<size_t>& group_first) : first(group_first) {}
+  bool operator()(int a, int b) const { return first[a + 1] - first[a] > first[b + 1] - first[b]; }
+};
+
+// Split m_pass_targets in groups, returns the number of groups. Called with m_ri->m_exclusive held.
+size_t RadarArpa::PartitionTargets() {
+  if (!m_sectors || m_sectors_spoke_len != m_ri->m_spoke_len_max) {
+    if (m_sectors) {
+      delete m_sectors;
+    }
+    m_sectors = new SectorPartition(m_ri->m_spokes, m_ri->m_spoke_len_max, DISTANCE_BETWEEN_TARGETS + 1);
+    m_sectors_spoke_len = m_ri->m_spoke_len_max;
+  }
+
+  m_sectors->Begin(*m_ri->m_history);
+  for (size_t i = 0; i < m_pass_targets.size(); i++) {
+    SectorBox box;
+    Polar at;
+    bool looks = m_pass_targets[i]->GetSearchBox(m_pass_dist, &box, &at);
+    m_sectors->AddTarget(looks ? &box : 0, at.angle, at.r);
+  }
+  // the blobs that ArpaTarget::FindNearestBlob() may pick, only those near the targets matter
+  HistoryBlobs* blobs = m_ri->m_blobs;
+  uint32_t swept = blobs->GetSweptSpokes();
+  m_sectors->MarkTargetSectors(*blobs, &m_blob_sectors);
+  blobs->Find(m_blob_sectors, &m_near_blobs);
+  for (size_t i = 0; i < m_near_blobs.size(); i++) {
+    const HistoryBlob& blob = blobs->Get(m_near_blobs[i]);
+    if (swept - blob.swept > 2 * m_ri->m_spokes) {
+      break;
+    }
+    if (blob.r_min >= (int)m_ri->m_spoke_len_max - 1) {
       continue;
     }
-    if (m_targets[i]->m_pass1_result == UNKNOWN) continue;
-    m_targets[i]->m_pass_nr = PASS2;
-    m_targets[i]->RefreshTarget(dist);
+    SectorBox box = {blob.angle_min, blob.angle_max, blob.r_min, blob.r_max};
+    m_sectors->AddBlob(box, blob.seed_angle, blob.seed_r);
   }
+  size_t groups = m_sectors->Partition(&m_groups);
 
-  for (int i = 0; i < GUARD_ZONES; i++) m_ri->m_guard_zone[i]->SearchTargets();
+  // list the targets by group, and start with the largest groups so the threads finish together
+  m_group_first.assign(groups + 1, 0);
+  for (size_t i = 0; i < m_groups.size(); i++) {
+    m_group_first[m_groups[i] + 1]++;
+  }
+  for (size_t g = 0; g < groups; g++) {
+    m_group_first[g + 1] += m_group_first[g];
+  }
+  m_group_targets.resize(m_pass_targets.size());
+  std::vector<size_t> next(m_group_first.begin(), m_group_first.end() - 1);
+  for (size_t i = 0; i < m_pass_targets.size(); i++) {
+    m_group_targets[next[m_groups[i]]++] = m_pass_targets[i];
+  }
+  m_group_order.resize(groups);
+  for (size_t g = 0; g < groups; g++) {
+    m_group_order[g] = (int)g;
+  }
+  std::stable_sort(m_group_order.begin(), m_group_order.end(), GroupIsLarger(m_group_first));
+  return groups;
+}
+
+// Refresh groups of targets until there are none left, called by the tracker and the helpers
+void RadarArpa::RefreshGroups() {
+  size_t n;
+  while ((n = m_next_group++) < m_group_order.size()) {
+    int g = m_group_order[n];
+    for (size_t i = m_group_first[g]; i < m_group_first[g + 1]; i++) {
+      m_group_targets[i]->FinishUpdate(m_pass_dist, m_pass_own_pos);
+    }
+  }
 }
 
+// The cells that FinishUpdate() may look at: 'box' around the position 'at' where it expects the
+// target. Returns false when it will not look at all. Follows FinishUpdate() and GetTarget().
+bool ArpaTarget::GetSearchBox(int dist, SectorBox* box, Polar* at) {
+  at->angle = (int)(atan2(m_predicted.pos.lon, m_predicted.pos.lat) * m_ri->m_spokes / (2. * PI));
+  if (at->angle < 0) at->angle += m_ri->m_spokes;
+  at->r = (int)(sqrt(m_predicted.pos.lat * m_predicted.pos.lat + m_predicted.pos.lon * m_predicted.pos.lon) *
+                m_ri->m_pixels_per_meter);
+  at->time = 0;
+  if (at->r >= (int)m_ri->m_spoke_len_max || at->r <= 0) {
+    return false;  // it will be lost
+  }
+
+  if (m_status == ACQUIRE0 || m_status == ACQUIRE1) {
+    dist *= 2;
+  }
+  dist = wxMax(dist, 2);
+  // blobs are picked when less than (dist + 1) * 326 / r spokes away, see FindNearestBlob()
+  int reach = (dist + 1) * 326 / at->r + 1;
+  box->angle_min = 0;
+  box->angle_max = (int)m_ri->m_spokes - 1;
+  if (2 * reach + 1 < (int)m_ri->m_spokes) {
+    box->angle_min = at->angle - reach;
+    box->angle_max = at->angle + reach;
+  }
+  box->r_min = wxMax(at->r - dist, 0);
+  box->r_max = wxMin(at->r + dist, (int)m_ri->m_spoke_len_max - 1);
+  return true;
+}
+
+// Refresh the target on its own, e.g. when it was just acquired
 void ArpaTarget::RefreshTarget(int dist) {
-  ExtendedPosition prev_X;
-  ExtendedPosition prev2_X;
   ExtendedPosition own_pos;
-  Polar pol;
-  double delta_t;
-  LocalPosition x_local;
-  wxLongLong prev_refresh = m_refresh;
-  // refresh may be called from guard directly, better check
   if (m_status == LOST || !m_ri->GetRadarPosition(&own_pos.pos)) {
     return;
   }
+  {
+    wxCriticalSectionLocker lock(m_ri->m_exclusive);
+    if (StartUpdate(own_pos)) {
+      m_kalman->Predict(1, &m_slot, &m_predicted, &m_delta_t);
+      FinishUpdate(dist, own_pos);
+    }
+  }
+  Commit();
+}
+
+// The refresh of a target is done in two halves, called with m_ri->m_exclusive held. In between
+// its Kalman filter predicts the local position m_predicted, together with those of the other
+// targets, see RadarArpa::RefreshPass().
+//
+// StartUpdate() checks if the target can be refreshed now, and returns false if not.
+bool ArpaTarget::StartUpdate(ExtendedPosition own_pos) {
+  Polar pol;
+  wxLongLong prev_refresh = m_refresh;
+  if (m_status == LOST) {
+    return false;
+  }
   pol = Pos2Polar(m_position, own_pos);
-  wxLongLong time1 = m_ri->m_history[MOD_SPOKES(pol.angle)].time;
+  wxLongLong time1 = m_ri->m_history->Time(MOD_SPOKES(pol.angle));
   int margin = SCAN_MARGIN;
   if (m_pass_nr == PASS2) margin += 100;
-  wxLongLong time2 = m_ri->m_history[MOD_SPOKES(pol.angle + margin)].time;
+  wxLongLong time2 = m_ri->m_history->Time(MOD_SPOKES(pol.angle + margin));
   // check if target has been refreshed since last time (at least SCAN_MARGIN2 later)
   // and if the beam has passed the target location with SCAN_MARGIN spokes
   // the beam sould have passed our "angle" AND a point SCANMARGIN further
@@ -763,12 +891,12 @@ void ArpaTarget::RefreshTarget(int dist) {
                m_target_id, diff);
       SetStatusLost();
     }
-    return;
+    return false;
   }
   // set new refresh time
   m_refresh = time1;
-  prev2_X = prev_X;
-  prev_X = m_position;  // save the previous target position
+  m_prev_refresh = prev_refresh;
+  m_prev_position = m_position;  // save the previous target position
 
   // for test only
   /* if (status == 0) {
@@ -779,21 +907,32 @@ void ArpaTarget::RefreshTarget(int dist) {
 
   // PREDICTION CYCLE
 
-  m_position.time = time1;                                                // estimated new target time
-  delta_t = ((double)((m_position.time - prev_X.time).GetLo())) / 1000.;  // in seconds
+  m_position.time = time1.GetValue();                                       // estimated new target time
+  m_delta_t = ((double)(m_position.time - m_prev_position.time)) / 1000.;  // in seconds
   if (m_status == 0) {
-    delta_t = 0.;
+    m_delta_t = 0.;
   }
   if (m_position.pos.lat > 90.) {
     SetStatusLost();
-    return;
+    return false;
   }
-  x_local.pos.lat = (m_position.pos.lat - own_pos.pos.lat) * 60. * 1852.;                                  // in meters
-  x_local.pos.lon = (m_position.pos.lon - own_pos.pos.lon) * 60. * 1852. * cos(deg2rad(own_pos.pos.lat));  // in meters
-  x_local.dlat_dt = m_position.dlat_dt;                                                                    // meters / sec
-  x_local.dlon_dt = m_position.dlon_dt;                                                                    // meters / sec
-  m_kalman->Predict(&x_local, delta_t);  // x_local is new estimated local position of the target
-                                         // now set the polar to expected angular position from the expected local position
+  m_predicted.pos.lat = (m_position.pos.lat - own_pos.pos.lat) * 60. * 1852.;  // in meters
+  m_predicted.pos.lon = (m_position.pos.lon - own_pos.pos.lon) * 60. * 1852. * cos(deg2rad(own_pos.pos.lat));
+  m_predicted.dlat_dt = m_position.dlat_dt;  // meters / sec
+  m_predicted.dlon_dt = m_position.dlon_dt;  // meters / sec
+  return true;
+}
+
+// FinishUpdate() looks for the target around the predicted position. This may run on any of the
+// refresh threads, so it only changes the target itself and the cells of the history that it
+// looks at. Anything else is left for Commit().
+void ArpaTarget::FinishUpdate(int dist, ExtendedPosition own_pos) {
+  ExtendedPosition prev_X = m_prev_position;
+  wxLongLong prev_refresh = m_prev_refresh;
+  LocalPosition x_local = m_predicted;  // new estimated local position of the target
+  Polar pol;
+
+  // now set the polar to expected angular position from the expected local position
   pol.angle = (int)(atan2(x_local.pos.lon, x_local.pos.lat) * m_ri->m_spokes / (2. * PI));
   if (pol.angle < 0) pol.angle += m_ri->m_spokes;
   pol.r = (int)(sqrt(x_local.pos.lat * x_local.pos.lat + x_local.pos.lon * x_local.pos.lon) * m_ri->m_pixels_per_meter);
@@ -823,14 +962,13 @@ void ArpaTarget::RefreshTarget(int dist) {
       // found old target again, reset what we have done
       LOG_INFO(wxT("radar_pi: Error Gettarget same time found"));
       m_position = prev_X;
-      prev_X = prev2_X;
       return;
     }
     m_lost_count = 0;
     if (m_status == ACQUIRE0) {
       // as this is the first measurement, move target to measured position
       ExtendedPosition p_own;
-      p_own.pos = m_ri->m_history[MOD_SPOKES(pol.angle)].pos;  // get the position at receive time
+      p_own.pos = m_ri->m_history->Pos(MOD_SPOKES(pol.angle));  // get the position at receive time
       m_position = Polar2Pos(pol, p_own);                      // using own ship location from the time of reception
       m_position.dlat_dt = 0.;
       m_position.dlon_dt = 0.;
@@ -838,16 +976,14 @@ void ArpaTarget::RefreshTarget(int dist) {
       m_position.sd_speed_kn = 0.;
     }
     m_status++;
-    // target gets an id when status  == STATUS_TO_OCPN
+    // target gets an id when status  == STATUS_TO_OCPN, see Commit()
     if (m_status == STATUS_TO_OCPN) {
-      target_id_count++;
-      if (target_id_count >= 10000) target_id_count = 1;
-      m_target_id = target_id_count;
+      m_new_id = true;
     }
     // Kalman filter to  calculate the apostriori local position and speed based on found position (pol)
     if (m_status > 1) {
-      m_kalman->Update_P();
-      m_kalman->SetMeasurement(&pol, &x_local, &m_expected,
+      m_kalman->Update_P(1, &m_slot);
+      m_kalman->SetMeasurement(1, &m_slot, &pol, &x_local, &m_expected,
                                m_ri->m_pixels_per_meter);  // pol is measured position in polar coordinates
     }
 
@@ -859,7 +995,7 @@ void ArpaTarget::RefreshTarget(int dist) {
   // target not found
   else {
     // target not found
-    if (m_pass_nr == PASS1) m_kalman->Update_P();
+    if (m_pass_nr == PASS1) m_kalman->Update_P(1, &m_slot);
     // check if the position of the target has been taken by another target, a duplicate
     // if duplicate, handle target as not found but don't do pass 2 (= search in the surroundings)
     bool duplicate = false;
@@ -878,7 +1014,6 @@ void ArpaTarget::RefreshTarget(int dist) {
       pol.time = prev_X.time;
       m_refresh = prev_refresh;
       m_position = prev_X;
-      prev_X = prev2_X;
       return;
     }
 
@@ -953,53 +1088,103 @@ void ArpaTarget::RefreshTarget(int dist) {
         // if target was not seen last sweep, color yellow
         s = Q;
       }
-      // Check for AIS target at (M)ARPA position
-      double dist2target = pol.r / m_ri->m_pixels_per_meter;
-      if (m_pi->FindAIS_at_arpaPos(m_position.pos, dist2target)) s = L;
-      PassARPAtoOCPN(&pol, s);
+      // Commit() checks for an AIS target at the (M)ARPA position, and sends it
+      m_send = true;
+      m_send_pol = pol;
+      m_send_status = s;
     }
   }
   return;
 }
 
-#define PIX(aa, rr)                                   \
-  if (rr >= (int)m_ri->m_spoke_len_max - 1) continue; \
-  if (MultiPix(aa, rr)) {                             \
-    pol->angle = aa;                                  \
-    pol->r = rr;                                      \
-    return true;                                      \
+// Do what FinishUpdate() left to do, call after the refresh in the order of the targets
+void ArpaTarget::Commit() {
+  if (m_new_id) {
+    m_new_id = false;
+    target_id_count++;
+    if (target_id_count >= 10000) target_id_count = 1;
+    m_target_id = target_id_count;
+  }
+  if (m_send) {
+    m_send = false;
+    OCPN_target_status s = m_send_status;
+    // Check for AIS target at (M)ARPA position
+    double dist2target = m_send_pol.r / m_ri->m_pixels_per_meter;
+    if (m_pi->FindAIS_at_arpaPos(m_position.pos, dist2target)) s = L;
+    PassARPAtoOCPN(&m_send_pol, s);
+  }
+  if (!m_nmea.IsEmpty()) {
+    RadarArpa* arpa = m_ri->m_arpa;
+    wxCriticalSectionLocker lock(arpa->m_nmea_lock);
+    for (size_t i = 0; i < m_nmea.GetCount(); i++) {
+      arpa->m_nmea.Add(m_nmea[i]);
+    }
+    if (arpa->m_nmea.GetCount() > ARPA_NMEA_QUEUE_MAX) {
+      arpa->m_nmea.RemoveAt(0, arpa->m_nmea.GetCount() - ARPA_NMEA_QUEUE_MAX);
+    }
   }
+  m_nmea.Clear();
+}
 
-bool ArpaTarget::FindNearestContour(Polar* pol, int dist) {
-  // make a search pattern along a square
-  // returns the position of the nearest blob found in pol
-  // dist is search radius (1 more or less) in radial pixels
+bool ArpaTarget::FindNearestBlob(Polar* pol, int dist) {
+  // returns in pol a point on the contour of the nearest blob found in the last sweep
+  // dist is search radius in radial pixels, along the spokes it is scaled with 326 / r
+  // (if r == 326 circle would be 2 * PI * 326 = 2048) so that the search area is square
+  // called with m_ri->m_exclusive held, see RadarArpa::RefreshPass()
+  HistoryBlobs* blobs = m_ri->m_blobs;
+  uint32_t swept = blobs->GetSweptSpokes();
   int a = pol->angle;
   int r = pol->r;
   if (dist < 2) dist = 2;
-  for (int j = 1; j <= dist; j++) {
-    int dist_r = j;
-    int dist_a = (int)(326. / (double)r * j);  // 326/r: conversion factor to make squares
-                                               // if r == 326 circle would be 28 * PI * 326 = 2048
-    if (dist_a == 0) dist_a = 1;
-    for (int i = 0; i <= dist_a; i++) {  // "upper" side
-      PIX(a - i, r + dist_r);            // search starting from the middle
-      PIX(a + i, r + dist_r);
-    }
-    for (int i = 0; i < dist_r; i++) {  // "right hand" side
-      PIX(a + dist_a, r + i);
-      PIX(a + dist_a, r - i);
+
+  // only the blobs within reach along the spokes, d below is at most dist when dist_a < reach
+  int reach = r > 0 ? (int)((dist + 1) * 326. / r) + 1 : (int)m_ri->m_spokes;
+  blobs->Find(a - reach, a + reach, &m_near_blobs);
+  m_rejected.clear();
+
+  while (true) {
+    int nearest = dist + 1;
+    uint32_t found = 0;
+    for (size_t i = 0; i < m_near_blobs.size(); i++) {
+      uint32_t n = m_near_blobs[i];
+      const HistoryBlob& blob = blobs->Get(n);
+      if (swept - blob.swept > 2 * m_ri->m_spokes) {
+        break;  // older blobs have been overwritten by now
+      }
+      if (blob.r_min >= (int)m_ri->m_spoke_len_max - 1) {
+        continue;
+      }
+      int dist_r = wxMax(0, wxMax(blob.r_min - r, r - blob.r_max));
+      int offset = MOD_SPOKES(a - blob.angle_min);
+      int span = blob.angle_max - blob.angle_min;
+      int dist_a = offset <= span ? 0 : wxMin(offset - span, (int)m_ri->m_spokes - offset);
+      int d = wxMax(dist_r, (int)((double)dist_a * r / 326.));
+      if (d >= nearest || d > dist) {
+        continue;
+      }
+      // the blob must still be in the history, and not have been taken by another target
+      if (m_ri->m_history->Time(blob.seed_angle) != blob.time || !Pix(blob.seed_angle, blob.seed_r)) {
+        continue;
+      }
+      if (std::find(m_rejected.begin(), m_rejected.end(), n) != m_rejected.end()) {
+        continue;
+      }
+      nearest = d;
+      found = n;
+      pol->angle = blob.seed_angle;
+      pol->r = blob.seed_r;
     }
-    for (int i = 0; i <= dist_a; i++) {  // "lower" side
-      PIX(a + i, r - dist_r);
-      PIX(a - i, r - dist_r);
+    if (nearest > dist) {
+      return false;
     }
-    for (int i = 0; i < dist_r; i++) {  // "left hand" side
-      PIX(a - dist_a, r + i);
-      PIX(a - dist_a, r - i);
+    // The contour length of the blob is only exact when it is convex, and another target may
+    // have cleared part of it since, so check it like FindContourFromInside() does. MultiPix()
+    // erases the blob when it is too short.
+    if (MultiPix(pol->angle, pol->r)) {
+      return true;
     }
+    m_rejected.push_back(found);
   }
-  return false;
 }
 
 void RadarArpa::CalculateCentroid(ArpaTarget* target) {
@@ -1011,6 +1196,7 @@ ArpaTarget::ArpaTarget(radar_pi* pi, RadarInfo* ri) {
   m_pi = pi;
   m_kalman = 0;
   m_status = LOST;
+  m_slot = -1;
   m_contour_length = 0;
   m_lost_count = 0;
   m_target_id = 0;
@@ -1023,11 +1209,20 @@ ArpaTarget::ArpaTarget(radar_pi* pi, RadarInfo* ri) {
   m_position.dlon_dt = 0.;
   m_pass1_result = UNKNOWN;
   m_pass_nr = PASS1;
+  m_new_id = false;
+  m_send = false;
+  m_send_status = Q;
+  m_send_pol.angle = 0;
+  m_send_pol.r = 0;
+  m_send_pol.time = 0;
+  m_prev_refresh = 0;
+  m_delta_t = 0.;
 }
 
 ArpaTarget::ArpaTarget() {
   m_kalman = 0;
   m_status = LOST;
+  m_slot = -1;
   m_contour_length = 0;
   m_lost_count = 0;
   m_target_id = 0;
@@ -1040,6 +1235,14 @@ ArpaTarget::ArpaTarget() {
   m_position.dlon_dt = 0.;
   m_pass1_result = UNKNOWN;
   m_pass_nr = PASS1;
+  m_new_id = false;
+  m_send = false;
+  m_send_status = Q;
+  m_send_pol.angle = 0;
+  m_send_pol.r = 0;
+  m_send_pol.time = 0;
+  m_prev_refresh = 0;
+  m_delta_t = 0.;
 }
 
 bool ArpaTarget::GetTarget(Polar* pol, int dist1) {
@@ -1060,12 +1263,13 @@ bool ArpaTarget::GetTarget(Polar* pol, int dist1) {
   if (Pix(a, r)) {
     contour_found = FindContourFromInside(pol);
   } else {
-    contour_found = FindNearestContour(pol, dist);
+    contour_found = FindNearestBlob(pol, dist);
   }
   if (!contour_found) {
     return false;
   }
-  int cont = GetContour(pol);
+  Polar contour[MAX_CONTOUR_LENGTH + 1];
+  int cont = GetContour(pol, contour);
   if (cont != 0) {
     // LOG_ARPA(wxT("radar_pi: ARPA contour error %d at %d, %d"), cont, a, r);
     // reset pol in case of error
@@ -1073,6 +1277,8 @@ bool ArpaTarget::GetTarget(Polar* pol, int dist1) {
     pol->r = r;
     return false;
   }
+  wxCriticalSectionLocker lock(m_ri->m_arpa->m_contours_lock);
+  m_ri->m_arpa->m_contours.Store(m_slot, contour, m_contour_length);
   return true;
 }
 
@@ -1134,7 +1340,7 @@ void ArpaTarget::PassARPAtoOCPN(Polar* pol, OCPN_target_status status) {
     checksum ^= *p;
   }
   nmea.Printf(wxT("$%s*%02X\r\n"), sentence, (unsigned)checksum);
-  PushNMEABuffer(nmea);
+  m_nmea.Add(nmea);  // queued by Commit()
 }
 
 void ArpaTarget::SetStatusLost() {
@@ -1142,7 +1348,7 @@ void ArpaTarget::SetStatusLost() {
   m_lost_count = 0;
   if (m_kalman) {
     // reset kalman filter, don't delete it, too  expensive
-    m_kalman->ResetFilter();
+    m_kalman->ResetFilter(m_slot);
   }
   if (m_status >= STATUS_TO_OCPN) {
     Polar p;
@@ -1151,6 +1357,8 @@ void ArpaTarget::SetStatusLost() {
     PassARPAtoOCPN(&p, L);
   }
   m_status = LOST;
+  m_new_id = false;
+  m_send = false;
   m_target_id = 0;
   m_automatic = false;
   m_refresh = 0;
@@ -1163,9 +1371,10 @@ void ArpaTarget::SetStatusLost() {
 }
 
 void RadarArpa::DeleteAllTargets() {
-  for (int i = 0; i < m_number_of_targets; i++) {
-    if (!m_targets[i]) continue;
+  wxCriticalSectionLocker lock(m_targets_lock);
+  for (size_t i = 0; i < m_targets.size(); i++) {
     m_targets[i]->SetStatusLost();
+    m_targets[i]->Commit();
   }
 }
 
@@ -1181,22 +1390,16 @@ int RadarArpa::AcquireNewARPATarget(Polar pol, int status) {
     return -1;
   }
   // make new target or re-use an existing one with status == lost
-  int i;
-  if (m_number_of_targets < MAX_NUMBER_OF_TARGETS - 1 || (m_number_of_targets == MAX_NUMBER_OF_TARGETS - 1 && status == -2)) {
-    if (!m_targets[m_number_of_targets]) {
-      m_targets[m_number_of_targets] = new ArpaTarget(m_pi, m_ri);
-    }
-    i = m_number_of_targets;
-    m_number_of_targets++;
-  } else {
+  if (m_number_of_targets >= MAX_NUMBER_OF_TARGETS - 1 && (m_number_of_targets != MAX_NUMBER_OF_TARGETS - 1 || status != -2)) {
     LOG_INFO(wxT("radar_pi: RadarArpa:: Error, max targets exceeded %i"), m_number_of_targets);
     return -1;
   }
-  ArpaTarget* target = m_targets[i];
+  int i = m_number_of_targets;
+  ArpaTarget* target = NewTarget();
   target_pos = target->Polar2Pos(pol, own_pos);
 
   target->m_position = target_pos;  // Expected position
-  target->m_position.time = wxGetUTCTimeMillis();
+  target->m_position.time = wxGetUTCTimeMillis().GetValue();
   target->m_position.dlat_dt = 0.;
   target->m_position.dlon_dt = 0.;
   target->m_position.sd_speed_kn = 0.;
@@ -1205,9 +1408,6 @@ int RadarArpa::AcquireNewARPATarget(Polar pol, int status) {
   target->m_min_angle.angle = 0;
   target->m_max_r.r = 0;
   target->m_min_r.r = 0;
-  if (!target->m_kalman) {
-    target->m_kalman = new KalmanFilter(m_ri->m_spokes);
-  }
   target->m_check_for_duplicate = false;
   target->m_automatic = true;
   target->m_target_id = 0;
@@ -1218,19 +1418,93 @@ int RadarArpa::AcquireNewARPATarget(Polar pol, int status) {
 void ArpaTarget::ResetPixels() {
   // resets the pixels of the current blob (plus DISTANCE_BETWEEN_TARGETS) so that blob will not be found again in the same sweep
   // We not only reset the blob but all pixels in a radial "square" covering the blob
-  for (int r = wxMax(m_min_r.r - DISTANCE_BETWEEN_TARGETS, 0);
-       r <= wxMin(m_max_r.r + DISTANCE_BETWEEN_TARGETS, (int)m_ri->m_spoke_len_max - 1); r++) {
-    for (int a = wxMax(m_min_angle.angle - DISTANCE_BETWEEN_TARGETS, 0);
-         a <= wxMin(m_max_angle.angle + DISTANCE_BETWEEN_TARGETS, (int)m_ri->m_spokes - 1); a++) {
-      m_ri->m_history[a].line[r] = m_ri->m_history[a].line[r] & 127;
-    }
+  int min_r = wxMax(m_min_r.r - DISTANCE_BETWEEN_TARGETS, 0);
+  int max_r = wxMin(m_max_r.r + DISTANCE_BETWEEN_TARGETS, (int)m_ri->m_spoke_len_max - 1);
+
+  for (int a = wxMax(m_min_angle.angle - DISTANCE_BETWEEN_TARGETS, 0);
+       a <= wxMin(m_max_angle.angle + DISTANCE_BETWEEN_TARGETS, (int)m_ri->m_spokes - 1); a++) {
+    m_ri->m_history->ClearCells(a, min_r, max_r, HISTORY_PLANE_BIT(HISTORY_TARGET));
   }
 }
 
 void RadarArpa::ClearContours() {
-  for (int i = 0; i < m_number_of_targets; i++) {
-    m_targets[i]->m_contour_length = 0;
+  // called by the spoke process thread with m_ri->m_exclusive held, which must not wait for the
+  // tracker or the drawing: let the tracker clear them, and publish no contours until it has
+  m_clear_contours = true;
+  WakeTracker();
+}
+
+// Pass the sentences that the targets queued to OCPN. Commit() runs on the tracker thread, but
+// OCPN expects PushNMEABuffer() to be called on the GUI thread, which this is: radar_pi calls it
+// every ARPA_NMEA_MILLIS, whether or not anything is drawn.
+void RadarArpa::PushNMEA() {
+  wxArrayString nmea;
+  {
+    wxCriticalSectionLocker lock(m_nmea_lock);
+    nmea = m_nmea;
+    m_nmea.Clear();
   }
+  for (size_t i = 0; i < nmea.GetCount(); i++) {
+    PushNMEABuffer(nmea[i]);
+  }
+}
+
+bool RadarArpa::IsArpaOn() {
+  for (int i = 0; i < GUARD_ZONES; i++) {
+    if (m_ri->m_guard_zone[i]->m_arpa_on) {
+      return true;
+    }
+  }
+  return m_number_of_targets > 0;
+}
+
+void RadarArpa::TrackTargets() {
+  wxCriticalSectionLocker lock(m_targets_lock);
+  if (m_pi->IsInitialized() && IsArpaOn()) {
+    wxLongLong start = wxGetUTCTimeUSec();
+    RefreshArpaTargets();
+    m_refresh_usec += wxGetUTCTimeUSec() - start;
+    if (++m_refresh_count >= ARPA_TRACKS_PER_SWEEP) {
+      LOG_ARPA(wxT("radar_pi: %s ARPA refresh took %d us per sweep, %d targets in %.1f groups per pass, %d threads"),
+               m_ri->m_name.c_str(), (int)m_refresh_usec.GetValue(), m_number_of_targets,
+               (double)m_refresh_groups / (2 * ARPA_TRACKS_PER_SWEEP), (int)m_helpers.size() + 1);
+      LOG_ARPA(wxT("radar_pi: %s ARPA refresh held the spoke history %d us per sweep, at most %d us at once"),
+               m_ri->m_name.c_str(), (int)m_lock_usec.GetValue(), (int)m_lock_max_usec.GetValue());
+      m_refresh_usec = 0;
+      m_refresh_count = 0;
+      m_refresh_groups = 0;
+      m_lock_usec = 0;
+      m_lock_max_usec = 0;
+    }
+  }
+  PublishTargets();
+}
+
+void RadarArpa::PublishTargets() {
+  // only the tracker changes m_draw_front, so the back buffer is not used by anyone else
+  ArpaDrawTargets& back = m_draw[1 - m_draw_front];
+  back.targets.clear();
+  back.contour.clear();
+  for (size_t i = 0; i < m_targets.size(); i++) {
+    ArpaTarget* target = m_targets[i];
+    // don't draw targets that were not seen last sweep
+    if (target->m_status == LOST || target->m_lost_count > 0 || target->m_contour_length <= 0 || m_clear_contours) {
+      continue;
+    }
+    int length;
+    const Polar* contour = m_contours.Get(target->m_slot, &length);
+    if (!contour) {
+      continue;
+    }
+    ArpaDrawTarget draw;
+    draw.radar_pos = target->m_radar_pos;
+    draw.first = back.contour.size();
+    draw.length = length;
+    back.contour.insert(back.contour.end(), contour, contour + length);
+    back.targets.push_back(draw);
+  }
+  wxCriticalSectionLocker lock(m_draw_lock);
+  m_draw_front = 1 - m_draw_front;
 }
 
 PLUGIN_END_NAMESPACE
@@ -36,16 +36,18 @@
 //#include "pi_common.h"
 
 //#include "radar_pi.h"
-#include "Kalman.h"
-#include "Matrix.h"
+#include <atomic>
+
+#include "core/Kalman.h"
+#include "core/Matrix.h"
+#include "core/SectorPartition.h"
+#include "core/TargetStore.h"
 #include "RadarInfo.h"
+#include "WorkerThread.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
-//    Forward definitions
-class KalmanFilter;
-
-#define MAX_NUMBER_OF_TARGETS (100)
+#define MAX_NUMBER_OF_TARGETS (2000)
 #define TARGET_SEARCH_RADIUS1 (2)   // radius of target search area for pass 1 (on top of the size of the blob)
 #define TARGET_SEARCH_RADIUS2 (15)  // radius of target search area for pass 1
 #define SCAN_MARGIN (150)           // number of lines that a next scan of the target may have moved
@@ -53,6 +55,13 @@ class KalmanFilter;
 #define MAX_CONTOUR_LENGTH (601)    // defines maximal size of target contour in pixels
 #define MAX_TARGET_DIAMETER (200)   // target will be set lost if diameter in pixels is larger than this value
 #define MAX_LOST_COUNT (3)          // number of sweeps that target can be missed before it is set to lost
+#define ARPA_TRACKS_PER_SWEEP (16)  // the tracker thread refreshes the targets this often per revolution
+#define ARPA_TRACK_TIMEOUT (250)    // millis, and at least this often, so targets get lost when no spokes come in
+#define ARPA_REFRESH_THREADS (4)    // a refresh pass is split over at most this many threads, including the tracker
+#define ARPA_PARALLEL_TARGETS (64)  // fewer targets than this are refreshed by the tracker alone
+#define ARPA_LOCK_TARGETS (32)      // the tracker alone refreshes this many targets per hold of the history lock
+#define ARPA_NMEA_MILLIS (500)      // the GUI thread passes the queued NMEA sentences to OCPN this often
+#define ARPA_NMEA_QUEUE_MAX (2 * MAX_NUMBER_OF_TARGETS)  // older sentences are dropped when OCPN falls behind
 
 #define FOR_DELETION (-2)  // status of a duplicate target used to delete a target
 #define LOST (-1)
@@ -88,12 +97,16 @@ class ArpaTarget {
   ArpaTarget();
   ~ArpaTarget();
 
-  int GetContour(Polar* p);
+  int GetContour(Polar* p, Polar* contour);
   void set(radar_pi* pi, RadarInfo* ri);
-  bool FindNearestContour(Polar* pol, int dist);
+  bool FindNearestBlob(Polar* pol, int dist);
   bool FindContourFromInside(Polar* p);
   bool GetTarget(Polar* pol, int dist);
   void RefreshTarget(int dist);
+  bool StartUpdate(ExtendedPosition own_pos);
+  void FinishUpdate(int dist, ExtendedPosition own_pos);
+  bool GetSearchBox(int dist, SectorBox* box, Polar* at);
+  void Commit();
   void PassARPAtoOCPN(Polar* p, OCPN_target_status s);
   void SetStatusLost();
   void ResetPixels();
@@ -103,7 +116,7 @@ class ArpaTarget {
  private:
   RadarInfo* m_ri;
   radar_pi* m_pi;
-  KalmanFilter* m_kalman;
+  KalmanBatch* m_kalman;  // RadarArpa::m_kalman, the filter of this target is number m_slot
   int m_target_id;
   target_status m_status;
   // radar position at time of last target fix, the polars in the contour refer to this origin
@@ -117,46 +130,143 @@ class ArpaTarget {
   bool m_check_for_duplicate;
   TargetProcessStatus m_pass1_result;
   PassN m_pass_nr;
-  Polar m_contour[MAX_CONTOUR_LENGTH + 1];  // contour of target, only valid immediately after finding it
-  int m_contour_length;
+  int m_slot;            // index in RadarArpa::m_pool, stays the same while the target lives
+  int m_contour_length;  // 0 when there is no contour to draw, the contour is kept in RadarArpa::m_contours
   Polar m_max_angle, m_min_angle, m_max_r, m_min_r;  // charasterictics of contour
   Polar m_expected;
   bool m_automatic;  // True for ARPA, false for MARPA.
 
+  // Kept by StartUpdate() for FinishUpdate()
+  ExtendedPosition m_prev_position;  // position before the refresh
+  wxLongLong m_prev_refresh;         //
+  LocalPosition m_predicted;         // local position, predicted by the Kalman filter in between
+  double m_delta_t;                  // seconds since the previous position
+
+  // What FinishUpdate() leaves for Commit(), which does it in the order of the targets
+  bool m_new_id;                     // give the target the next id
+  bool m_send;                       // send the target to OCPN, unless an AIS target is there
+  Polar m_send_pol;                  //
+  OCPN_target_status m_send_status;  //
+  wxArrayString m_nmea;              // sentences for OCPN, queued in RadarArpa::m_nmea
+
+  // Scratch space of FindNearestBlob(), kept so a refresh does not allocate
+  std::vector<uint32_t> m_near_blobs;  // the blobs within reach, newest first
+  std::vector<uint32_t> m_rejected;    // the ones whose contour turned out too short
+
   ExtendedPosition Polar2Pos(Polar pol, ExtendedPosition own_ship);
   Polar Pos2Polar(ExtendedPosition p, ExtendedPosition own_ship);
 };
 
+// What the renderer needs of one target, copied by the tracker after each refresh
+struct ArpaDrawTarget {
+  GeoPosition radar_pos;  // radar position at time of last target fix, the contour refers to this origin
+  size_t first;           // index of the first point of the contour in ArpaDrawTargets::contour
+  int length;             // number of points in the contour
+};
+
+struct ArpaDrawTargets {
+  std::vector<ArpaDrawTarget> targets;
+  std::vector<Polar> contour;
+};
+
 class RadarArpa {
+  friend class ArpaTarget;  // Allow ArpaTarget to store its contour
+
  public:
   RadarArpa(radar_pi* pi, RadarInfo* ri);
   ~RadarArpa();
   void DrawArpaTargetsOverlay(double scale, double arpa_rotate);
   void DrawArpaTargetsPanel(double scale, double arpa_rotate);
+  void WakeTracker() {
+    if (m_tracker) {
+      m_tracker->Wake();
+    }
+  }
+  void TrackTargets();
   void RefreshArpaTargets();
   int AcquireNewARPATarget(Polar pol, int status);
   void AcquireNewMARPATarget(ExtendedPosition p);
   void DeleteTarget(ExtendedPosition p);
-  bool MultiPix(int ang, int rad);
   void DeleteAllTargets();
   void CleanUpLostTargets();
   void RadarLost() {
     DeleteAllTargets();  // Let ARPA targets disappear
   }
   void ClearContours();
+  void PushNMEA();
   int GetTargetCount() { return m_number_of_targets; }
 
  private:
-  int m_number_of_targets;
-  ArpaTarget* m_targets[MAX_NUMBER_OF_TARGETS];
+  // The targets in the order in which they were acquired. Lost targets are kept in m_pool for
+  // reuse, as constructing one is expensive; a target's slot is its index in m_pool.
+  std::vector<ArpaTarget*> m_targets;
+  std::vector<ArpaTarget*> m_pool;
+  std::vector<int> m_free_slots;
+  int m_number_of_targets;  // m_targets.size(), also read by other threads
+  ContourArena m_contours;  // contours of the targets by slot, see PublishTargets()
+  KalmanBatch m_kalman;     // Kalman filters of the targets by slot
+  std::vector<TargetGridPoint> m_grid_points;
+  TargetGrid m_grid;               // positions of the targets, see DeleteMarkedTargets()
+  volatile bool m_clear_contours;  // set by ClearContours(), handled by the tracker
 
   radar_pi* m_pi;
   RadarInfo* m_ri;
 
+  // The thread that refreshes the targets, woken by the spoke process thread ARPA_TRACKS_PER_SWEEP
+  // times per revolution, so that tracking does not depend on (or slow down) the drawing of the chart.
+  WorkerMethod<RadarArpa> m_track_task;
+  WorkerThread* m_tracker;
+  wxCriticalSection m_targets_lock;   // Protects m_targets, held by the tracker while it refreshes them
+  wxCriticalSection m_contours_lock;  // Protects m_contours while the targets are refreshed in parallel
+  wxCriticalSection m_nmea_lock;      // Protects m_nmea
+  wxArrayString m_nmea;               // Sentences of the targets, passed to OCPN on the GUI thread by PushNMEA()
+
+  // A refresh pass splits the targets in groups that touch different cells of the history, see
+  // SectorPartition. The groups are refreshed by the tracker and the helpers, each taking the next
+  // group in m_group_order until there are none left.
+  WorkerMethod<RadarArpa> m_refresh_task;
+  std::vector<WorkerThread*> m_helpers;
+  wxSemaphore m_helpers_done;
+  SectorPartition* m_sectors;
+  size_t m_sectors_spoke_len;
+  std::vector<ArpaTarget*> m_pass_targets;   // the targets that are refreshed in this pass
+  std::vector<int> m_predict_slots;          // their Kalman filters, which predict at once
+  std::vector<LocalPosition> m_predict_x;    //
+  std::vector<double> m_predict_delta_t;     //
+  std::vector<int> m_groups;                 // group of each of m_pass_targets
+  std::vector<size_t> m_group_first;         // m_group_targets[m_group_first[g]..m_group_first[g + 1]> are in group g
+  std::vector<ArpaTarget*> m_group_targets;  //
+  std::vector<int> m_group_order;            // largest groups first
+  std::vector<uint8_t> m_blob_sectors;       // sectors of the history blobs near the targets
+  std::vector<uint32_t> m_near_blobs;        // the blobs in them, newest first
+  std::atomic<size_t> m_next_group;          // index in m_group_order of the next group to refresh
+  int m_pass_dist;
+  ExtendedPosition m_pass_own_pos;
+
+  // Refresh wall time, logged once per sweep
+  wxLongLong m_refresh_usec;
+  int m_refresh_count;
+  size_t m_refresh_groups;
+  wxLongLong m_lock_usec;      // time that m_ri->m_exclusive was held, which stalls the spoke process thread
+  wxLongLong m_lock_max_usec;  // longest single hold
+
+  // The targets as last refreshed, for drawing. The tracker fills the back buffer and then swaps
+  // it with the front one, which is only read under m_draw_lock.
+  wxCriticalSection m_draw_lock;
+  ArpaDrawTargets m_draw[2];
+  int m_draw_front;
+
+  bool IsArpaOn();
+  ArpaTarget* NewTarget();
+  void DeleteMarkedTargets();
+  void RefreshPass(PassN pass, int dist);
+  size_t PartitionTargets();
+  void CountLockHeld(wxLongLong locked);
+  void RefreshGroups();
+  void PublishTargets();
   void AcquireOrDeleteMarpaTarget(ExtendedPosition p, int status);
   void CalculateCentroid(ArpaTarget* t);
-  void DrawContour(ArpaTarget* t);
-  bool Pix(int ang, int rad);
+  void DrawContour(const Polar* contour, int length);
 };
 
 PLUGIN_END_NAMESPACE
@@ -0,0 +1,258 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "RadarReactor.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define REACTOR_EVENTS (16)  // Max # of events handled per wakeup
+
+static void CloseFd(int fd) {
+#ifdef __linux__
+  close(fd);
+#endif
+}
+
+RadarReactor::RadarReactor() : wxThread(wxTHREAD_JOINABLE) {
+  Create(1024 * 1024);  // Same stack size as the receive threads it replaces
+  m_epoll = -1;
+  m_wakeup = -1;
+  m_shutdown = false;
+}
+
+RadarReactor::~RadarReactor() {
+  for (size_t i = 0; i < m_registrations.size(); i++) {
+    if (m_registrations[i]->timer >= 0) {
+      CloseFd(m_registrations[i]->fd);
+    }
+    delete m_registrations[i];
+  }
+  for (size_t i = 0; i < m_removed.size(); i++) {
+    delete m_removed[i];
+  }
+  if (m_wakeup >= 0) {
+    CloseFd(m_wakeup);
+  }
+  if (m_epoll >= 0) {
+    CloseFd(m_epoll);
+  }
+}
+
+bool RadarReactor::Init() {
+#ifdef __linux__
+  m_epoll = epoll_create1(EPOLL_CLOEXEC);
+  m_wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_epoll < 0 || m_wakeup < 0) {
+    wxLogError(wxT("radar_pi: Unable to create reactor: %s"), wxString::FromAscii(strerror(errno)));
+    return false;
+  }
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = 0;  // The only event without a Registration
+  if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &ev) < 0) {
+    wxLogError(wxT("radar_pi: Unable to create reactor: %s"), wxString::FromAscii(strerror(errno)));
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void RadarReactor::Shutdown() {
+  m_shutdown = true;
+#ifdef __linux__
+  uint64_t one = 1;
+  if (m_wakeup >= 0 && write(m_wakeup, &one, sizeof(one)) != sizeof(one)) {
+    LOG_INFO(wxT("radar_pi: reactor thread will take long time to stop"));
+  }
+#endif
+}
+
+bool RadarReactor::Add(Registration *reg) {
+#ifdef __linux__
+  wxCriticalSectionLocker lock(m_lock);
+  struct epoll_event ev;
+
+  ev.events = EPOLLIN;
+  ev.data.ptr = reg;
+  if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, reg->fd, &ev) == 0) {
+    m_registrations.push_back(reg);
+    return true;
+  }
+  wxLogError(wxT("radar_pi: reactor cannot watch fd %d: %s"), reg->fd, wxString::FromAscii(strerror(errno)));
+#endif
+  if (reg->timer >= 0) {
+    CloseFd(reg->fd);
+  }
+  delete reg;
+  return false;
+}
+
+// Called with m_lock held
+void RadarReactor::Remove(size_t i) {
+  Registration *reg = m_registrations[i];
+
+#ifdef __linux__
+  epoll_ctl(m_epoll, EPOLL_CTL_DEL, reg->fd, 0);
+#endif
+  if (reg->timer >= 0) {
+    CloseFd(reg->fd);
+  }
+  reg->removed = true;
+  m_removed.push_back(reg);
+  m_registrations.erase(m_registrations.begin() + i);
+}
+
+bool RadarReactor::AddSocket(ReactorHandler *handler, SOCKET socket) {
+  if (socket == INVALID_SOCKET) {
+    return false;
+  }
+
+  Registration *reg = new Registration;
+  reg->handler = handler;
+  reg->fd = socket;
+  reg->timer = -1;
+  reg->removed = false;
+  return Add(reg);
+}
+
+void RadarReactor::RemoveSocket(SOCKET socket) {
+  wxCriticalSectionLocker lock(m_lock);
+
+  for (size_t i = 0; i < m_registrations.size(); i++) {
+    if (m_registrations[i]->timer < 0 && m_registrations[i]->fd == socket) {
+      Remove(i);
+      return;
+    }
+  }
+}
+
+bool RadarReactor::AddTimer(ReactorHandler *handler, int timer, int millis) {
+#ifdef __linux__
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (fd < 0) {
+    wxLogError(wxT("radar_pi: reactor cannot create timer: %s"), wxString::FromAscii(strerror(errno)));
+    return false;
+  }
+
+  struct itimerspec spec;
+  spec.it_interval.tv_sec = millis / MILLISECONDS_PER_SECOND;
+  spec.it_interval.tv_nsec = (millis % MILLISECONDS_PER_SECOND) * 1000000;
+  spec.it_value = spec.it_interval;
+  if (timerfd_settime(fd, 0, &spec, 0) < 0) {
+    wxLogError(wxT("radar_pi: reactor cannot start timer: %s"), wxString::FromAscii(strerror(errno)));
+    close(fd);
+    return false;
+  }
+
+  Registration *reg = new Registration;
+  reg->handler = handler;
+  reg->fd = fd;
+  reg->timer = timer;
+  reg->removed = false;
+  return Add(reg);
+#else
+  return false;
+#endif
+}
+
+void RadarReactor::RemoveHandler(ReactorHandler *handler) {
+  wxCriticalSectionLocker lock(m_lock);  // Waits for a running dispatch to finish
+
+  for (size_t i = m_registrations.size(); i > 0; i--) {
+    if (m_registrations[i - 1]->handler == handler) {
+      Remove(i - 1);
+    }
+  }
+}
+
+/*
+ * Entry
+ *
+ * Called by wxThread when the new thread is running.
+ * It should remain running until Shutdown is called.
+ */
+void *RadarReactor::Entry(void) {
+  LOG_VERBOSE(wxT("radar_pi: reactor thread starting"));
+
+#ifdef __linux__
+  struct epoll_event events[REACTOR_EVENTS];
+
+  while (!m_shutdown) {
+    int n = epoll_wait(m_epoll, events, REACTOR_EVENTS, -1);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      wxLogError(wxT("radar_pi: reactor wait failed: %s"), wxString::FromAscii(strerror(errno)));
+      break;
+    }
+
+    wxCriticalSectionLocker lock(m_lock);
+    for (int i = 0; i < n && !m_shutdown; i++) {
+      Registration *reg = (Registration *)events[i].data.ptr;
+
+      if (!reg || reg->removed) {  // Wake up, or removed by an earlier handler in this batch
+        continue;
+      }
+      if (reg->timer >= 0) {
+        uint64_t expirations;
+        // Several missed expirations still lead to a single call
+        if (read(reg->fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+          reg->handler->OnTimer(reg->timer);
+        }
+      } else {
+        reg->handler->OnReadable(reg->fd);
+      }
+    }
+
+    for (size_t i = 0; i < m_removed.size(); i++) {
+      delete m_removed[i];
+    }
+    m_removed.clear();
+  }
+#endif
+
+  LOG_VERBOSE(wxT("radar_pi: reactor thread stopping"));
+  return 0;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,107 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _RADAR_REACTOR_H_
+#define _RADAR_REACTOR_H_
+
+#include <vector>
+
+#include "radar_pi.h"
+#include "socketutil.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Something that wants to be told when one of its sockets is readable or one of
+// its timers expired. Called on the RadarReactor thread, one call at a time.
+//
+class ReactorHandler {
+ public:
+  virtual ~ReactorHandler() {}
+
+  virtual void OnReadable(SOCKET socket) = 0;
+  virtual void OnTimer(int timer) = 0;
+};
+
+//
+// A single thread that waits for all radar data, report and locate sockets at
+// once, instead of one thread per radar plus one for NavicoLocate that each wake up
+// four times a second just to find out that nothing happened.
+//
+// Uses epoll, with a timerfd per timer and an eventfd to stop the thread, so it is
+// only available on Linux. On other platforms Init() returns false and the caller
+// should keep using the receive threads.
+//
+// Handlers may add and remove their own sockets from within OnReadable() and
+// OnTimer(). Other threads must only call AddTimer(), AddSocket() and RemoveHandler().
+//
+class RadarReactor : public wxThread {
+ public:
+  RadarReactor();
+  ~RadarReactor();
+
+  // Create the epoll set. Returns false if the reactor can't be used on this system.
+  bool Init();
+
+  void *Entry(void);
+  void Shutdown(void);
+
+  bool AddSocket(ReactorHandler *handler, SOCKET socket);
+  void RemoveSocket(SOCKET socket);
+  bool AddTimer(ReactorHandler *handler, int timer, int millis);
+
+  // Remove all sockets and timers of 'handler'. When this returns the handler is
+  // not being called and won't be called again, so it can be deleted.
+  void RemoveHandler(ReactorHandler *handler);
+
+ private:
+  struct Registration {
+    ReactorHandler *handler;
+    int fd;        // The socket, or the timerfd that we own
+    int timer;     // The handler's timer id, or -1 for a socket
+    bool removed;  // Still referenced by epoll events being dispatched
+  };
+
+  bool Add(Registration *reg);
+  void Remove(size_t i);
+
+  wxCriticalSection m_lock;                    // Held while dispatching, protects the vectors
+  std::vector<Registration *> m_registrations;
+  std::vector<Registration *> m_removed;       // Freed once the current batch of events is done
+  int m_epoll;
+  int m_wakeup;  // eventfd that interrupts epoll_wait on Shutdown()
+  volatile bool m_shutdown;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _RADAR_REACTOR_H_ */
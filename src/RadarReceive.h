@@ -32,10 +32,13 @@
 #ifndef _RADARRECEIVE_H_
 #define _RADARRECEIVE_H_
 
+#include "PacketRecorder.h"
 #include "RadarControl.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
+class RadarReactor;
+
 //
 // The base class for a specific implementation of a thread
 // that receives data from a radar.
@@ -47,9 +50,15 @@ class RadarReceive : public wxThread {
     Create(1024 * 1024);  // Stack size, be liberal
     m_pi = pi;            // This allows you to access the main plugin stuff
     m_ri = ri;            // and this the per-radar stuff
+    m_recorder = PacketRecorder::Create(pi, ri);  // 0 unless recording is enabled
   }
 
-  virtual ~RadarReceive() {}
+  virtual ~RadarReceive() {
+    if (m_recorder) {
+      delete m_recorder;
+      m_recorder = 0;
+    }
+  }
 
   virtual void *Entry(void) = 0;
 
@@ -73,9 +82,47 @@ class RadarReceive : public wxThread {
    */
   virtual void Shutdown(void) = 0;
 
+  /*
+   * Attach
+   *
+   * Receive on the shared RadarReactor thread instead of running this thread.
+   * Returns false if this radar type does not support that; the caller should
+   * then Run() the thread as usual.
+   */
+  virtual bool Attach(RadarReactor *reactor) { return false; }
+
+  /*
+   * Detach
+   *
+   * The reactor equivalent of Shutdown() + Wait(): stop receiving and close all sockets.
+   */
+  virtual void Detach(void) {}
+
+  /*
+   * ProcessPacket
+   *
+   * Decode a single datagram as if it was received on the data or report socket.
+   * Used by ReplayReceive to run recorded packets through the real decoder, on the
+   * replay thread; this object's own thread is then never started.
+   */
+  virtual void ProcessPacket(RecordSocketRole role, const uint8_t *data, size_t len) {}
+
  protected:
+  /*
+   * RecordPacket
+   *
+   * Called by the receive thread for every datagram received on the data or report
+   * socket, before it is processed. Writes it to the capture file when recording.
+   */
+  void RecordPacket(RecordSocketRole role, const uint8_t *data, size_t len) {
+    if (m_recorder) {
+      m_recorder->Record(role, data, len);
+    }
+  }
+
   radar_pi *m_pi;
   RadarInfo *m_ri;
+  PacketRecorder *m_recorder;
 };
 
 PLUGIN_END_NAMESPACE
@@ -52,6 +52,8 @@
 #include "emulator/EmulatorControlsDialog.h"
 #include "emulator/EmulatorReceive.h"
 
+#include "replay/ReplayReceive.h"
+
 #endif /* _RADARTYPE_H_ */
 
 #define DEFINE_RADAR(t, x, s, l, a, b, c, d)
@@ -97,6 +99,8 @@
 
 // TODO: Add Garmin etc.
 
+#include "replay/replaytype.h"
+
 #include "emulator/emulatortype.h"
 
 #undef DEFINE_RADAR  // Prepare for next inclusion
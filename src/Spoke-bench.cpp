@@ -0,0 +1,826 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+//
+// Micro-benchmark for the per-spoke kernels in radar_core.
+//
+// Every kernel is run over a full revolution of synthetic spokes, repeatedly,
+// until at least the minimum time has passed. The result is printed as one
+// JSON object per line on stdout so that runs can be compared by a script:
+//
+//   spoke-bench [min_ms] [kernel]
+//
+// This only measures; spoke-test checks that the kernels give the right results.
+//
+// 'history' is the single threshold pass that fills the ARPA history and the guard
+// zone row; 'history_legacy' and 'guard_zone_legacy' are the separate byte loops it
+// replaced.
+//
+// 'guard_zones' counts BENCH_GUARD_ZONES overlapping zones in every spoke from one
+// count of the guard row; 'guard_zones_separate' counts each zone on its own.
+//
+// The '_legacy' trails kernels keep an age per cell that is incremented on every
+// pass, as the trails did before they were stamped with the revolution.
+//
+// 'zoom_trails' zooms one part of the trails per spoke, so a revolution is one complete
+// ZoomTrails() on one thread; 'zoom_trails_legacy' is the loop with the per cell
+// coordinate computation that it replaced.
+//
+// 'process_spoke' runs the kernels in the order RadarInfo::ProcessRadarSpoke()
+// calls them, so it approximates the cost of one spoke in the process thread.
+//
+// 'contour' follows a blob contour through the history the way the ARPA code does;
+// 'contour_legacy' does the same on the old layout of one byte per range cell in one
+// allocation per history line, which 'history_legacy' fills.
+//
+// 'blobs' labels the blobs in the history spoke by spoke, as ARPA does now instead of
+// following the contours of all blobs that it finds in the guard zones.
+//
+// 'target_store' stores the contour of one of BENCH_TARGETS targets per spoke and looks up
+// the target nearest to it, rebuilding the grid once per BENCH_TARGETS spokes; so
+// BENCH_TARGETS spokes approximate the store work of one refresh of that many targets.
+//
+// 'sector_partition' groups BENCH_TARGETS targets by the echoes they may touch, as ARPA does
+// before it refreshes them on several threads, ARPA_TRACKS_PER_SWEEP times per revolution.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "core/HistoryBlobs.h"
+#include "core/PolarLookup.h"
+#include "core/SectorPartition.h"
+#include "core/SpokeDecode.h"
+#include "core/SpokeHistory.h"
+#include "core/SpokeKernels.h"
+#include "core/TargetStore.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define THRESHOLD_BLUE 50
+#define THRESHOLD_GREEN 100
+#define THRESHOLD_RED 200
+#define TRAIL_AGE_MAX 241
+#define COLOUR_WEAK 1
+#define COLOUR_INTERMEDIATE 2
+#define COLOUR_STRONG 3
+#define COLOUR_TRAIL 4
+#define ZOOM_FACTOR 1.25f
+#define BENCH_GUARD_ZONES 16
+#define CONTOUR_LENGTH_MAX 601  // MAX_CONTOUR_LENGTH in RadarMarpa.h
+#define BENCH_TARGETS 1000
+#define BENCH_TRACKS_PER_SWEEP 16   // ARPA_TRACKS_PER_SWEEP in RadarMarpa.h
+#define BENCH_SEARCH_RADIUS 15      // TARGET_SEARCH_RADIUS2 in RadarMarpa.h
+#define BENCH_SECTOR_MARGIN 5       // DISTANCE_BETWEEN_TARGETS + 1 in RadarMarpa.h
+
+struct Geometry {
+  const char *name;
+  size_t spokes;
+  size_t spoke_len;
+};
+
+static const Geometry geometries[] = {
+    {"navico", 2048, 1024},
+    {"garmin_xhd", 1440, 705},
+    {"garmin_hd", 720, 2016},
+};
+
+enum Fixture { FIXTURE_SPARSE, FIXTURE_DENSE, FIXTURE_CLUTTER, FIXTURE_COUNT };
+
+static const char *fixture_names[FIXTURE_COUNT] = {"sparse", "dense", "clutter"};
+
+// Deterministic so that runs on different machines see the same data
+static uint32_t random_state;
+
+static uint32_t Random() {
+  random_state = random_state * 1103515245 + 12345;
+  return (random_state >> 8) & 0xffff;
+}
+
+//
+// Fill 'spokes' * 'spoke_len' samples with one of the fixture patterns:
+// sparse:  a few small targets on an empty screen
+// dense:   large land masses, long runs of strong returns
+// clutter: sea clutter near the radar, noise around the lowest threshold
+//
+static void MakeFixture(Fixture fixture, uint8_t *data, size_t spokes, size_t spoke_len) {
+  random_state = 42 + (uint32_t)fixture;
+  memset(data, 0, spokes * spoke_len);
+
+  for (size_t s = 0; s < spokes; s++) {
+    uint8_t *line = data + s * spoke_len;
+
+    switch (fixture) {
+      case FIXTURE_SPARSE:
+        for (size_t target = 0; target < 8; target++) {
+          size_t r = (target * 2654435761u + s / 16 * 40503u) % spoke_len;
+          for (size_t i = r; i < r + 4 && i < spoke_len; i++) {
+            line[i] = THRESHOLD_RED + (uint8_t)(Random() % 50);
+          }
+        }
+        break;
+
+      case FIXTURE_DENSE:
+        for (size_t r = 0; r < spoke_len; r++) {
+          size_t band = (r / 64 + s / 32) % 3;
+          line[r] = band == 0 ? 0 : band == 1 ? THRESHOLD_GREEN + Random() % 50 : THRESHOLD_RED + Random() % 50;
+        }
+        break;
+
+      case FIXTURE_CLUTTER:
+        for (size_t r = 0; r < spoke_len; r++) {
+          uint32_t level = Random() % (r < spoke_len / 4 ? 256 : 80);
+          line[r] = (uint8_t)level;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+
+// How the history was stored before SpokeHistory: one byte per range cell, with
+// bit 7 (HISTORY_TARGET) and bit 6 (HISTORY_DUPLICATE) set for samples >= threshold.
+static size_t LegacyCountAbove(const uint8_t *data, size_t start, size_t end, uint8_t threshold) {
+  size_t count = 0;
+
+  for (size_t r = start; r <= end; r++) {
+    if (data[r] >= threshold) {
+      count++;
+    }
+  }
+  return count;
+}
+
+static void LegacyToHistory(uint8_t *hist, size_t spoke_len_max, const uint8_t *data, size_t len, uint8_t threshold) {
+  memset(hist, 0, spoke_len_max);
+  for (size_t radius = 0; radius < len; radius++) {
+    if (data[radius] >= threshold) {
+      hist[radius] = 192;
+    }
+  }
+}
+
+// How the trails were kept before TrailStamp: an age per cell, incremented on every pass.
+static void LegacyTrailsRelative(uint8_t *trail, size_t spoke_len_max, uint8_t *data, size_t len, const TrailUpdate &update) {
+  int radius = 0;
+  int length = int(len);
+
+  for (; radius < length - 1; radius++, trail++) {
+    if (data[radius] >= update.strong) {
+      *trail = 1;
+    } else if (*trail > 0 && *trail < update.max_age) {
+      (*trail)++;
+    }
+    if (update.colour && (data[radius] < update.weak)) {
+      data[radius] = update.colour[*trail];
+    }
+  }
+  for (; radius < (int)spoke_len_max; radius++, trail++) {
+    *trail = 0;
+  }
+}
+
+static void LegacyTrailsTrue(uint8_t *trails, int trail_size, int offset_x, int offset_y, const PointIntRow &points,
+                             size_t spoke_len_max, uint8_t *data, size_t len, const TrailUpdate &update) {
+  size_t radius = 0;
+
+  for (; radius < len - 1; radius++) {
+    PointInt point = points.Get(radius);
+
+    point.x += offset_x;
+    point.y += offset_y;
+    if (point.x >= 0 && point.x < trail_size && point.y >= 0 && point.y < trail_size) {
+      uint8_t *trail = &trails[point.x * trail_size + point.y];
+      if (data[radius] >= update.strong) {
+        *trail = 1;
+      } else if (*trail > 0 && *trail < update.max_age) {
+        (*trail)++;
+      }
+      if (update.colour && (data[radius] < update.weak)) {
+        data[radius] = update.colour[*trail];
+      }
+    }
+  }
+  for (; radius < spoke_len_max; radius++) {
+    PointInt point = points.Get(radius);
+
+    point.x += offset_x;
+    point.y += offset_y;
+    if (point.x >= 0 && point.x < trail_size && point.y >= 0 && point.y < trail_size) {
+      uint8_t *trail = &trails[point.x * trail_size + trail_size + point.y];
+      if (*trail > 0 && *trail < update.max_age) {
+        (*trail)++;
+      }
+    }
+  }
+}
+
+static int LegacyWrap(int pixel, int trail_size) { return ((pixel % trail_size) + trail_size) % trail_size; }
+
+static void LegacyZoomRelative(TrailStamp *dst, const TrailStamp *src, int spoke_len_max, float zoom_factor) {
+  for (int j = 0; j < spoke_len_max; j++) {
+    int index_j = j * zoom_factor;
+    if (index_j >= spoke_len_max) break;
+    if (src[j] != 0) {
+      dst[index_j] = src[j];
+    }
+  }
+}
+
+// Zooms the source rows [first..end> of the true trails, without clearing 'dst'
+static void LegacyZoomTrue(TrailStamp *dst, const TrailStamp *src, int trail_size, int offset_x, int offset_y,
+                           float zoom_factor, int first, int end) {
+  for (int i = first; i < end; i++) {
+    int index_i = (int)(((double)i - (double)trail_size / 2) * zoom_factor + (double)trail_size / 2);
+    if (index_i >= trail_size - 1) {
+      break;
+    }
+    if (index_i < 0) {
+      continue;
+    }
+    int x = LegacyWrap(i - trail_size / 2 + offset_x, trail_size);
+    int new_x = LegacyWrap(index_i - trail_size / 2 + offset_x, trail_size);
+    int next_x = LegacyWrap(new_x + 1, trail_size);
+
+    for (int j = 100; j < trail_size - 100; j++) {
+      int index_j = (int)(((double)j - (double)trail_size / 2) * zoom_factor + (double)trail_size / 2);
+      if (index_j >= trail_size - 1) {
+        break;
+      }
+      if (index_j < 0) {
+        continue;
+      }
+      TrailStamp pixel = src[x * trail_size + LegacyWrap(j - trail_size / 2 + offset_y, trail_size)];
+      if (pixel != 0) {
+        int new_y = LegacyWrap(index_j - trail_size / 2 + offset_y, trail_size);
+        int next_y = LegacyWrap(new_y + 1, trail_size);
+
+        dst[new_x * trail_size + new_y] = pixel;
+        if (zoom_factor > 1.2) {
+          dst[new_x * trail_size + next_y] = pixel;
+          if (zoom_factor > 1.6) {
+            dst[next_x * trail_size + new_y] = pixel;
+            dst[next_x * trail_size + next_y] = pixel;
+          }
+        }
+      }
+    }
+  }
+}
+
+struct LegacyLine {
+  uint8_t *line;
+  int64_t time;
+  GeoPosition pos;
+};
+
+struct Bench {
+  const Geometry *geometry;
+  Fixture fixture;
+  std::vector<uint8_t> spokes;          // Unpacked samples, spokes * spoke_len
+  std::vector<uint8_t> navico;          // Navico packed samples, 4 bits per sample
+  std::vector<uint8_t> garmin_hd;       // Garmin HD packed samples, 1 bit per sample
+  std::vector<uint8_t> work;            // One spoke that the kernels may modify
+  SpokeHistory *history;
+  HistoryBlobs *history_blobs;
+  ContourArena *contours;
+  TargetGrid *grid;
+  std::vector<TargetGridPoint> targets;  // BENCH_TARGETS
+  std::vector<Polar> contour;           // CONTOUR_LENGTH_MAX
+  SectorPartition *sectors;
+  std::vector<SectorBox> search_boxes;  // BENCH_TARGETS
+  std::vector<Polar> search_at;         // BENCH_TARGETS, the expected position in each box
+  std::vector<HistoryBlob> sector_blobs;
+  std::vector<int> groups;
+  std::vector<LegacyLine> legacy;       // The same history, one allocation per line
+  std::vector<uint64_t> guard;          // Guard zone rows, spokes * history->GetWords()
+  std::vector<uint32_t> guard_counts;   // history->GetWords() + 1
+  std::vector<TrailStamp> relative;     // Relative trails, spokes * spoke_len
+  std::vector<TrailStamp> true_trails;  // True trails, trail_size * trail_size
+  std::vector<uint8_t> relative_ages;   // The same trails as an age per cell
+  std::vector<uint8_t> true_ages;       // The same trails as an age per cell
+  std::vector<TrailStamp> zoomed;       // Zoomed true trails, trail_size * trail_size
+  std::vector<int> zoom_index;          // Rows and columns maps, 6 * trail_size, and radius map, spoke_len
+  TrailZoomMap zoom_rows;
+  TrailZoomMap zoom_columns;
+  size_t zoom_radius_len;
+  std::vector<uint8_t> texture;         // RGBA texture, spokes * spoke_len * 4
+  std::vector<SpokeBlob> blobs;         // spoke_len
+  PolarToCartesianLookup *lookup;
+  int trail_size;
+  uint8_t colour_map[UINT8_MAX + 1];
+  uint8_t trail_colour[TRAIL_AGE_MAX + 1];
+  uint8_t rgba[UINT8_MAX + 1][4];
+  TrailUpdate update;
+  uint64_t check;  // Keeps the optimizer from removing the work
+};
+
+static void InitBench(Bench &b, const Geometry *geometry, Fixture fixture) {
+  size_t n = geometry->spokes * geometry->spoke_len;
+
+  b.geometry = geometry;
+  b.fixture = fixture;
+  b.spokes.resize(n);
+  MakeFixture(fixture, b.spokes.data(), geometry->spokes, geometry->spoke_len);
+
+  b.navico.resize(n / 2);
+  for (size_t i = 0; i < n / 2; i++) {
+    b.navico[i] = (b.spokes[2 * i] >> 4) | (b.spokes[2 * i + 1] & 0xf0);
+  }
+  b.garmin_hd.resize(n / 8);
+  for (size_t i = 0; i < n / 8; i++) {
+    uint8_t bits = 0;
+    for (int bit = 0; bit < 8; bit++) {
+      if (b.spokes[8 * i + bit] >= THRESHOLD_GREEN) {
+        bits |= 1 << bit;
+      }
+    }
+    b.garmin_hd[i] = bits;
+  }
+
+  b.work.resize(geometry->spoke_len);
+  b.history = new SpokeHistory(geometry->spokes, geometry->spoke_len);
+  b.legacy.resize(geometry->spokes);
+  for (size_t s = 0; s < geometry->spokes; s++) {
+    const uint8_t *data = b.spokes.data() + s * geometry->spoke_len;
+    b.legacy[s].line = (uint8_t *)calloc(geometry->spoke_len, 1);
+    b.legacy[s].time = (int64_t)s;
+    b.legacy[s].pos.lat = 0.;
+    b.legacy[s].pos.lon = 0.;
+    LegacyToHistory(b.legacy[s].line, geometry->spoke_len, data, geometry->spoke_len, THRESHOLD_RED);
+    b.history->SetSpoke(s, data, geometry->spoke_len, THRESHOLD_RED, THRESHOLD_BLUE);
+    b.history->Time(s) = (int64_t)s;
+    b.guard.insert(b.guard.end(), b.history->GuardRow(), b.history->GuardRow() + b.history->GetWords());
+  }
+  b.guard_counts.assign(b.history->GetWords() + 1, 0);
+  b.history_blobs = new HistoryBlobs(geometry->spokes, geometry->spoke_len);
+  b.history_blobs->SetMinContourLength(2);
+  b.contours = new ContourArena();
+  b.grid = new TargetGrid();
+  b.targets.resize(BENCH_TARGETS);
+  for (int t = 0; t < BENCH_TARGETS; t++) {  // Spread over 24 x 24 km, as in a crowded anchorage at long range
+    b.targets[t].x = (double)(Random() % 24000);
+    b.targets[t].y = (double)(Random() % 24000);
+    b.targets[t].id = t;
+  }
+  b.contour.resize(CONTOUR_LENGTH_MAX);
+  for (int i = 0; i < CONTOUR_LENGTH_MAX; i++) {
+    b.contour[i].angle = i;
+    b.contour[i].r = i;
+    b.contour[i].time = i;
+  }
+  b.sectors = new SectorPartition(geometry->spokes, geometry->spoke_len, BENCH_SECTOR_MARGIN);
+  for (int t = 0; t < BENCH_TARGETS; t++) {  // Search boxes as ArpaTarget::GetSearchBox() makes them in pass 2
+    int angle = (int)(Random() % geometry->spokes);
+    int r = 40 + (int)(Random() % (geometry->spoke_len - 80));
+    int reach = (BENCH_SEARCH_RADIUS + 1) * 326 / (r - 2) + 3;
+    SectorBox box = {angle - reach, angle + reach, r - BENCH_SEARCH_RADIUS - 3, r + BENCH_SEARCH_RADIUS + 3};
+    Polar at = {angle, r, 0};
+    b.search_boxes.push_back(box);
+    b.search_at.push_back(at);
+  }
+  HistoryBlobs sector_blobs(geometry->spokes, geometry->spoke_len);
+  sector_blobs.SetMinContourLength(2);
+  for (size_t s = 0; s < geometry->spokes; s++) {
+    sector_blobs.AddSpoke(s, b.history->Row(HISTORY_TARGET, s), b.history->Time(s));
+  }
+  for (uint32_t n = sector_blobs.GetBegin(); n != sector_blobs.GetEnd(); n++) {
+    b.sector_blobs.push_back(sector_blobs.Get(n));
+  }
+  b.relative.assign(n, 0);
+  b.trail_size = (int)geometry->spoke_len * 2 + 2 * 100;
+  b.true_trails.assign((size_t)b.trail_size * b.trail_size + b.trail_size, 0);
+  b.relative_ages.assign(n, 0);
+  b.true_ages.assign((size_t)b.trail_size * b.trail_size + b.trail_size, 0);
+  b.zoomed.assign((size_t)b.trail_size * b.trail_size, 0);
+  b.zoom_index.assign((size_t)b.trail_size * 6 + geometry->spoke_len, 0);
+  b.zoom_rows.source = b.zoom_index.data();
+  b.zoom_rows.target = b.zoom_rows.source + b.trail_size;
+  b.zoom_rows.wrapped = b.zoom_rows.target + b.trail_size;
+  b.zoom_columns.source = b.zoom_rows.wrapped + b.trail_size;
+  b.zoom_columns.target = b.zoom_columns.source + b.trail_size;
+  b.zoom_columns.wrapped = b.zoom_columns.target + b.trail_size;
+  TrailsZoomIndex(b.zoom_rows, b.trail_size, 100, b.trail_size / 3, ZOOM_FACTOR);
+  TrailsZoomIndex(b.zoom_columns, b.trail_size, 100, b.trail_size / 5, ZOOM_FACTOR);
+  b.zoom_radius_len = TrailsZoomRelativeIndex(b.zoom_columns.wrapped + b.trail_size, geometry->spoke_len, ZOOM_FACTOR);
+  b.texture.assign(n * 4, 0);
+  b.blobs.resize(geometry->spoke_len);
+  b.lookup = PolarToCartesianLookup::Acquire(geometry->spokes, geometry->spoke_len);
+
+  for (int i = 0; i <= UINT8_MAX; i++) {
+    b.colour_map[i] = i >= THRESHOLD_RED     ? COLOUR_STRONG
+                      : i >= THRESHOLD_GREEN ? COLOUR_INTERMEDIATE
+                      : i >= THRESHOLD_BLUE  ? COLOUR_WEAK
+                                             : 0;
+    b.rgba[i][0] = (uint8_t)(b.colour_map[i] * 60);
+    b.rgba[i][1] = (uint8_t)(b.colour_map[i] * 30);
+    b.rgba[i][2] = (uint8_t)(b.colour_map[i] * 20);
+    b.rgba[i][3] = b.colour_map[i] ? 255 : 0;
+  }
+  for (int i = 0; i <= TRAIL_AGE_MAX; i++) {
+    b.trail_colour[i] = i > 0 && i < 32 ? COLOUR_TRAIL : 0;
+  }
+  b.update.strong = THRESHOLD_RED;
+  b.update.weak = THRESHOLD_BLUE;
+  b.update.max_age = TRAIL_AGE_MAX;
+  b.update.colour = b.trail_colour;
+  b.update.revolution = 1;
+  b.check = 0;
+}
+
+static void FreeBench(Bench &b) {
+  b.lookup->Release();
+  delete b.history;
+  delete b.history_blobs;
+  delete b.contours;
+  delete b.grid;
+  delete b.sectors;
+  for (size_t s = 0; s < b.legacy.size(); s++) {
+    free(b.legacy[s].line);
+  }
+}
+
+typedef void (*KernelFunction)(Bench &b, size_t spoke);
+
+static void RunNavicoUnpack(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  NavicoUnpackSpoke(b.work.data(), b.navico.data() + spoke * len / 2, len / 2, NAVICO_DOPPLER_OFF);
+  b.check += b.work[spoke % len];
+}
+
+static void RunGarminHDExpand(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  GarminHDExpandSpoke(b.work.data(), b.garmin_hd.data() + spoke * len / 8, len / 8);
+  b.check += b.work[spoke % len];
+}
+
+static void RunHistory(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  b.history->SetSpoke(spoke, b.spokes.data() + spoke * len, len, THRESHOLD_RED, THRESHOLD_BLUE);
+}
+
+static void RunHistoryLegacy(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  LegacyToHistory(b.legacy[spoke].line, len, b.spokes.data() + spoke * len, len, THRESHOLD_RED);
+}
+
+static void RunGuardZone(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  b.check += SpokeBitsCount(b.guard.data() + spoke * b.history->GetWords(), len / 8, len - 1);
+}
+
+static void RunGuardZoneLegacy(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  b.check += LegacyCountAbove(b.spokes.data() + spoke * len, len / 8, len - 1, THRESHOLD_BLUE);
+}
+
+static void RunGuardZones(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  size_t words = b.history->GetWords();
+  const uint64_t *row = b.guard.data() + spoke * words;
+  uint32_t *counts = b.guard_counts.data();
+
+  SpokeBitsPrefix(counts, row, words);
+  for (size_t z = 0; z < BENCH_GUARD_ZONES; z++) {
+    size_t start = len * z / (2 * BENCH_GUARD_ZONES);
+    b.check += SpokeBitsCountPrefix(counts, row, start, start + len / 2 - 1);
+  }
+}
+
+static void RunGuardZonesSeparate(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  const uint64_t *row = b.guard.data() + spoke * b.history->GetWords();
+
+  for (size_t z = 0; z < BENCH_GUARD_ZONES; z++) {
+    size_t start = len * z / (2 * BENCH_GUARD_ZONES);
+    b.check += SpokeBitsCount(row, start, start + len / 2 - 1);
+  }
+}
+
+static void NextRevolution(Bench &b, size_t spoke) {
+  if (spoke == 0) {
+    b.update.revolution = b.update.revolution < TRAIL_STAMPS ? b.update.revolution + 1 : 1;
+  }
+}
+
+static void RunRelativeTrails(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  NextRevolution(b, spoke);
+  memcpy(b.work.data(), b.spokes.data() + spoke * len, len);
+  TrailsUpdateRelative(b.relative.data() + spoke * len, len, b.work.data(), len, b.update);
+  b.check += b.work[spoke % len];
+}
+
+static void RunTrueTrails(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  NextRevolution(b, spoke);
+  memcpy(b.work.data(), b.spokes.data() + spoke * len, len);
+  TrailsUpdateTrue(b.true_trails.data(), b.trail_size, b.trail_size / 2, b.trail_size / 2, b.lookup->GetPointIntRow(spoke),
+                   b.work.data(), len, b.update);
+  b.check += b.work[spoke % len];
+}
+
+static void RunRelativeTrailsLegacy(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  memcpy(b.work.data(), b.spokes.data() + spoke * len, len);
+  LegacyTrailsRelative(b.relative_ages.data() + spoke * len, len, b.work.data(), len, b.update);
+  b.check += b.work[spoke % len];
+}
+
+static void RunTrueTrailsLegacy(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  memcpy(b.work.data(), b.spokes.data() + spoke * len, len);
+  LegacyTrailsTrue(b.true_ages.data(), b.trail_size, b.trail_size / 2, b.trail_size / 2, b.lookup->GetPointIntRow(spoke), len,
+                   b.work.data(), len, b.update);
+  b.check += b.work[spoke % len];
+}
+
+// Both zoom kernels read the trails that the trails kernels left behind and write a copy, so
+// that every run zooms the same image.
+static void RunZoomTrails(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  size_t spokes = b.geometry->spokes;
+  int first = (int)(b.trail_size * spoke / spokes);
+  int end = (int)(b.trail_size * (spoke + 1) / spokes);
+
+  TrailsZoomRelative(b.relative_ages.data(), b.relative.data(), len, spoke, spoke + 1, b.zoom_columns.wrapped + b.trail_size,
+                     b.zoom_radius_len);
+  TrailsZoomTrue(b.zoomed.data(), b.true_trails.data(), b.trail_size, b.trail_size / 3, b.zoom_rows, b.zoom_columns,
+                 ZOOM_FACTOR, first, end);
+  b.check += b.zoomed[(size_t)first * b.trail_size + spoke];
+}
+
+static void RunZoomTrailsLegacy(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  size_t spokes = b.geometry->spokes;
+  int first = (int)(b.trail_size * spoke / spokes);
+  int end = (int)(b.trail_size * (spoke + 1) / spokes);
+
+  memset(b.relative_ages.data() + spoke * len, 0, len);
+  LegacyZoomRelative(b.relative_ages.data() + spoke * len, b.relative.data() + spoke * len, (int)len, ZOOM_FACTOR);
+  memset(b.zoomed.data() + (size_t)first * b.trail_size, 0, (size_t)(end - first) * b.trail_size);
+  LegacyZoomTrue(b.zoomed.data(), b.true_trails.data(), b.trail_size, b.trail_size / 3, b.trail_size / 5, ZOOM_FACTOR,
+                 first > 100 ? first : 100, end < b.trail_size - 100 ? end : b.trail_size - 100);
+  b.check += b.zoomed[(size_t)first * b.trail_size + spoke];
+}
+
+static void RunDrawShader(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  SpokeToRGBA(b.texture.data() + spoke * len * 4, len, b.spokes.data() + spoke * len, len, b.rgba);
+}
+
+static void RunDrawVertex(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  b.check += SpokeToBlobs(b.blobs.data(), b.spokes.data() + spoke * len, len, b.colour_map);
+}
+
+static void RunProcessSpoke(Bench &b, size_t spoke) {
+  size_t len = b.geometry->spoke_len;
+  uint8_t *data = b.work.data();
+
+  NextRevolution(b, spoke);
+  memcpy(data, b.spokes.data() + spoke * len, len);
+  b.history->SetSpoke(spoke, data, len, THRESHOLD_RED, THRESHOLD_BLUE);
+  b.check += SpokeBitsCount(b.history->GuardRow(), len / 8, len - 1);
+  TrailsUpdateTrue(b.true_trails.data(), b.trail_size, b.trail_size / 2, b.trail_size / 2, b.lookup->GetPointIntRow(spoke), data,
+                   len, b.update);
+  TrailsUpdateRelative(b.relative.data() + spoke * len, len, data, len, b.update);
+  SpokeToRGBA(b.texture.data() + spoke * len * 4, len, data, len, b.rgba);
+}
+
+struct HistoryLines {
+  SpokeHistory *history;
+  bool Pix(size_t spoke, size_t r) { return history->Test(HISTORY_TARGET, spoke, r); }
+  int64_t Time(size_t spoke) { return history->Time(spoke); }
+};
+
+struct LegacyLines {
+  LegacyLine *legacy;
+  bool Pix(size_t spoke, size_t r) { return (legacy[spoke].line[r] & 128) != 0; }
+  int64_t Time(size_t spoke) { return legacy[spoke].time; }
+};
+
+//
+// Find the first blob edge on 'spoke' and follow its contour, turning left whenever
+// possible, like ArpaTarget::GetContour(). Returns the contour length.
+//
+template <class Lines>
+static int TraceContour(Lines lines, int spokes, int spoke_len, int spoke) {
+  static const int transl[4][2] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};  // angle, r
+  int start_r = 3;
+
+  while (start_r < spoke_len && (!lines.Pix(spoke, start_r) || lines.Pix(spoke, start_r - 1))) {
+    start_r++;
+  }
+  if (start_r >= spoke_len) {
+    return 0;
+  }
+
+#define PIX(a, r) ((r) > 0 && (r) < spoke_len && lines.Pix(((a) + spokes) % spokes, r))
+  int angle = spoke;
+  int r = start_r;
+  int index = 0;
+  bool found = false;
+
+  for (int i = 0; i < 4 && !found; i++) {  // Orientation: find a neighbour outside the blob
+    index = i;
+    found = !PIX(angle + transl[index][0], r + transl[index][1]);
+  }
+  if (!found) {
+    return 0;
+  }
+  index = (index + 1) & 3;
+
+  int count = 0;
+  while ((angle != spoke || r != start_r || count == 0) && count < CONTOUR_LENGTH_MAX) {
+    index += 3;
+    found = false;
+    for (int i = 0; i < 4; i++, index++) {
+      index &= 3;
+      if (PIX(angle + transl[index][0], r + transl[index][1])) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      break;
+    }
+    angle += transl[index][0];
+    r += transl[index][1];
+    count++;
+  }
+#undef PIX
+
+  return count + (int)(lines.Time(((angle % spokes) + spokes) % spokes) & 1);
+}
+
+static void RunContour(Bench &b, size_t spoke) {
+  HistoryLines lines = {b.history};
+  b.check += TraceContour(lines, (int)b.geometry->spokes, (int)b.geometry->spoke_len, (int)spoke);
+}
+
+static void RunContourLegacy(Bench &b, size_t spoke) {
+  LegacyLines lines = {b.legacy.data()};
+  b.check += TraceContour(lines, (int)b.geometry->spokes, (int)b.geometry->spoke_len, (int)spoke);
+}
+
+static void RunBlobs(Bench &b, size_t spoke) {
+  b.history_blobs->AddSpoke(spoke, b.history->Row(HISTORY_TARGET, spoke), b.history->Time(spoke));
+  b.check += b.history_blobs->GetEnd();
+}
+
+static void RunTargetStore(Bench &b, size_t spoke) {
+  size_t t = spoke % BENCH_TARGETS;
+  int length;
+
+  if (t == 0) {
+    b.grid->Build(b.targets);
+  }
+  b.contours->Store(t, b.contour.data(), 20 + (int)(spoke % 60));
+  b.check += b.contours->Get(t, &length)->r + length;
+  b.check += b.grid->Nearest(b.targets[t].x + 100., b.targets[t].y, HUGE_VAL, (int)t);
+}
+
+static void RunSectorPartition(Bench &b, size_t spoke) {
+  if (spoke % (b.geometry->spokes / BENCH_TRACKS_PER_SWEEP) != 0) {
+    return;
+  }
+  b.sectors->Begin(*b.history);
+  for (size_t t = 0; t < b.search_boxes.size(); t++) {
+    b.sectors->AddTarget(&b.search_boxes[t], b.search_at[t].angle, b.search_at[t].r);
+  }
+  for (size_t n = 0; n < b.sector_blobs.size(); n++) {
+    const HistoryBlob &blob = b.sector_blobs[n];
+    SectorBox box = {blob.angle_min, blob.angle_max, blob.r_min, blob.r_max};
+    b.sectors->AddBlob(box, blob.seed_angle, blob.seed_r);
+  }
+  b.check += b.sectors->Partition(&b.groups);
+}
+
+struct Kernel {
+  const char *name;
+  KernelFunction function;
+  bool simd;  // Measured once for every SIMD level, see SpokeDecodeSetSimdLevel()
+};
+
+static const Kernel kernels[] = {
+    {"navico_unpack", RunNavicoUnpack, true},
+    {"garmin_hd_expand", RunGarminHDExpand, true},
+    {"history", RunHistory, true},
+    {"history_legacy", RunHistoryLegacy, false},
+    {"guard_zone", RunGuardZone, false},
+    {"guard_zone_legacy", RunGuardZoneLegacy, false},
+    {"guard_zones", RunGuardZones, false},
+    {"guard_zones_separate", RunGuardZonesSeparate, false},
+    {"relative_trails", RunRelativeTrails, false},
+    {"relative_trails_legacy", RunRelativeTrailsLegacy, false},
+    {"true_trails", RunTrueTrails, false},
+    {"true_trails_legacy", RunTrueTrailsLegacy, false},
+    {"zoom_trails", RunZoomTrails, false},
+    {"zoom_trails_legacy", RunZoomTrailsLegacy, false},
+    {"draw_shader", RunDrawShader, false},
+    {"draw_vertex", RunDrawVertex, false},
+    {"process_spoke", RunProcessSpoke, false},
+    {"contour", RunContour, false},
+    {"contour_legacy", RunContourLegacy, false},
+    {"blobs", RunBlobs, false},
+    {"target_store", RunTargetStore, false},
+    {"sector_partition", RunSectorPartition, false},
+};
+
+static void Measure(Bench &b, const Kernel &kernel, CoreSimdLevel level, double min_ms) {
+  typedef std::chrono::steady_clock Clock;
+  size_t spokes = b.geometry->spokes;
+  size_t runs = 0;
+  double elapsed_ns = 0.;
+
+  for (size_t s = 0; s < spokes; s++) {  // Warm up caches, trails and the branch predictor
+    kernel.function(b, s);
+  }
+
+  Clock::time_point start = Clock::now();
+  do {
+    for (size_t s = 0; s < spokes; s++) {
+      kernel.function(b, s);
+    }
+    runs += spokes;
+    elapsed_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+  } while (elapsed_ns < min_ms * 1e6);
+
+  printf(
+      "{\"kernel\":\"%s\",\"simd\":\"%s\",\"geometry\":\"%s\",\"spokes\":%zu,\"spoke_len\":%zu,\"fixture\":\"%s\","
+      "\"runs\":%zu,\"ns_per_spoke\":%.1f,\"check\":%llu}\n",
+      kernel.name, CoreSimdLevelName(level), b.geometry->name, spokes, b.geometry->spoke_len, fixture_names[b.fixture], runs,
+      elapsed_ns / runs, (unsigned long long)b.check);
+  fflush(stdout);
+}
+
+int BenchMain(int argc, char **argv) {
+  double min_ms = argc > 1 ? atof(argv[1]) : 200.;
+  const char *only = argc > 2 ? argv[2] : 0;
+
+  if (min_ms <= 0.) {
+    fprintf(stderr, "Usage: %s [min_ms] [kernel]\n", argv[0]);
+    return 1;
+  }
+
+  SpokeDecodeInit();
+  CoreSimdLevel best = CoreGetSimdLevel();
+
+  for (size_t g = 0; g < sizeof(geometries) / sizeof(geometries[0]); g++) {
+    for (int f = 0; f < FIXTURE_COUNT; f++) {
+      Bench b;
+      InitBench(b, &geometries[g], (Fixture)f);
+      for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (only && strcmp(only, kernels[k].name) != 0) {
+          continue;
+        }
+        for (int level = kernels[k].simd ? CORE_SIMD_NONE : best; level <= best; level++) {
+          if (SpokeDecodeSetSimdLevel((CoreSimdLevel)level) == level) {
+            Measure(b, kernels[k], (CoreSimdLevel)level, min_ms);
+          }
+        }
+      }
+      FreeBench(b);
+    }
+  }
+  return 0;
+}
+
+PLUGIN_END_NAMESPACE
+
+int main(int argc, char **argv) { return RadarPlugin::BenchMain(argc, argv); }
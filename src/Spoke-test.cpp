@@ -0,0 +1,733 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+//
+// Checks of the kernels in radar_core against the straightforward code that they replaced or
+// that is easy to get right: the SIMD levels against the scalar code, and the blob labels, the
+// target store and the sector partition against brute force. Returns non zero when one fails.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "core/HistoryBlobs.h"
+#include "core/SectorPartition.h"
+#include "core/SpokeDecode.h"
+#include "core/SpokeHistory.h"
+#include "core/SpokeKernels.h"
+#include "core/TargetStore.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define CONTOUR_LENGTH_MAX 601  // MAX_CONTOUR_LENGTH in RadarMarpa.h
+#define TEST_SECTOR_MARGIN 5    // DISTANCE_BETWEEN_TARGETS + 1 in RadarMarpa.h
+
+// Deterministic so that a failure can be repeated
+static uint32_t random_state = 1;
+
+static uint32_t Random() {
+  random_state = random_state * 1103515245 + 12345;
+  return (random_state >> 8) & 0xffff;
+}
+
+static int LegacyWrap(int pixel, int trail_size) { return ((pixel % trail_size) + trail_size) % trail_size; }
+
+// Zooms the source rows [first..end> of the true trails, without clearing 'dst', the way ZoomTrails()
+// did before TrailsZoomTrue(): with the coordinates computed per cell
+static void LegacyZoomTrue(TrailStamp *dst, const TrailStamp *src, int trail_size, int offset_x, int offset_y,
+                           float zoom_factor, int first, int end) {
+  for (int i = first; i < end; i++) {
+    int index_i = (int)(((double)i - (double)trail_size / 2) * zoom_factor + (double)trail_size / 2);
+    if (index_i >= trail_size - 1) {
+      break;
+    }
+    if (index_i < 0) {
+      continue;
+    }
+    int x = LegacyWrap(i - trail_size / 2 + offset_x, trail_size);
+    int new_x = LegacyWrap(index_i - trail_size / 2 + offset_x, trail_size);
+    int next_x = LegacyWrap(new_x + 1, trail_size);
+
+    for (int j = 100; j < trail_size - 100; j++) {
+      int index_j = (int)(((double)j - (double)trail_size / 2) * zoom_factor + (double)trail_size / 2);
+      if (index_j >= trail_size - 1) {
+        break;
+      }
+      if (index_j < 0) {
+        continue;
+      }
+      TrailStamp pixel = src[x * trail_size + LegacyWrap(j - trail_size / 2 + offset_y, trail_size)];
+      if (pixel != 0) {
+        int new_y = LegacyWrap(index_j - trail_size / 2 + offset_y, trail_size);
+        int next_y = LegacyWrap(new_y + 1, trail_size);
+
+        dst[new_x * trail_size + new_y] = pixel;
+        if (zoom_factor > 1.2) {
+          dst[new_x * trail_size + next_y] = pixel;
+          if (zoom_factor > 1.6) {
+            dst[next_x * trail_size + new_y] = pixel;
+            dst[next_x * trail_size + next_y] = pixel;
+          }
+        }
+      }
+    }
+  }
+}
+
+//
+// Check that every SIMD level gives the same result as the scalar code, for all
+// byte values, all doppler modes and lengths that exercise the tail handling.
+//
+static bool VerifyNavicoUnpack(CoreSimdLevel level) {
+  uint8_t packed[1024 + 64];
+  uint8_t expected[2 * sizeof(packed)];
+  uint8_t actual[2 * sizeof(packed)];
+  bool ok = true;
+
+  for (size_t i = 0; i < sizeof(packed); i++) {
+    packed[i] = (uint8_t)(i * 7 + i / 256);
+  }
+  for (int doppler = NAVICO_DOPPLER_OFF; doppler <= NAVICO_DOPPLER_APPROACHING; doppler++) {
+    for (size_t len = 0; len <= sizeof(packed); len += len < 80 ? 1 : 61) {
+      SpokeDecodeSetSimdLevel(CORE_SIMD_NONE);
+      NavicoUnpackSpoke(expected, packed, len, doppler);
+      SpokeDecodeSetSimdLevel(level);
+      memset(actual, 0x55, sizeof(actual));
+      NavicoUnpackSpoke(actual, packed, len, doppler);
+      if (memcmp(expected, actual, 2 * len) != 0 || (len < sizeof(packed) && actual[2 * len] != 0x55)) {
+        fprintf(stderr, "navico_unpack %s differs from scalar: doppler=%d len=%zu\n", CoreSimdLevelName(level), doppler, len);
+        ok = false;
+        break;
+      }
+    }
+  }
+  return ok;
+}
+
+static bool VerifyGarminHDExpand(CoreSimdLevel level) {
+  uint8_t packed[256 + 64];
+  uint8_t expected[8 * sizeof(packed)];
+  uint8_t actual[8 * sizeof(packed)];
+
+  for (size_t i = 0; i < sizeof(packed); i++) {
+    packed[i] = (uint8_t)(i < 256 ? i : i * 13);
+  }
+  for (size_t len = 0; len <= sizeof(packed); len++) {
+    SpokeDecodeSetSimdLevel(CORE_SIMD_NONE);
+    GarminHDExpandSpoke(expected, packed, len);
+    SpokeDecodeSetSimdLevel(level);
+    memset(actual, 0x55, sizeof(actual));
+    GarminHDExpandSpoke(actual, packed, len);
+    if (memcmp(expected, actual, 8 * len) != 0 || (len < sizeof(packed) && actual[8 * len] != 0x55)) {
+      fprintf(stderr, "garmin_hd_expand %s differs from scalar: len=%zu\n", CoreSimdLevelName(level), len);
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool VerifyThresholdBits(CoreSimdLevel level) {
+  const size_t words = 24;
+  uint8_t data[words * 64];
+  uint64_t expected[2][words];
+  uint64_t actual[2][words];
+
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(i * 37 + i / 256);
+  }
+  for (int t = 0; t <= UINT8_MAX; t += 17) {
+    for (size_t len = 0; len <= sizeof(data); len += len < 200 ? 1 : 67) {
+      SpokeDecodeSetSimdLevel(CORE_SIMD_NONE);
+      SpokeThresholdBits(expected[0], expected[1], words, data, len, (uint8_t)(255 - t), (uint8_t)t);
+      SpokeDecodeSetSimdLevel(level);
+      memset(actual, 0x55, sizeof(actual));
+      SpokeThresholdBits(actual[0], actual[1], words, data, len, (uint8_t)(255 - t), (uint8_t)t);
+      if (memcmp(expected, actual, sizeof(actual)) != 0) {
+        fprintf(stderr, "history %s differs from scalar: threshold=%d len=%zu\n", CoreSimdLevelName(level), t, len);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Count random ranges of random rows both ways
+static bool VerifyBitsCountPrefix() {
+  const size_t words = 24;
+  uint64_t bits[words];
+  uint32_t counts[words + 1];
+
+  for (int n = 0; n < 1000; n++) {
+    for (size_t w = 0; w < words; w++) {
+      bits[w] = ((uint64_t)Random() << 32 | Random()) & ((uint64_t)Random() << 32 | Random());
+    }
+    SpokeBitsPrefix(counts, bits, words);
+    for (int r = 0; r < 100; r++) {
+      size_t start = Random() % (words * 64);
+      size_t end = Random() % (words * 64);
+      if (SpokeBitsCountPrefix(counts, bits, start, end) != SpokeBitsCount(bits, start, end)) {
+        fprintf(stderr, "guard_zones count differs: start=%zu end=%zu\n", start, end);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Zoom random trails with every zoom factor in parts, and check that gives the same image as
+// the loop with the per cell coordinate computation zooming the whole image at once.
+static bool VerifyZoomTrails() {
+  static const float zoom_factors[] = {0.25f, 0.6f, 0.99f, 1.25f, 1.7f, 4.0f};
+  const int trail_size = 2 * 301 + 2 * 100;
+  std::vector<TrailStamp> src((size_t)trail_size * trail_size);
+  std::vector<TrailStamp> expected(src.size());
+  std::vector<TrailStamp> actual(src.size());
+  std::vector<int> index((size_t)trail_size * 6);
+  TrailZoomMap rows = {0, index.data(), index.data() + trail_size, index.data() + trail_size * 2};
+  TrailZoomMap columns = {0, index.data() + trail_size * 3, index.data() + trail_size * 4, index.data() + trail_size * 5};
+
+  for (size_t i = 0; i < src.size(); i++) {
+    src[i] = Random() % 4 == 0 ? (TrailStamp)(1 + Random() % TRAIL_STAMPS) : 0;
+  }
+  for (size_t z = 0; z < sizeof(zoom_factors) / sizeof(zoom_factors[0]); z++) {
+    int offset_x = (int)(Random() % trail_size);
+    int offset_y = (int)(Random() % trail_size);
+    int parts = 1 + (int)z;
+
+    memset(expected.data(), 0, expected.size());
+    LegacyZoomTrue(expected.data(), src.data(), trail_size, offset_x, offset_y, zoom_factors[z], 100, trail_size - 100);
+    memset(actual.data(), 0xff, actual.size());
+    TrailsZoomIndex(rows, trail_size, 100, offset_x, zoom_factors[z]);
+    TrailsZoomIndex(columns, trail_size, 100, offset_y, zoom_factors[z]);
+    for (int part = 0; part < parts; part++) {
+      TrailsZoomTrue(actual.data(), src.data(), trail_size, offset_x, rows, columns, zoom_factors[z],
+                     trail_size * part / parts, trail_size * (part + 1) / parts);
+    }
+    if (memcmp(expected.data(), actual.data(), expected.size()) != 0) {
+      fprintf(stderr, "zoom_trails mismatch at zoom factor %f\n", zoom_factors[z]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Label random history rows and check that every blob has the cells that a flood fill finds.
+static bool VerifyHistoryBlobs() {
+  const int spokes = 200;
+  const int spoke_len = 150;
+  const int words = (spoke_len + 63) / 64;
+  std::vector<uint64_t> rows((size_t)(spokes + 1) * words, 0);
+  std::vector<int> label((size_t)spokes * spoke_len, -1);
+  std::vector<HistoryBlob> expected;
+  std::vector<int> stack;
+  HistoryBlobs blobs(spokes + 1, spoke_len);  // One spoke more so the last one does not connect to the first
+#define CELL(a, r) ((rows[(size_t)(a) * words + ((r) >> 6)] >> ((r) & 63)) & 1)
+
+  for (int a = 0; a < spokes; a++) {
+    for (int r = 1; r < spoke_len; r++) {
+      if (Random() % 100 < 45) {
+        rows[(size_t)a * words + (r >> 6)] |= (uint64_t)1 << (r & 63);
+      }
+    }
+  }
+  for (int a = 0; a < spokes; a++) {
+    for (int r = 1; r < spoke_len; r++) {
+      if (!CELL(a, r) || label[a * spoke_len + r] >= 0) {
+        continue;
+      }
+      HistoryBlob blob = {a, a, r, r, 0, -4, 0.f, 0.f, a, r, 0, 0};
+      label[a * spoke_len + r] = (int)expected.size();
+      stack.push_back(a * spoke_len + r);
+      while (!stack.empty()) {
+        static const int neighbours[4][2] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+        int ca = stack.back() / spoke_len;
+        int cr = stack.back() % spoke_len;
+        stack.pop_back();
+        blob.area++;
+        blob.angle_max = ca > blob.angle_max ? ca : blob.angle_max;
+        blob.r_min = cr < blob.r_min ? cr : blob.r_min;
+        blob.r_max = cr > blob.r_max ? cr : blob.r_max;
+        for (int n = 0; n < 4; n++) {
+          int na = ca + neighbours[n][0];
+          int nr = cr + neighbours[n][1];
+          if (na < 0 || na >= spokes || nr < 0 || nr >= spoke_len || !CELL(na, nr)) {
+            blob.contour++;
+          } else if (label[na * spoke_len + nr] < 0) {
+            label[na * spoke_len + nr] = (int)expected.size();
+            stack.push_back(na * spoke_len + nr);
+          }
+        }
+      }
+      expected.push_back(blob);
+    }
+  }
+
+  blobs.SetMinContourLength(-5);
+  for (int a = 0; a <= spokes; a++) {
+    blobs.AddSpoke((size_t)a, rows.data() + (size_t)a * words, a);
+  }
+#undef CELL
+
+  if (blobs.GetEnd() - blobs.GetBegin() != expected.size()) {
+    fprintf(stderr, "blobs found %u blobs instead of %zu\n", blobs.GetEnd() - blobs.GetBegin(), expected.size());
+    return false;
+  }
+  std::vector<bool> matched(expected.size(), false);
+  for (uint32_t n = blobs.GetBegin(); n != blobs.GetEnd(); n++) {
+    const HistoryBlob &blob = blobs.Get(n);
+    int e = label[blob.seed_angle * spoke_len + blob.seed_r];
+    if (e < 0 || matched[e] || blob.angle_min != expected[e].angle_min || blob.angle_max != expected[e].angle_max ||
+        blob.r_min != expected[e].r_min || blob.r_max != expected[e].r_max || blob.area != expected[e].area ||
+        blob.contour != expected[e].contour || blob.seed_r != expected[e].seed_r || blob.time != blob.seed_angle) {
+      fprintf(stderr, "blobs mismatch at spoke %d range %d\n", blob.seed_angle, blob.seed_r);
+      return false;
+    }
+    matched[e] = true;
+  }
+  return true;
+}
+
+// Spokes from blob 'blob' to spoke 'angle', the way ArpaTarget::FindNearestBlob() measures it
+static int BlobSpokes(const HistoryBlob &blob, int angle, int spokes) {
+  int offset = ((angle - blob.angle_min) % spokes + spokes) % spokes;
+  int span = blob.angle_max - blob.angle_min;
+
+  if (offset <= span) {
+    return 0;
+  }
+  return offset - span < spokes - offset ? offset - span : spokes - offset;
+}
+
+// Label random spokes for several revolutions, so the ring of blobs wraps and blobs cross north,
+// and check that looking blobs up by sector finds the same blobs in the same order as going
+// through all of them from the newest one.
+static bool VerifyHistoryBlobsIndex() {
+  const int spokes = 720;  // Not a multiple of HISTORY_BLOB_SECTOR
+  const int spoke_len = 200;
+  const int words = (spoke_len + 63) / 64;
+  HistoryBlobs blobs(spokes, spoke_len);
+  std::vector<uint64_t> row(words);
+  std::vector<uint8_t> sectors;
+  std::vector<uint32_t> found;
+  std::vector<uint32_t> expected;
+
+  blobs.SetMinContourLength(-5);
+  for (int a = 0; a < 5 * spokes; a++) {
+    for (int w = 0; w < words; w++) {
+      row[w] = 0;
+    }
+    for (int r = 1; r < spoke_len; r++) {
+      if (Random() % 100 < 30 || (a % spokes >= spokes - 3 && r < 10)) {
+        row[r >> 6] |= (uint64_t)1 << (r & 63);
+      }
+    }
+    blobs.AddSpoke((size_t)(a % spokes), row.data(), a);
+  }
+
+  for (int i = 0; i < 500; i++) {
+    int angle[2] = {(int)(Random() % spokes), (int)(Random() % spokes)};
+    int reach[2] = {(int)(Random() % 400), (int)(Random() % 40)};
+    bool both = i % 2 == 1;
+
+    expected.clear();
+    for (uint32_t n = blobs.GetEnd(); n != blobs.GetBegin(); n--) {
+      const HistoryBlob &blob = blobs.Get(n - 1);
+      if (BlobSpokes(blob, angle[0], spokes) <= reach[0] || (both && BlobSpokes(blob, angle[1], spokes) <= reach[1])) {
+        expected.push_back(n - 1);
+      }
+    }
+    if (both) {
+      sectors.assign(blobs.GetSectorCount(), 0);
+      blobs.MarkSectors(angle[0] - reach[0], angle[0] + reach[0], &sectors);
+      blobs.MarkSectors(angle[1] - reach[1], angle[1] + reach[1], &sectors);
+      blobs.Find(sectors, &found);
+    } else {
+      blobs.Find(angle[0] - reach[0], angle[0] + reach[0], &found);
+    }
+    size_t e = 0;
+    for (size_t f = 0; f < found.size(); f++) {
+      const HistoryBlob &blob = blobs.Get(found[f]);
+      if (found[f] - blobs.GetBegin() >= blobs.GetEnd() - blobs.GetBegin() ||
+          (f > 0 && blobs.GetEnd() - found[f] <= blobs.GetEnd() - found[f - 1])) {
+        fprintf(stderr, "blobs index found blob %u out of order\n", found[f]);
+        return false;
+      }
+      if (BlobSpokes(blob, angle[0], spokes) <= reach[0] || (both && BlobSpokes(blob, angle[1], spokes) <= reach[1])) {
+        if (e >= expected.size() || expected[e] != found[f]) {
+          fprintf(stderr, "blobs index found blob %u near spoke %d instead of %u\n", found[f], angle[0],
+                  e < expected.size() ? expected[e] : 0);
+          return false;
+        }
+        e++;
+      }
+    }
+    if (e != expected.size()) {
+      fprintf(stderr, "blobs index missed %zu blobs near spoke %d\n", expected.size() - e, angle[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Look up random points in grids of random targets and check that the nearest target is found,
+// and store random contours and check that the arena keeps them while it compacts.
+static bool VerifyTargetStore() {
+  std::vector<TargetGridPoint> points;
+  TargetGrid grid;
+
+  for (int n = 0; n < 50; n++) {
+    int count = (int)(Random() % 300);
+    double spread = 1. + Random() % 20000;
+    bool line = n % 5 == 0;
+    points.resize(count);
+    for (int i = 0; i < count; i++) {
+      points[i].x = (double)(Random() % 1000000) / 1000000. * spread;
+      points[i].y = line ? 0. : (double)(Random() % 1000000) / 1000000. * spread;
+      points[i].id = i;
+    }
+    grid.Build(points);
+    for (int q = 0; q < 100; q++) {
+      double x = ((double)(Random() % 1000000) / 1000000. * 1.4 - 0.2) * spread;
+      double y = ((double)(Random() % 1000000) / 1000000. * 1.4 - 0.2) * spread;
+      double max_dist = q % 2 ? HUGE_VAL : spread / 10.;
+      int exclude = count > 0 ? (int)(Random() % count) : -1;
+      double best = max_dist * max_dist;
+      int expected = -1;
+      for (int i = 0; i < count; i++) {
+        double d = (points[i].x - x) * (points[i].x - x) + (points[i].y - y) * (points[i].y - y);
+        if (i != exclude && d <= best) {
+          best = d;
+          expected = i;
+        }
+      }
+      int found = grid.Nearest(x, y, max_dist, exclude);
+      double d = found < 0 ? 0. : (points[found].x - x) * (points[found].x - x) + (points[found].y - y) * (points[found].y - y);
+      if ((found < 0) != (expected < 0) || (found >= 0 && (found == exclude || d != best))) {
+        fprintf(stderr, "target_store nearest mismatch: found %d instead of %d\n", found, expected);
+        return false;
+      }
+    }
+  }
+
+  const int slots = 200;
+  ContourArena arena;
+  std::vector<std::vector<Polar> > expected(slots);
+  std::vector<Polar> contour;
+  for (int n = 0; n < 20000; n++) {
+    int slot = (int)(Random() % slots);
+    if (Random() % 10 == 0) {
+      arena.Release(slot);
+      expected[slot].clear();
+      continue;
+    }
+    contour.resize(1 + Random() % CONTOUR_LENGTH_MAX);
+    for (size_t i = 0; i < contour.size(); i++) {
+      contour[i].angle = (int)Random();
+      contour[i].r = (int)Random();
+      contour[i].time = n;
+    }
+    arena.Store(slot, contour.data(), (int)contour.size());
+    expected[slot] = contour;
+  }
+  for (int slot = 0; slot < slots; slot++) {
+    int length;
+    const Polar *stored = arena.Get(slot, &length);
+    if ((size_t)length != expected[slot].size() || (length > 0 && memcmp(stored, expected[slot].data(), length * sizeof(Polar)))) {
+      fprintf(stderr, "target_store contour mismatch in slot %d\n", slot);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Set the tiles (history words) of 'box' grown by 'grow' cells on every side
+static void MarkTiles(std::vector<uint8_t> &tiles, int spokes, int spoke_len, const SectorBox &box, int grow) {
+  int words = (spoke_len + 63) / 64;
+  int span = box.angle_max - box.angle_min + 1 + 2 * grow;
+  int word_min = (box.r_min - grow < 0 ? 0 : box.r_min - grow) >> 6;
+  int word_max = (box.r_max + grow >= spoke_len ? spoke_len - 1 : box.r_max + grow) >> 6;
+
+  for (int i = 0; i < span && i < spokes; i++) {
+    int a = ((box.angle_min - grow + i) % spokes + spokes) % spokes;
+    for (int w = word_min; w <= word_max; w++) {
+      tiles[(size_t)a * words + w] = 1;
+    }
+  }
+}
+
+static bool BoxesMeet(const SectorBox &a, const SectorBox &b, int spokes) {
+  if (a.r_min > b.r_max || b.r_min > a.r_max) {
+    return false;
+  }
+  for (int k = -1; k <= 1; k++) {
+    if (a.angle_min + k * spokes <= b.angle_max && b.angle_min <= a.angle_max + k * spokes) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Partition random targets over random echoes, and check cell by cell that targets in different groups
+// never touch the same history word. A target reads its search box, the echoes in it and the seeds of
+// the blobs near it; when its expected position is an echo it also looks again from the start of that
+// echo on its range. It reads the cells next to every echo that it follows, and clears the cells up to
+// DISTANCE_BETWEEN_TARGETS around it.
+static bool VerifySectorPartition() {
+  const int spokes = 256;
+  const int spoke_len = 300;
+  const int words = (spoke_len + 63) / 64;
+  const int targets = 150;
+  const int reach = 6;
+  const int clear = TEST_SECTOR_MARGIN - 1;
+  SpokeHistory history(spokes, spoke_len);
+  HistoryBlobs blobs(spokes, spoke_len);
+  SectorPartition partition(spokes, spoke_len, TEST_SECTOR_MARGIN);
+  std::vector<uint8_t> data(spoke_len);
+  std::vector<int> label((size_t)spokes * spoke_len, -1);
+  std::vector<SectorBox> echoes;  // The box of each echo, by label
+  std::vector<SectorBox> boxes(targets);
+  std::vector<int> groups;
+  std::vector<uint8_t> sectors;
+  std::vector<uint32_t> near;  // The blobs that the targets may pick, see RadarArpa::PartitionTargets()
+  std::vector<int> stack;
+  std::vector<std::vector<uint8_t> > reads(targets, std::vector<uint8_t>((size_t)spokes * words, 0));
+  std::vector<std::vector<uint8_t> > writes(targets, std::vector<uint8_t>((size_t)spokes * words, 0));
+#define ECHO(a, r) \
+  ((r) >= 0 && (r) < spoke_len && history.Test(HISTORY_DUPLICATE, (size_t)((((a) % spokes) + spokes) % spokes), (size_t)(r)))
+#define LABEL(a, r) label[(size_t)((((a) % spokes) + spokes) % spokes) * spoke_len + (r)]
+
+  for (int a = 0; a < spokes; a++) {  // Noise, an echo along 80 spokes and one across north
+    for (int r = 0; r < spoke_len; r++) {
+      bool arc = r == 200 && a >= 100 && a < 180;
+      bool north = r >= 50 && r < 53 && (a >= 250 || a < 6);
+      data[r] = arc || north || Random() % 100 < 8 ? 255 : 0;
+    }
+    history.SetSpoke(a, data.data(), spoke_len, 128, 128);
+    history.Time(a) = a;
+    blobs.AddSpoke(a, history.Row(HISTORY_TARGET, a), a);
+  }
+
+  for (int a = 0; a < spokes; a++) {
+    for (int r = 0; r < spoke_len; r++) {
+      if (!ECHO(a, r) || LABEL(a, r) >= 0) {
+        continue;
+      }
+      SectorBox echo = {a, a, r, r};
+      LABEL(a, r) = (int)echoes.size();
+      stack.push_back(a);
+      stack.push_back(r);
+      while (!stack.empty()) {
+        static const int neighbours[4][2] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+        int cr = stack.back();
+        stack.pop_back();
+        int ca = stack.back();  // Counted on across north
+        stack.pop_back();
+        echo.angle_min = ca < echo.angle_min ? ca : echo.angle_min;
+        echo.angle_max = ca > echo.angle_max ? ca : echo.angle_max;
+        echo.r_min = cr < echo.r_min ? cr : echo.r_min;
+        echo.r_max = cr > echo.r_max ? cr : echo.r_max;
+        for (int n = 0; n < 4; n++) {
+          int na = ca + neighbours[n][0];
+          int nr = cr + neighbours[n][1];
+          if (ECHO(na, nr) && LABEL(na, nr) < 0) {
+            LABEL(na, nr) = (int)echoes.size();
+            stack.push_back(na);
+            stack.push_back(nr);
+          }
+        }
+      }
+      echoes.push_back(echo);
+    }
+  }
+
+  partition.Begin(history);
+  for (int t = 0; t < targets; t++) {
+    int angle = (int)(Random() % spokes);
+    int r = 10 + (int)(Random() % (spoke_len - 20));
+    SectorBox box = {angle - reach, angle + reach, r - 8, r + 8};
+    boxes[t] = box;
+    partition.AddTarget(t % 10 == 9 ? 0 : &boxes[t], angle, r);
+  }
+  partition.MarkTargetSectors(blobs, &sectors);
+  blobs.Find(sectors, &near);
+  for (size_t i = 0; i < near.size(); i++) {
+    const HistoryBlob &blob = blobs.Get(near[i]);
+    SectorBox box = {blob.angle_min, blob.angle_max, blob.r_min, blob.r_max};
+    partition.AddBlob(box, blob.seed_angle, blob.seed_r);
+  }
+  size_t count = partition.Partition(&groups);
+
+  for (int t = 0; t < targets; t++) {
+    std::vector<int> found;
+    std::vector<SectorBox> looks(1, boxes[t]);
+    if (t % 10 == 9) {
+      continue;
+    }
+    int angle = boxes[t].angle_min + reach;
+    int r = boxes[t].r_min + 8;
+    if (ECHO(angle, r)) {
+      int start = angle;
+      while (ECHO(start - 1, r) && start > angle - spokes) {
+        start--;
+      }
+      SectorBox again = {start - reach, start + reach, boxes[t].r_min, boxes[t].r_max};
+      looks.push_back(again);
+    }
+    for (size_t l = 0; l < looks.size(); l++) {
+      const SectorBox look = looks[l];
+      for (int a = look.angle_min; a <= look.angle_max; a++) {
+        for (int r = look.r_min < 0 ? 0 : look.r_min; r <= look.r_max && r < spoke_len; r++) {
+          if (ECHO(a, r)) {
+            found.push_back(LABEL(a, r));
+          }
+        }
+      }
+      for (uint32_t n = blobs.GetBegin(); n != blobs.GetEnd(); n++) {
+        const HistoryBlob &blob = blobs.Get(n);
+        SectorBox box = {blob.angle_min, blob.angle_max, blob.r_min, blob.r_max};
+        if (BoxesMeet(box, look, spokes) && ECHO(blob.seed_angle, blob.seed_r)) {
+          found.push_back(LABEL(blob.seed_angle, blob.seed_r));
+        }
+      }
+      MarkTiles(reads[t], spokes, spoke_len, look, 0);
+    }
+    for (size_t e = 0; e < found.size(); e++) {
+      MarkTiles(reads[t], spokes, spoke_len, echoes[found[e]], 1);
+      MarkTiles(writes[t], spokes, spoke_len, echoes[found[e]], clear);
+    }
+  }
+#undef LABEL
+#undef ECHO
+
+  for (int t = 0; t < targets; t++) {
+    for (int u = t + 1; u < targets; u++) {
+      if (groups[t] == groups[u]) {
+        continue;
+      }
+      for (size_t i = 0; i < reads[t].size(); i++) {
+        if ((writes[t][i] && (reads[u][i] || writes[u][i])) || (writes[u][i] && reads[t][i])) {
+          fprintf(stderr, "sector_partition targets %d and %d in groups %d and %d both touch spoke %zu word %zu\n", t, u,
+                  groups[t], groups[u], i / words, i % words);
+          return false;
+        }
+      }
+    }
+  }
+  if (count < 2 || count >= (size_t)targets) {
+    fprintf(stderr, "sector_partition made %zu groups of %d targets\n", count, targets);
+    return false;
+  }
+  return true;
+}
+
+// Two targets on small echoes that are 2 * DISTANCE_BETWEEN_TARGETS spokes apart, with nothing else in
+// the history. The cells they clear meet between the echoes, so they must be put in the same group,
+// and a third target far away in another one.
+static bool VerifySectorPartitionIsolated() {
+  const int spokes = 2048;
+  const int spoke_len = 1024;
+  const int angles[3] = {100, 110, 1100};  // The first spoke of each echo
+  SpokeHistory history(spokes, spoke_len);
+  HistoryBlobs blobs(spokes, spoke_len);
+  SectorPartition partition(spokes, spoke_len, TEST_SECTOR_MARGIN);
+  std::vector<uint8_t> data(spoke_len);
+  std::vector<int> groups;
+  std::vector<uint8_t> sectors;
+  std::vector<uint32_t> near;
+
+  for (int a = 0; a < spokes; a++) {
+    bool echo = false;
+    for (int t = 0; t < 3; t++) {
+      echo = echo || (a >= angles[t] && a <= angles[t] + 2);
+    }
+    for (int r = 0; r < spoke_len; r++) {
+      data[r] = echo && r >= 600 && r <= 602 ? 255 : 0;
+    }
+    history.SetSpoke(a, data.data(), spoke_len, 128, 128);
+    history.Time(a) = a;
+    blobs.AddSpoke(a, history.Row(HISTORY_TARGET, a), a);
+  }
+
+  partition.Begin(history);
+  SectorBox boxes[3];
+  for (int t = 0; t < 3; t++) {
+    SectorBox box = {angles[t] - 2, angles[t] + 2, 599, 603};
+    boxes[t] = box;
+    partition.AddTarget(&boxes[t], angles[t], 601);
+  }
+  partition.MarkTargetSectors(blobs, &sectors);
+  blobs.Find(sectors, &near);
+  for (size_t i = 0; i < near.size(); i++) {
+    const HistoryBlob &blob = blobs.Get(near[i]);
+    SectorBox box = {blob.angle_min, blob.angle_max, blob.r_min, blob.r_max};
+    partition.AddBlob(box, blob.seed_angle, blob.seed_r);
+  }
+  size_t count = partition.Partition(&groups);
+
+  if (groups[0] != groups[1] || groups[0] == groups[2] || count != 2) {
+    fprintf(stderr, "sector_partition put isolated targets in groups %d, %d and %d\n", groups[0], groups[1], groups[2]);
+    return false;
+  }
+  return true;
+}
+
+int TestMain() {
+  SpokeDecodeInit();
+  CoreSimdLevel best = CoreGetSimdLevel();
+  int ret = 0;
+
+  for (int level = CORE_SIMD_NONE; level <= best; level++) {
+    if (SpokeDecodeSetSimdLevel((CoreSimdLevel)level) == level &&
+        (!VerifyNavicoUnpack((CoreSimdLevel)level) || !VerifyGarminHDExpand((CoreSimdLevel)level) ||
+         !VerifyThresholdBits((CoreSimdLevel)level))) {
+      ret = 1;
+    }
+  }
+  SpokeDecodeSetSimdLevel(best);
+
+  if (!VerifyBitsCountPrefix()) ret = 1;
+  if (!VerifyZoomTrails()) ret = 1;
+  if (!VerifyHistoryBlobs()) ret = 1;
+  if (!VerifyHistoryBlobsIndex()) ret = 1;
+  if (!VerifyTargetStore()) ret = 1;
+  if (!VerifySectorPartition()) ret = 1;
+  if (!VerifySectorPartitionIsolated()) ret = 1;
+
+  printf(ret ? "ERROR: TEST FAILED\n" : "INFO: TEST PASSED\n");
+  return ret;
+}
+
+PLUGIN_END_NAMESPACE
+
+int main() { return RadarPlugin::TestMain(); }
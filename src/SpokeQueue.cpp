@@ -0,0 +1,73 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "SpokeQueue.h"
+#include "RadarInfo.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define MILLIS_PER_WAIT (250)
+
+SpokeQueue::SpokeQueue(size_t slots, size_t spoke_len_max) : m_available(0, 1) {
+  m_slots = slots;
+  m_spoke_len_max = spoke_len_max;
+  m_items = (SpokeQueueItem *)calloc(sizeof(SpokeQueueItem), m_slots);
+  m_data = (uint8_t *)calloc(sizeof(uint8_t), m_slots * m_spoke_len_max);
+  if (!m_items || !m_data) {
+    wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
+    wxAbort();
+  }
+  for (size_t i = 0; i < m_slots; i++) {
+    m_items[i].data = m_data + i * m_spoke_len_max;
+  }
+  m_head = 0;
+  m_tail = 0;
+}
+
+SpokeQueue::~SpokeQueue() {
+  free(m_items);
+  free(m_data);
+}
+
+void *SpokeProcessThread::Entry(void) {
+  LOG_VERBOSE(wxT("radar_pi: %s spoke process thread starting"), m_ri->m_name.c_str());
+
+  while (!m_shutdown) {
+    m_queue->Wait(MILLIS_PER_WAIT);
+    m_ri->ProcessQueuedSpokes();
+  }
+
+  LOG_VERBOSE(wxT("radar_pi: %s spoke process thread stopping"), m_ri->m_name.c_str());
+  return 0;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,162 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _SPOKE_QUEUE_H_
+#define _SPOKE_QUEUE_H_
+
+#include <atomic>
+
+#include "radar_pi.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// One spoke as received by the receive thread, waiting to be processed.
+// The data buffer is owned by the queue and is m_spoke_len_max bytes long.
+//
+struct SpokeQueueItem {
+  SpokeBearing angle;    // Bearing relative to boat
+  SpokeBearing bearing;  // Bearing relative to north
+  size_t len;            // Number of valid bytes in data
+  int range_meters;      // Range of this spoke
+  wxLongLong time_rec;   // Time of reception
+  uint8_t *data;         // Points into the queue's pre-allocated spoke storage
+};
+
+//
+// Bounded single producer, single consumer ring of spokes.
+//
+// The producer is the radar's receive thread, the consumer is the SpokeProcessThread.
+// Neither side takes a lock to move spokes through the ring, so the receive thread
+// never waits for the GUI thread that may be holding RadarInfo::m_exclusive while
+// drawing. When the ring is full the new spoke is dropped and counted as an overflow.
+//
+// All memory is allocated once in the constructor.
+//
+class SpokeQueue {
+ public:
+  SpokeQueue(size_t slots, size_t spoke_len_max);
+  ~SpokeQueue();
+
+  // Producer side: obtain the next free item, fill it, then Commit() it.
+  // Returns 0 when the ring is full.
+  SpokeQueueItem *Reserve() {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    size_t next = head + 1 == m_slots ? 0 : head + 1;
+    if (next == m_tail.load(std::memory_order_acquire)) {
+      return 0;
+    }
+    return &m_items[head];
+  }
+
+  void Commit() {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    m_head.store(head + 1 == m_slots ? 0 : head + 1, std::memory_order_release);
+  }
+
+  // Wake up the consumer; call once after a packet's worth of spokes has been committed.
+  void Signal() { m_available.Post(); }
+
+  // Consumer side: look at the oldest item, process it and then Pop() it.
+  // Returns 0 when the ring is empty.
+  SpokeQueueItem *Front() {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) {
+      return 0;
+    }
+    return &m_items[tail];
+  }
+
+  void Pop() {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    m_tail.store(tail + 1 == m_slots ? 0 : tail + 1, std::memory_order_release);
+  }
+
+  // Wait for at most 'millis' ms for the producer to signal new spokes
+  void Wait(unsigned long millis) { m_available.WaitTimeout(millis); }
+
+  size_t GetSpokeLenMax() { return m_spoke_len_max; }
+  size_t GetSlots() { return m_slots; }
+
+  // Number of items waiting to be processed; approximate when called from a third thread
+  size_t GetCount() {
+    size_t head = m_head.load(std::memory_order_acquire);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+    return head >= tail ? head - tail : head + m_slots - tail;
+  }
+
+ private:
+  size_t m_slots;
+  size_t m_spoke_len_max;
+  SpokeQueueItem *m_items;
+  uint8_t *m_data;
+
+  // Keep the indices on their own cache lines so producer and consumer don't share one
+  char m_pad0[64];
+  std::atomic<size_t> m_head;  // Written by producer only
+  char m_pad1[64];
+  std::atomic<size_t> m_tail;  // Written by consumer only
+  char m_pad2[64];
+
+  wxSemaphore m_available;
+};
+
+//
+// The thread that takes spokes off the SpokeQueue and runs them through
+// RadarInfo::ProcessRadarSpoke (history, guard zones, trails and draw buffers).
+// This is the only place where the receive path waits for RadarInfo::m_exclusive.
+//
+class SpokeProcessThread : public wxThread {
+ public:
+  SpokeProcessThread(RadarInfo *ri, SpokeQueue *queue) : wxThread(wxTHREAD_JOINABLE) {
+    Create(256 * 1024);
+    m_ri = ri;
+    m_queue = queue;
+    m_shutdown = false;
+  }
+
+  virtual ~SpokeProcessThread() {}
+
+  void *Entry(void);
+  void Shutdown(void) {
+    m_shutdown = true;
+    m_queue->Signal();
+  }
+
+ private:
+  RadarInfo *m_ri;
+  SpokeQueue *m_queue;
+  volatile bool m_shutdown;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _SPOKE_QUEUE_H_ */
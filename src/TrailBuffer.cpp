@@ -43,7 +43,7 @@ PLUGIN_BEGIN_NAMESPACE
 // we generally iterate over the range (process one spoke) so those
 // values are now closer together in memory.
 #define M_TRUE_TRAILS_STRIDE m_trail_size
-#define M_TRUE_TRAILS(x, y) m_true_trails[x * M_TRUE_TRAILS_STRIDE + y]
+#define M_TRUE_TRAILS(x, y) m_true_trails[(x) * M_TRUE_TRAILS_STRIDE + (y)]
 #define M_RELATIVE_TRAILS_STRIDE m_max_spoke_len
 #define M_RELATIVE_TRAILS(x, y) m_relative_trails[x * M_RELATIVE_TRAILS_STRIDE + y]
 
@@ -52,13 +52,26 @@ TrailBuffer::TrailBuffer(RadarInfo *ri, size_t spokes, size_t max_spoke_len) {
   m_spokes = spokes;
   m_max_spoke_len = (int)max_spoke_len;
   m_previous_pixels_per_meter = 0.;
+  m_revolution = 1;
+  m_last_bearing = 0;
   m_trail_size = max_spoke_len * 2 + MARGIN * 2;
-  m_true_trails = (TrailRevolutionsAge *)calloc(sizeof(TrailRevolutionsAge), m_trail_size * m_trail_size);
-  m_relative_trails = (TrailRevolutionsAge *)calloc(sizeof(TrailRevolutionsAge), m_spokes * m_max_spoke_len);
-  m_copy_true_trails = (TrailRevolutionsAge *)calloc(sizeof(TrailRevolutionsAge), m_trail_size * m_trail_size);
-  m_copy_relative_trails = (TrailRevolutionsAge *)calloc(sizeof(TrailRevolutionsAge), m_spokes * m_max_spoke_len);
-
-  if (!m_true_trails || !m_relative_trails || !m_copy_true_trails || !m_copy_relative_trails) {
+  m_true_trails = (TrailStamp *)calloc(sizeof(TrailStamp), m_trail_size * m_trail_size);
+  m_relative_trails = (TrailStamp *)calloc(sizeof(TrailStamp), m_spokes * m_max_spoke_len);
+  m_copy_true_trails = (TrailStamp *)calloc(sizeof(TrailStamp), m_trail_size * m_trail_size);
+  m_copy_relative_trails = (TrailStamp *)calloc(sizeof(TrailStamp), m_spokes * m_max_spoke_len);
+  m_zoom_rows.source = (int *)calloc(sizeof(int), m_trail_size * 3);
+  m_zoom_rows.target = m_zoom_rows.source ? m_zoom_rows.source + m_trail_size : 0;
+  m_zoom_rows.wrapped = m_zoom_rows.source ? m_zoom_rows.source + m_trail_size * 2 : 0;
+  m_zoom_rows.count = 0;
+  m_zoom_columns.source = (int *)calloc(sizeof(int), m_trail_size * 3);
+  m_zoom_columns.target = m_zoom_columns.source ? m_zoom_columns.source + m_trail_size : 0;
+  m_zoom_columns.wrapped = m_zoom_columns.source ? m_zoom_columns.source + m_trail_size * 2 : 0;
+  m_zoom_columns.count = 0;
+  m_zoom_radius = (int *)calloc(sizeof(int), m_max_spoke_len);
+  m_zoom_radius_len = 0;
+
+  if (!m_true_trails || !m_relative_trails || !m_copy_true_trails || !m_copy_relative_trails || !m_zoom_rows.source ||
+      !m_zoom_columns.source || !m_zoom_radius) {
     wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
     wxAbort();
   }
@@ -70,6 +83,24 @@ TrailBuffer::~TrailBuffer() {
   free(m_relative_trails);
   free(m_copy_relative_trails);
   free(m_copy_true_trails);
+  free(m_zoom_rows.source);
+  free(m_zoom_columns.source);
+  free(m_zoom_radius);
+}
+
+// Called for every spoke before the trails are updated, so that hits are stamped with
+// the right revolution.
+void TrailBuffer::StartSpoke(SpokeBearing bearing) {
+  if (bearing + m_spokes / 2 < m_last_bearing) {  // Wrapped around, not just a spoke out of order
+    m_revolution = m_revolution < TRAIL_STAMPS ? m_revolution + 1 : 1;
+    if (m_revolution % TRAIL_RENORMALIZE_REVOLUTIONS == 0) {
+      TrailUpdate update = {0, 0, TRAIL_MAX_REVOLUTIONS, 0, m_revolution};
+
+      TrailsRenormalize(m_true_trails, m_trail_size * m_trail_size, update);
+      TrailsRenormalize(m_relative_trails, m_spokes * m_max_spoke_len, update);
+    }
+  }
+  m_last_bearing = bearing;
 }
 
 void TrailBuffer::UpdateTrueTrails(SpokeBearing bearing, uint8_t *data, size_t len) {
@@ -77,50 +108,11 @@ void TrailBuffer::UpdateTrueTrails(SpokeBearing bearing, uint8_t *data, size_t l
   RadarControlState trails = m_ri->m_target_trails.GetState();
   bool update_targets_true = trails != RCS_OFF && motion == TARGET_MOTION_TRUE;
 
-  uint8_t weak_target = M_SETTINGS.threshold_blue;
-  uint8_t strong_target = M_SETTINGS.threshold_red;
-  size_t radius = 0;
-
-  for (; radius < len - 1; radius++) {  //  len - 1 : no trails on range circle
-    PointInt point = m_ri->m_polar_lookup->GetPointInt(bearing, radius);
-
-    point.x += m_trail_size / 2 + m_offset.lat;
-    point.y += m_trail_size / 2 + m_offset.lon;
-
-    if (point.x >= 0 && point.x < (int)m_trail_size && point.y >= 0 && point.y < (int)m_trail_size) {
-      uint8_t *trail = &M_TRUE_TRAILS(point.x, point.y);
-      // when ship moves north, offset.lat > 0. Add to move trails image in opposite direction
-      // when ship moves east, offset.lon > 0. Add to move trails image in opposite direction
-      if (data[radius] >= strong_target) {
-        *trail = 1;
-      } else if (*trail > 0 && *trail < TRAIL_MAX_REVOLUTIONS) {
-        (*trail)++;
-      }
-
-      if (update_targets_true && (data[radius] < weak_target)) {
-        data[radius] = m_ri->m_trail_colour[*trail];
-      }
-    }
-  }
+  TrailUpdate update = {M_SETTINGS.threshold_red, M_SETTINGS.threshold_blue, TRAIL_MAX_REVOLUTIONS,
+                        update_targets_true ? m_ri->m_trail_colour : 0, m_revolution};
 
-  // Now process the rest of the spoke from len to m_spoke_len_max.
-  // This will only be called when the current spoke length is smaller than the max.
-  // we need to update the trail 'age' for those points.
-  for (; radius < m_ri->m_spoke_len_max; radius++) {
-    PointInt point = m_ri->m_polar_lookup->GetPointInt(bearing, radius);
-
-    point.x += m_trail_size / 2 + m_offset.lat;
-    point.y += m_trail_size / 2 + m_offset.lon;
-
-    if (point.x >= 0 && point.x < (int)m_trail_size && point.y >= 0 && point.y < (int)m_trail_size) {
-      uint8_t *trail = &M_TRUE_TRAILS(point.x, m_trail_size + point.y);
-      // when ship moves north, offset.lat > 0. Add to move trails image in opposite direction
-      // when ship moves east, offset.lon > 0. Add to move trails image in opposite direction
-      if (*trail > 0 && *trail < TRAIL_MAX_REVOLUTIONS) {
-        (*trail)++;
-      }
-    }
-  }
+  TrailsUpdateTrue(m_true_trails, m_trail_size, m_offset.lat, m_offset.lon, m_ri->m_polar_lookup->GetPointIntRow(bearing), data,
+                   len, update);
 }
 
 void TrailBuffer::UpdateRelativeTrails(SpokeBearing angle, uint8_t *data, size_t len) {
@@ -128,105 +120,65 @@ void TrailBuffer::UpdateRelativeTrails(SpokeBearing angle, uint8_t *data, size_t
   RadarControlState trails = m_ri->m_target_trails.GetState();
   bool update_relative_motion = trails != RCS_OFF && motion == TARGET_MOTION_RELATIVE;
 
-  uint8_t *trail = &M_RELATIVE_TRAILS(angle, 0);
-  uint8_t weak_target = M_SETTINGS.threshold_blue;
-  uint8_t strong_target = M_SETTINGS.threshold_red;
-  int radius = 0;
-  int length = int(len);
-
-  for (; radius < length - 1; radius++, trail++) {  // len - 1 : no trails on range circle
-    if (data[radius] >= strong_target) {
-      *trail = 1;
-    } else if (*trail > 0 && *trail < TRAIL_MAX_REVOLUTIONS) {
-      (*trail)++;
-    }
-
-    if (update_relative_motion && (data[radius] < weak_target)) {
-      data[radius] = m_ri->m_trail_colour[*trail];
-    }
-  }
+  TrailUpdate update = {M_SETTINGS.threshold_red, M_SETTINGS.threshold_blue, TRAIL_MAX_REVOLUTIONS,
+                        update_relative_motion ? m_ri->m_trail_colour : 0, m_revolution};
 
-  for (; radius < m_max_spoke_len; radius++, trail++)  // And clear out empty bit of spoke when spoke_len < max_spoke_len
-  {
-    *trail = 0;
-  }
+  TrailsUpdateRelative(&M_RELATIVE_TRAILS(angle, 0), m_max_spoke_len, data, len, update);
 }
 
-// Zooms the trailbuffer (containing image of true trails) in and out
-// This version assumes m_offset.lon and m_offset.lat to be zero (earlier versions did zoom offset as well)
+// Zooms the trailbuffer (containing image of true trails) in and out, around the position of the radar in the image
 // zoom_factor > 1 -> zoom in, enlarge image
+//
+// Where each row, column and radius goes only depends on the zoom factor, so that is computed once
+// up front. Each part then owns a range of spokes and of target rows, so the parts can run on
+// separate threads without locking and the result does not depend on how the work was split.
 void TrailBuffer::ZoomTrails(float zoom_factor) {
-  uint8_t *flip;
-  memset(m_copy_relative_trails, 0, m_spokes * m_max_spoke_len);
-
-  // zoom relative trails
-
-  for (int i = 0; i < (int)m_spokes; i++) {
-    for (int j = 0; j < m_max_spoke_len; j++) {
-      int index_j = j * zoom_factor;
-      if (index_j >= m_max_spoke_len) break;
-      if (M_RELATIVE_TRAILS(i, j) != 0) {
-        m_copy_relative_trails[i * M_RELATIVE_TRAILS_STRIDE + index_j] = M_RELATIVE_TRAILS(i, j);
-      }
-    }
+  std::vector<WorkerThread *> &helpers = m_ri->m_trail_zoom_threads;
+  TrailZoomTask *zoom = m_ri->m_trail_zoom;
+  TrailStamp *flip;
+
+  TrailsZoomIndex(m_zoom_rows, m_trail_size, MARGIN, m_offset.lat, zoom_factor);
+  TrailsZoomIndex(m_zoom_columns, m_trail_size, MARGIN, m_offset.lon, zoom_factor);
+  m_zoom_radius_len = TrailsZoomRelativeIndex(m_zoom_radius, m_max_spoke_len, zoom_factor);
+
+  zoom->m_trails = this;
+  zoom->m_zoom_factor = zoom_factor;
+  zoom->m_parts = (int)helpers.size() + 1;
+  zoom->m_next_part = 0;
+  for (size_t i = 0; i < helpers.size(); i++) {
+    helpers[i]->Wake();
   }
-  // Now exchange the two
+  zoom->Work();
+  for (size_t i = 0; i < helpers.size(); i++) {
+    m_ri->m_trail_zoom_done.Wait();
+  }
+
+  // Now exchange the images and their copies
   flip = m_relative_trails;
   m_relative_trails = m_copy_relative_trails;
   m_copy_relative_trails = flip;
 
-  memset(m_copy_true_trails, 0, m_trail_size * m_trail_size);
-
-  // zoom true trails
-  for (int i = MARGIN; i < m_trail_size - MARGIN; i++) {
-    int index_i = (int)(((double)i - (double)m_trail_size / 2) * zoom_factor + (double)m_trail_size / 2);
-    if (index_i >= m_trail_size - 1) {
-      break;  // allow adding an additional pixel later
-    }
-    if (index_i < 0) {
-      continue;
-    }
-    for (int j = MARGIN; j < m_trail_size - MARGIN; j++) {
-      int index_j = (int)(((double)j - (double)m_trail_size / 2) * zoom_factor + (double)m_trail_size / 2);
-      if (index_j >= (int)m_trail_size - 1) {
-        break;
-      }
-      if (index_j < 0) {
-        continue;
-      }
-      uint8_t pixel = M_TRUE_TRAILS(i, j);
-      if (pixel != 0) {  // many to one mapping, prevent overwriting trails with 0
-        m_copy_true_trails[index_i * M_TRUE_TRAILS_STRIDE + index_j] = pixel;
-        if (zoom_factor > 1.2) {
-          // add an extra pixel in the y direction
-          m_copy_true_trails[index_i * M_TRUE_TRAILS_STRIDE + index_j + 1] = pixel;
-          if (zoom_factor > 1.6) {
-            // also add pixels in the x direction
-            m_copy_true_trails[(index_i + 1) * M_TRUE_TRAILS_STRIDE + index_j] = pixel;
-            m_copy_true_trails[(index_i + 1) * M_TRUE_TRAILS_STRIDE + index_j + 1] = pixel;
-          }
-        }
-      }
-    }
-  }
   flip = m_true_trails;
   m_true_trails = m_copy_true_trails;
   m_copy_true_trails = flip;
 }
 
+// Zoom part 'part' of 'parts' of the trails into the copies
+void TrailBuffer::ZoomPart(float zoom_factor, int part, int parts) {
+  size_t first_spoke = m_spokes * part / parts;
+  size_t end_spoke = m_spokes * (part + 1) / parts;
+  int first_row = m_trail_size * part / parts;
+  int end_row = m_trail_size * (part + 1) / parts;
+
+  TrailsZoomRelative(m_copy_relative_trails, m_relative_trails, m_max_spoke_len, first_spoke, end_spoke, m_zoom_radius,
+                     m_zoom_radius_len);
+  TrailsZoomTrue(m_copy_true_trails, m_true_trails, m_trail_size, m_offset.lat, m_zoom_rows, m_zoom_columns, zoom_factor,
+                 first_row, end_row);
+}
+
 void TrailBuffer::UpdateTrailPosition() {
   GeoPosition radar;
   GeoPositionPixels shift;
-  // When position changes the trail image is not moved, only the pointer to the center
-  // of the image (offset) is changed.
-  // So we move the image around within the m_trails.true_trails buffer (by moving the pointer).
-  // But when there is no room anymore (margin used) the whole trails image is shifted
-  // and the offset is reset
-  if (m_offset.lon >= MARGIN || m_offset.lon <= -MARGIN || m_offset.lat >= MARGIN || m_offset.lat <= -MARGIN) {
-    LOG_INFO(wxT("radar_pi: offset lat %d or lon too large %d"), m_offset.lat, m_offset.lon);
-    ClearTrails();
-    return;
-  }
 
   // zooming of trails required? First check conditions
   if (m_previous_pixels_per_meter == 0. || m_ri->m_pixels_per_meter == 0.) {
@@ -244,10 +196,6 @@ void TrailBuffer::UpdateTrailPosition() {
       return;
     }
     m_previous_pixels_per_meter = m_ri->m_pixels_per_meter;
-    // center the image before zooming
-    // otherwise the offset might get too large
-    ShiftImageLatToCenter();
-    ShiftImageLonToCenter();
     ZoomTrails(zoom_factor);
   }
 
@@ -268,139 +216,57 @@ void TrailBuffer::UpdateTrailPosition() {
   double fshift_lat = dif_lat * 60. * 1852. * m_ri->m_pixels_per_meter;
   double fshift_lon = dif_lon * 60. * 1852. * m_ri->m_pixels_per_meter;
   fshift_lon *= cos(deg2rad(radar.lat));  // at higher latitudes a degree of longitude is fewer meters
-  // Get the integer pixel shift, first add previous rounding error
-  shift.lat = (int)(fshift_lat + m_dif.lat);
-  shift.lon = (int)(fshift_lon + m_dif.lon);
 
-  // Check for changes in the direction of movement, part of the image buffer has to be erased
-
-  if (shift.lat > 0 && m_ri->m_dir_lat <= 0) {
-    // change of direction of movement, moving north now
-    // clear space in trailbuffer above image (this area might not be empty)
-    uint8_t *start_of_area_to_clear = m_true_trails + (m_trail_size - MARGIN + m_offset.lat) * m_trail_size;
-    int number_of_pixels_to_clear = (MARGIN - m_offset.lat) * m_trail_size;
-    memset(start_of_area_to_clear, 0, number_of_pixels_to_clear);
-    m_ri->m_dir_lat = 1;
-  }
-
-  if (shift.lat < 0 && m_ri->m_dir_lat >= 0) {
-    // change of direction of movement, moving south now
-    // clear space in true_trails below image
-    uint8_t *start_of_area_to_clear = m_true_trails;
-    int number_of_pixels_to_clear = (MARGIN + m_offset.lat) * m_trail_size;
-    memset(start_of_area_to_clear, 0, number_of_pixels_to_clear);
-    m_ri->m_dir_lat = -1;
-  }
-
-  if (shift.lon > 0 && m_ri->m_dir_lon <= 0) {
-    // change of direction of movement, moving east now
-    // clear space in true_trails to the right of image
-    int number_of_pixels_to_clear = MARGIN - m_offset.lon;
-    for (int i = 0; i < m_trail_size; i++) {
-      uint8_t *start_of_area_to_clear = m_true_trails + m_trail_size * i + m_trail_size - MARGIN + m_offset.lon;
-      memset(start_of_area_to_clear, 0, number_of_pixels_to_clear);
-    }
-    m_ri->m_dir_lon = 1;
+  if (fabs(fshift_lat) >= m_trail_size || fabs(fshift_lon) >= m_trail_size) {  // moved out of the image, nothing to keep
+    LOG_INFO(wxT("radar_pi: %s Large movement trails reset, shift.lat= %f, shift.lon=%f"), m_ri->m_name.c_str(), fshift_lat,
+             fshift_lon);
+    ClearTrails();
+    return;
   }
 
-  if (shift.lon < 0 && m_ri->m_dir_lon >= 0) {
-    // change of direction of movement, moving west now
-    // clear space in true_trails outside image in that direction
-    int number_of_pixels_to_clear = MARGIN + m_offset.lon;
-    for (int i = 0; i < m_trail_size; i++) {
-      uint8_t *start_of_area_to_clear = m_true_trails + m_trail_size * i;
-      memset(start_of_area_to_clear, 0, number_of_pixels_to_clear);
-    }
-    m_ri->m_dir_lon = -1;
-  }
+  // Get the integer pixel shift, first add previous rounding error
+  shift.lat = (int)(fshift_lat + m_dif.lat);
+  shift.lon = (int)(fshift_lon + m_dif.lon);
 
   // save the rounding fraction and appy it next time
   m_dif.lat = fshift_lat + m_dif.lat - (double)shift.lat;
   m_dif.lon = fshift_lon + m_dif.lon - (double)shift.lon;
 
-  if (shift.lat >= MARGIN || shift.lat <= -MARGIN || shift.lon >= MARGIN || shift.lon <= -MARGIN) {  // huge shift, reset trails
+  // The image wraps around, so the cells that move into view on the side we are moving to
+  // are the ones that just left on the other side. Clear those, the rest stays in place.
+  ClearExposedRows(shift.lat);
+  ClearExposedColumns(shift.lon);
 
-    LOG_INFO(wxT("radar_pi: %s Large movement trails reset, shift.lat= %f, shift.lon=%f"), m_ri->m_name.c_str(), shift.lat,
-             shift.lon);
-    ClearTrails();
-    return;
-  }
-
-  // offset lon too large: shift image
-  if (abs(m_offset.lon + shift.lon) >= MARGIN) {
-    ShiftImageLonToCenter();
-  }
-
-  // offset lat too large: shift image in lat direction
-  if (abs(m_offset.lat + shift.lat) >= MARGIN) {
-    ShiftImageLatToCenter();
-  }
   // apply the shifts to the offset
-  m_offset.lat += shift.lat;
-  m_offset.lon += shift.lon;
+  m_offset.lat = WrapTrail(m_offset.lat + shift.lat);
+  m_offset.lon = WrapTrail(m_offset.lon + shift.lon);
 }
 
-// shifts the true trails image in lat direction to center
-void TrailBuffer::ShiftImageLatToCenter() {
-  int image_size = m_trail_size * 2 * m_max_spoke_len;  // number of pixels to shift up / down
+// Clear the rows that come into view when the radar moves 'shift' rows
+void TrailBuffer::ClearExposedRows(int shift) {
+  int first = shift > 0 ? m_offset.lat + m_trail_size - m_trail_size / 2 : m_offset.lat - m_trail_size / 2 + shift;
+  int count = abs(shift);
 
-  if (m_offset.lat >= MARGIN || m_offset.lat <= -MARGIN) {  // abs not ok
-    LOG_INFO(wxT("radar_pi: offset lat too large %i"), m_offset.lat);
-    ClearTrails();
-    return;
+  for (int i = 0; i < count; i++) {
+    memset(&M_TRUE_TRAILS(WrapTrail(first + i), 0), 0, m_trail_size * sizeof(TrailStamp));
   }
-  // current starting location of shifted image
-  uint8_t *source_address = m_true_trails + (MARGIN + m_offset.lat) * m_trail_size;
-  // location where centered image should be
-  uint8_t *destination_address = m_true_trails + MARGIN * m_trail_size;
-  // size of image to be shifted, extended to the full width of trailbuffer
-  image_size = m_trail_size * 2 * m_max_spoke_len;
-  memmove(destination_address, source_address, image_size);
-  uint8_t *start_of_area_to_clear;
-  int number_of_pixels_to_clear = MARGIN * m_trail_size;
-  if (m_offset.lat > 0) {
-    // clear upper area of trailbuffer which is now outside the image
-    start_of_area_to_clear = m_true_trails + (m_trail_size - MARGIN) * m_trail_size;
-  } else {
-    // clear lower area of trailbuffer which is now outside the image
-    start_of_area_to_clear = m_true_trails;
-  }
-  memset(start_of_area_to_clear, 0, number_of_pixels_to_clear);
-  m_offset.lat = 0;
 }
 
-// shifts the true trails image in lon direction to center
-void TrailBuffer::ShiftImageLonToCenter() {
-  if (m_offset.lon >= MARGIN || m_offset.lon <= -MARGIN) {  // abs no good
-    LOG_INFO(wxT("radar_pi: offset lon too large %i"), m_offset.lon);
-    ClearTrails();
+// Clear the columns that come into view when the radar moves 'shift' columns
+void TrailBuffer::ClearExposedColumns(int shift) {
+  int first = WrapTrail(shift > 0 ? m_offset.lon + m_trail_size - m_trail_size / 2 : m_offset.lon - m_trail_size / 2 + shift);
+  int count = abs(shift);
+  int before_edge = wxMin(count, m_trail_size - first);  // The columns may wrap around the edge
+
+  if (!count) {
     return;
   }
-  // number of pixels to shift right / left
-  int line_of_image_size = 2 * m_max_spoke_len;
-  // MARGIN is where the centered line should start
-  // shift per line, rigth / left
   for (int i = 0; i < m_trail_size; i++) {
-    // current starting location of image
-    uint8_t *source_address = m_true_trails + i * m_trail_size + MARGIN + m_offset.lon;
-    // location where centered image should be
-    uint8_t *destination_address = m_true_trails + i * m_trail_size + MARGIN;
-    memmove(destination_address, source_address, line_of_image_size);
-
-    uint8_t *start_of_area_to_clear;
-    // offset > 0, we shifted to the left, so clear area to the right of image
-    if (m_offset.lon > 0) {
-      // start clear at end of the line minus current margin
-      start_of_area_to_clear = m_true_trails + i * m_trail_size + m_trail_size - MARGIN;
+    memset(&M_TRUE_TRAILS(i, first), 0, before_edge * sizeof(TrailStamp));
+    if (count > before_edge) {
+      memset(&M_TRUE_TRAILS(i, 0), 0, (count - before_edge) * sizeof(TrailStamp));
     }
-    // offset <= 0, we shifted to the right, so clear area to the left of image
-    else {
-      // start clear at start of the line
-      start_of_area_to_clear = m_true_trails + i * m_trail_size;
-    }
-    memset(start_of_area_to_clear, 0, MARGIN);
   }
-  m_offset.lon = 0;
 }
 
 void TrailBuffer::ClearTrails() {
@@ -411,10 +277,10 @@ void TrailBuffer::ClearTrails() {
   // prevent zooming of trails in next trail update
   m_previous_pixels_per_meter = m_ri->m_pixels_per_meter;
   if (m_true_trails) {
-    memset(m_true_trails, 0, m_trail_size * m_trail_size);
+    memset(m_true_trails, 0, m_trail_size * m_trail_size * sizeof(TrailStamp));
   }
   if (m_relative_trails) {
-    memset(m_relative_trails, 0, m_spokes * m_max_spoke_len);
+    memset(m_relative_trails, 0, m_spokes * m_max_spoke_len * sizeof(TrailStamp));
   }
   if (!m_ri->GetRadarPosition(&m_pos)) {
     m_pos.lat = 0.;
@@ -422,4 +288,10 @@ void TrailBuffer::ClearTrails() {
   }
 }
 
+void TrailZoomTask::Work(void) {
+  for (int part = m_next_part++; part < m_parts; part = m_next_part++) {
+    m_trails->ZoomPart(m_zoom_factor, part, m_parts);
+  }
+}
+
 PLUGIN_END_NAMESPACE
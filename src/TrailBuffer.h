@@ -32,20 +32,56 @@
 #ifndef _TRAIL_BUFFER_H_
 #define _TRAIL_BUFFER_H_
 
+#include <atomic>
+
 #include "RadarInfo.h"
+#include "WorkerThread.h"
+#include "core/SpokeKernels.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
 typedef uint8_t TrailRevolutionsAge;
 
+// The true trails image is the radar image plus this many pixels on every side
 #define MARGIN (100)
 
+// Every this many revolutions old trail stamps are moved forward, see TrailsRenormalize().
+// TRAIL_MAX_REVOLUTIONS + TRAIL_RENORMALIZE_REVOLUTIONS must stay below TRAIL_STAMPS.
+#define TRAIL_RENORMALIZE_REVOLUTIONS (8)
+
+// ZoomTrails() is split over at most this many threads, including the one calling it
+#define TRAIL_ZOOM_THREADS (4)
+
+//
+// Zooms the parts of the trails for TrailBuffer::ZoomTrails() that no thread has taken yet. The
+// spoke process thread and the helpers in RadarInfo::m_trail_zoom_threads run it at the same time.
+// RadarInfo keeps it for as long as the radar lives, as TrailBuffer is replaced whenever the
+// trails are cleared.
+//
+class TrailZoomTask : public WorkerTask {
+ public:
+  TrailZoomTask() {
+    m_trails = 0;
+    m_zoom_factor = 1.f;
+    m_parts = 1;
+    m_next_part = 0;
+  }
+
+  void Work(void);
+
+  TrailBuffer *m_trails;
+  float m_zoom_factor;
+  int m_parts;
+  std::atomic<int> m_next_part;
+};
+
 class TrailBuffer {
  public:
   TrailBuffer(RadarInfo *ri, size_t spokes, size_t max_spoke_len);
   ~TrailBuffer();
 
   void ClearTrails();
+  void StartSpoke(SpokeBearing bearing);
   void UpdateTrailPosition();
   void UpdateTrueTrails(SpokeBearing bearing, uint8_t *data, size_t len);
   void UpdateRelativeTrails(SpokeBearing angle, uint8_t *data, size_t len);
@@ -56,24 +92,39 @@ class TrailBuffer {
   };
 
   GeoPosition m_pos;
-  GeoPosition m_dif;  // Fraction of a pixel expressed in lat/lon for True Motion Target Trails
-  GeoPositionPixels m_offset;
+  GeoPosition m_dif;           // Fraction of a pixel expressed in lat/lon for True Motion Target Trails
+  GeoPositionPixels m_offset;  // Position of the radar in the true trails image, [0..m_trail_size>
 
  private:
-  void ShiftImageLonToCenter();
-  void ShiftImageLatToCenter();
+  void ClearExposedRows(int shift);
+  void ClearExposedColumns(int shift);
   void ZoomTrails(float zoom_factor);
+  void ZoomPart(float zoom_factor, int part, int parts);
+
+  // The true trails image wraps around at its edges, so that when the ship moves only the
+  // position of the radar in it changes, see UpdateTrailPosition()
+  int WrapTrail(int pixel) { return ((pixel % m_trail_size) + m_trail_size) % m_trail_size; }
 
   RadarInfo *m_ri;
   size_t m_spokes;
   int m_max_spoke_len;
   int m_trail_size;
   double m_previous_pixels_per_meter;
+  TrailStamp m_revolution;      // Counts revolutions, [1..TRAIL_STAMPS]
+  SpokeBearing m_last_bearing;  // To notice the start of a revolution
+
+  TrailStamp *m_true_trails;           // m_trails_size * m_trails_size
+  TrailStamp *m_relative_trails;       // m_spokes * m_max_spoke_len
+  TrailStamp *m_copy_true_trails;      // m_trails_size * m_trails_size
+  TrailStamp *m_copy_relative_trails;  // m_spokes * m_max_spoke_len
+
+  // Where ZoomTrails() moves each row, column and radius, see TrailsZoomIndex()
+  TrailZoomMap m_zoom_rows;
+  TrailZoomMap m_zoom_columns;
+  int *m_zoom_radius;        // m_max_spoke_len
+  size_t m_zoom_radius_len;  // Number of radii that stay on the spoke
 
-  TrailRevolutionsAge *m_true_trails;           // m_trails_size * m_trails_size
-  TrailRevolutionsAge *m_relative_trails;       // m_spokes * m_max_spoke_len
-  TrailRevolutionsAge *m_copy_true_trails;      // m_trails_size * m_trails_size
-  TrailRevolutionsAge *m_copy_relative_trails;  // m_spokes * m_max_spoke_len
+  friend class TrailZoomTask;
 };
 
 PLUGIN_END_NAMESPACE
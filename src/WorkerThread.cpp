@@ -0,0 +1,59 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "WorkerThread.h"
+#include "radar_pi.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+void *WorkerThread::Entry(void) {
+  LOG_VERBOSE(wxT("radar_pi: %s thread starting"), m_name.c_str());
+
+  while (!m_shutdown) {
+    if (m_timeout > 0) {
+      m_wakeup.WaitTimeout(m_timeout);
+    } else {
+      m_wakeup.Wait();
+    }
+    if (m_shutdown) {
+      break;
+    }
+    m_task->Work();
+    if (m_done) {
+      m_done->Post();
+    }
+  }
+
+  LOG_VERBOSE(wxT("radar_pi: %s thread stopping"), m_name.c_str());
+  return 0;
+}
+
+PLUGIN_END_NAMESPACE
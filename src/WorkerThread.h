@@ -0,0 +1,100 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _WORKER_THREAD_H_
+#define _WORKER_THREAD_H_
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// The work that one or more WorkerThreads do each time they are woken up.
+//
+class WorkerTask {
+ public:
+  virtual ~WorkerTask() {}
+  virtual void Work(void) = 0;
+};
+
+//
+// A WorkerTask that calls 'method' on 'object'.
+//
+template <class T>
+class WorkerMethod : public WorkerTask {
+ public:
+  WorkerMethod(T *object, void (T::*method)(void)) : m_object(object), m_method(method) {}
+
+  void Work(void) { (m_object->*m_method)(); }
+
+ private:
+  T *m_object;
+  void (T::*m_method)(void);
+};
+
+//
+// A thread that runs 'task' each time Wake() is called, and posts 'done' after it when that is set.
+// When 'timeout' is set the task also runs when the thread has not been woken for that many millis.
+// The task is not owned by the thread and must outlive it. Stop it with Shutdown() and then Wait().
+//
+class WorkerThread : public wxThread {
+ public:
+  WorkerThread(const wxString &name, WorkerTask *task, wxSemaphore *done = 0, int timeout = 0)
+      : wxThread(wxTHREAD_JOINABLE), m_wakeup(0, 1) {
+    Create(256 * 1024);
+    m_name = name;
+    m_task = task;
+    m_done = done;
+    m_timeout = timeout;
+    m_shutdown = false;
+  }
+
+  virtual ~WorkerThread() {}
+
+  void *Entry(void);
+  void Wake(void) { m_wakeup.Post(); }
+  void Shutdown(void) {
+    m_shutdown = true;
+    m_wakeup.Post();
+  }
+
+ private:
+  wxString m_name;
+  WorkerTask *m_task;
+  wxSemaphore *m_done;
+  int m_timeout;
+  volatile bool m_shutdown;
+  wxSemaphore m_wakeup;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _WORKER_THREAD_H_ */
@@ -0,0 +1,408 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+
+#include "HistoryBlobs.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+PLUGIN_BEGIN_NAMESPACE
+
+HistoryBlobs::HistoryBlobs(size_t spokes, size_t spoke_len) {
+  size_t max_runs = spoke_len / 2 + 1;
+
+  m_spokes = spokes;
+  m_spoke_len = spoke_len;
+  m_words = (spoke_len + 63) / 64;
+  m_min_contour_length = 0;
+  m_previous = (uint64_t *)CoreAlignedAlloc(m_words * sizeof(uint64_t), CORE_CACHE_LINE);
+  m_runs = (Run *)CoreAlignedAlloc(max_runs * sizeof(Run), CORE_CACHE_LINE);
+  m_new_runs = (Run *)CoreAlignedAlloc(max_runs * sizeof(Run), CORE_CACHE_LINE);
+  m_labels = (Label *)CoreAlignedAlloc(3 * max_runs * sizeof(Label), CORE_CACHE_LINE);
+  m_map = (int *)CoreAlignedAlloc(2 * max_runs * sizeof(int), CORE_CACHE_LINE);
+  m_blobs = (HistoryBlob *)CoreAlignedAlloc(HISTORY_BLOBS * sizeof(HistoryBlob), CORE_CACHE_LINE);
+  m_sectors.resize((spokes + HISTORY_BLOB_SECTOR - 1) / HISTORY_BLOB_SECTOR);
+  Clear();
+}
+
+HistoryBlobs::~HistoryBlobs() {
+  CoreAlignedFree(m_previous);
+  CoreAlignedFree(m_runs);
+  CoreAlignedFree(m_new_runs);
+  CoreAlignedFree(m_labels);
+  CoreAlignedFree(m_map);
+  CoreAlignedFree(m_blobs);
+}
+
+void HistoryBlobs::Clear() {
+  memset(m_previous, 0, m_words * sizeof(uint64_t));
+  m_run_count = 0;
+  m_label_count = 0;
+  m_swept = 0;
+  m_index = 0;
+  m_last_spoke = -1;
+  m_end = 0;
+  m_count = 0;
+  for (size_t s = 0; s < m_sectors.size(); s++) {
+    m_sectors[s].blobs.clear();
+    m_sectors[s].first = 0;
+  }
+}
+
+// Bits set in 'a' and not in 'b', for bits [begin..end>
+static int CountAndNot(const uint64_t *a, const uint64_t *b, int begin, int end) {
+  int first = begin >> 6;
+  int last = (end - 1) >> 6;
+  uint64_t first_mask = ~(uint64_t)0 << (begin & 63);
+  uint64_t last_mask = ~(uint64_t)0 >> (63 - ((end - 1) & 63));
+  int count;
+
+  if (first == last) {
+    return (int)CorePopCount64(a[first] & ~b[first] & first_mask & last_mask);
+  }
+  count = (int)CorePopCount64(a[first] & ~b[first] & first_mask);
+  for (int w = first + 1; w < last; w++) {
+    count += (int)CorePopCount64(a[w] & ~b[w]);
+  }
+  return count + (int)CorePopCount64(a[last] & ~b[last] & last_mask);
+}
+
+// Split 'row' in runs of set bits, returns the number of runs. Cell 0 is never part of a blob.
+size_t HistoryBlobs::GetRuns(Run *runs, const uint64_t *row) {
+  size_t count = 0;
+  int begin = -1;
+
+  for (size_t w = 0; w < m_words; w++) {
+    uint64_t bits = row[w];
+    int base = (int)(w * 64);
+
+    if (w == 0) {
+      bits &= ~(uint64_t)1;
+    }
+    for (;;) {
+      if (begin < 0) {
+        if (!bits) {
+          break;
+        }
+        int b = (int)CoreTrailingZeros64(bits);
+        begin = base + b;
+        bits |= ((uint64_t)1 << b) - 1;  // Now look for the first zero above it
+      }
+      if (bits == ~(uint64_t)0) {
+        break;  // The run continues into the next word
+      }
+      int e = (int)CoreTrailingZeros64(~bits);
+      runs[count].begin = begin;
+      runs[count].end = base + e;
+      count++;
+      begin = -1;
+      bits &= ~(uint64_t)0 << e;
+    }
+  }
+  if (begin >= 0) {
+    runs[count].begin = begin;
+    runs[count].end = (int)(m_words * 64);
+    count++;
+  }
+  return count;
+}
+
+int HistoryBlobs::Find(int label) {
+  while (m_labels[label].parent != label) {
+    m_labels[label].parent = m_labels[m_labels[label].parent].parent;
+    label = m_labels[label].parent;
+  }
+  return label;
+}
+
+// Join the blobs of two labels, the one that started first keeps its seed
+void HistoryBlobs::Union(int a, int b) {
+  a = Find(a);
+  b = Find(b);
+  if (a == b) {
+    return;
+  }
+  Label *from = &m_labels[a];
+  Label *to = &m_labels[b];
+  if (from->first < to->first || (from->first == to->first && from->seed_r < to->seed_r)) {
+    Label *swap = from;
+    from = to;
+    to = swap;
+  }
+  from->parent = (int)(to - m_labels);
+  if (from->last > to->last) {
+    to->last = from->last;
+  }
+  if (from->r_min < to->r_min) {
+    to->r_min = from->r_min;
+  }
+  if (from->r_max > to->r_max) {
+    to->r_max = from->r_max;
+  }
+  to->area += from->area;
+  to->edges += from->edges;
+  to->angle_sum += from->angle_sum;
+  to->r_sum += from->r_sum;
+}
+
+void HistoryBlobs::Emit(const Label &label) {
+  int contour = label.edges - 4;  // Following a m x n rectangle takes 2 (m - 1) + 2 (n - 1) steps
+
+  if (contour <= m_min_contour_length) {
+    return;
+  }
+
+  HistoryBlob &blob = m_blobs[m_end & (HISTORY_BLOBS - 1)];
+  blob.angle_min = label.angle_min;
+  blob.angle_max = label.angle_min + (int)(label.last - label.first);
+  blob.r_min = label.r_min;
+  blob.r_max = label.r_max;
+  blob.area = label.area;
+  blob.contour = contour;
+  blob.angle_centroid = (float)(label.angle_min + (label.angle_sum / label.area - (double)label.first));
+  blob.r_centroid = (float)(label.r_sum / label.area);
+  blob.seed_angle = label.angle_min;
+  blob.seed_r = label.seed_r;
+  blob.time = label.time;
+  blob.swept = m_swept;
+  m_end++;
+  if (m_count < HISTORY_BLOBS) {
+    m_count++;
+  }
+  AddToSectors(blob, m_end - 1);
+}
+
+// Returns the number of sectors that spokes [angle_min..angle_max] are in, starting at 'first'
+size_t HistoryBlobs::GetSectors(int angle_min, int angle_max, size_t *first) const {
+  *first = GetSector(angle_min);
+  if (angle_max < angle_min) {
+    return 0;
+  }
+  // A range that starts and ends in the same sector may still go around, so that counts as all
+  if (angle_max - angle_min + 1 > (int)m_spokes - HISTORY_BLOB_SECTOR) {
+    return m_sectors.size();
+  }
+  return (GetSector(angle_max) + m_sectors.size() - *first) % m_sectors.size() + 1;
+}
+
+// Add blob 'n' to the sectors it covers, and drop the blobs that are no longer kept from them
+void HistoryBlobs::AddToSectors(const HistoryBlob &blob, uint32_t n) {
+  size_t first;
+  size_t count = GetSectors(blob.angle_min, blob.angle_max, &first);
+
+  for (size_t i = 0; i < count; i++) {
+    Sector &sector = m_sectors[(first + i) % m_sectors.size()];
+    while (sector.first < sector.blobs.size() && !IsKept(sector.blobs[sector.first])) {
+      sector.first++;
+    }
+    if (sector.first > 0 && sector.first * 2 >= sector.blobs.size()) {
+      sector.blobs.erase(sector.blobs.begin(), sector.blobs.begin() + sector.first);
+      sector.first = 0;
+    }
+    sector.blobs.push_back(n);
+  }
+}
+
+void HistoryBlobs::MarkSectors(int angle_min, int angle_max, std::vector<uint8_t> *sectors) const {
+  size_t first;
+  size_t count = GetSectors(angle_min, angle_max, &first);
+
+  for (size_t i = 0; i < count; i++) {
+    (*sectors)[(first + i) % m_sectors.size()] = 1;
+  }
+}
+
+// Orders blob numbers from the newest to the oldest, they wrap
+struct BlobIsNewer {
+  uint32_t end;
+
+  BlobIsNewer(uint32_t blobs_end) : end(blobs_end) {}
+  bool operator()(uint32_t a, uint32_t b) const { return end - a < end - b; }
+};
+
+void HistoryBlobs::AddSector(size_t sector, std::vector<uint32_t> *found) const {
+  const Sector &s = m_sectors[sector];
+
+  for (size_t i = s.first; i < s.blobs.size(); i++) {
+    if (IsKept(s.blobs[i])) {
+      found->push_back(s.blobs[i]);
+    }
+  }
+}
+
+void HistoryBlobs::Find(const std::vector<uint8_t> &sectors, std::vector<uint32_t> *found) const {
+  found->clear();
+  for (size_t s = 0; s < m_sectors.size(); s++) {
+    if (sectors[s]) {
+      AddSector(s, found);
+    }
+  }
+  std::sort(found->begin(), found->end(), BlobIsNewer(m_end));
+  found->erase(std::unique(found->begin(), found->end()), found->end());
+}
+
+void HistoryBlobs::Find(int angle_min, int angle_max, std::vector<uint32_t> *found) const {
+  size_t first;
+  size_t count = GetSectors(angle_min, angle_max, &first);
+
+  found->clear();
+  for (size_t i = 0; i < count; i++) {
+    AddSector((first + i) % m_sectors.size(), found);
+  }
+  std::sort(found->begin(), found->end(), BlobIsNewer(m_end));
+  found->erase(std::unique(found->begin(), found->end()), found->end());
+}
+
+// Emit the blobs of labels [0..labels> that have no run in the latest spoke
+void HistoryBlobs::CompleteBlobs(int labels) {
+  for (int l = 0; l < labels; l++) {
+    if (m_labels[l].parent == l && !m_labels[l].alive) {
+      Emit(m_labels[l]);
+    }
+  }
+}
+
+void HistoryBlobs::AddSpoke(size_t spoke, const uint64_t *row, int64_t time) {
+  m_swept++;
+  if (m_last_spoke < 0 || spoke != (m_last_spoke + 1) % m_spokes) {
+    // Not the next spoke, so nothing connects to the previous one
+    for (size_t i = 0; i < m_run_count; i++) {
+      m_labels[m_runs[i].label].edges += m_runs[i].end - m_runs[i].begin;
+    }
+    for (int l = 0; l < m_label_count; l++) {
+      m_labels[l].alive = false;
+    }
+    CompleteBlobs(m_label_count);
+    memset(m_previous, 0, m_words * sizeof(uint64_t));
+    m_run_count = 0;
+    m_label_count = 0;
+  }
+  m_last_spoke = (int)spoke;
+  m_index++;
+
+  int old_labels = m_label_count;
+  size_t new_runs = GetRuns(m_new_runs, row);
+
+  for (int l = 0; l < old_labels; l++) {
+    m_labels[l].parent = l;
+    m_labels[l].alive = false;
+  }
+
+  // Each run starts as a blob of its own, its cells border on the previous spoke where that is empty
+  for (size_t j = 0; j < new_runs; j++) {
+    int label = old_labels + (int)j;
+    Run &run = m_new_runs[j];
+    Label &l = m_labels[label];
+    int length = run.end - run.begin;
+
+    run.label = label;
+    l.parent = label;
+    l.alive = true;
+    l.first = m_index;
+    l.last = m_index;
+    l.angle_min = (int)spoke;
+    l.r_min = run.begin;
+    l.r_max = run.end - 1;
+    l.area = length;
+    l.edges = 2 + CountAndNot(row, m_previous, run.begin, run.end);
+    l.angle_sum = (double)m_index * length;
+    l.r_sum = (double)(run.begin + run.end - 1) * length / 2;
+    l.seed_r = run.begin;
+    l.time = time;
+  }
+
+  // The cells of the previous spoke border on this one where it is empty
+  for (size_t i = 0; i < m_run_count; i++) {
+    m_labels[m_runs[i].label].edges += CountAndNot(m_previous, row, m_runs[i].begin, m_runs[i].end);
+  }
+
+  // Runs that overlap the runs of the previous spoke are part of the same blob
+  size_t i = 0;
+  size_t j = 0;
+  while (i < m_run_count && j < new_runs) {
+    if (m_runs[i].end <= m_new_runs[j].begin) {
+      i++;
+    } else if (m_new_runs[j].end <= m_runs[i].begin) {
+      j++;
+    } else {
+      Union(m_runs[i].label, m_new_runs[j].label);
+      if (m_runs[i].end < m_new_runs[j].end) {
+        i++;
+      } else {
+        j++;
+      }
+    }
+  }
+
+  for (j = 0; j < new_runs; j++) {
+    m_labels[Find(m_new_runs[j].label)].alive = true;
+  }
+  CompleteBlobs(old_labels);
+
+  // Keep only the labels of blobs that go on, as [0..m_label_count>
+  int total = old_labels + (int)new_runs;
+  int count = 0;
+  for (int l = 0; l < total; l++) {
+    m_map[l] = -1;
+  }
+  for (j = 0; j < new_runs; j++) {
+    int root = Find(m_new_runs[j].label);
+    if (m_map[root] < 0) {
+      m_map[root] = count++;
+    }
+    m_new_runs[j].label = root;
+  }
+  Label *compact = m_labels + total;  // Room for 'count' <= new_runs labels, see the constructor
+  for (int l = 0; l < total; l++) {
+    if (m_map[l] >= 0) {
+      compact[m_map[l]] = m_labels[l];
+    }
+  }
+  for (int l = 0; l < count; l++) {
+    m_labels[l] = compact[l];
+    m_labels[l].parent = l;
+  }
+  for (j = 0; j < new_runs; j++) {
+    m_new_runs[j].label = m_map[m_new_runs[j].label];
+  }
+  m_label_count = count;
+
+  Run *swap = m_runs;
+  m_runs = m_new_runs;
+  m_new_runs = swap;
+  m_run_count = new_runs;
+  memcpy(m_previous, row, m_words * sizeof(uint64_t));
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,174 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _HISTORY_BLOBS_H_
+#define _HISTORY_BLOBS_H_
+
+#include <vector>
+
+#include "RadarCore.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// The blobs (connected echoes) in the spokes that were stored in the SpokeHistory, found in
+// one pass as the spokes come in.
+//
+// Each spoke is split in runs of set cells, and runs that overlap a run of the previous spoke
+// get the same label. A blob is complete when the next spoke has no cells connected to it.
+// Like the contour follower in ArpaTarget, cells connect to their neighbours in range and in
+// bearing, but not diagonally. Spokes must come in order to connect: after a gap (or a spoke
+// out of order) all blobs are completed.
+//
+// Completed blobs that are large enough to become targets are kept in a ring, in the order they
+// were completed, so ARPA can look them up instead of probing the history cell by cell. They are
+// also indexed by the sectors of spokes that they cover, so a lookup only visits the blobs near it.
+//
+#define HISTORY_BLOBS (4096)      // Number of blobs kept, a power of two
+#define HISTORY_BLOB_SECTOR (32)  // Spokes per sector of the index
+
+struct HistoryBlob {
+  int angle_min;         // First spoke, [0..spokes>
+  int angle_max;         // Last spoke, angle_min + spokes spanned - 1, so it is >= spokes across north
+  int r_min;             // Range of the cells
+  int r_max;             //
+  int area;              // Number of cells
+  int contour;           // Estimated number of steps in the contour that ArpaTarget::GetContour() follows
+  float angle_centroid;  // Average spoke of the cells, relative to north like angle_max
+  float r_centroid;      // Average range of the cells
+  int seed_angle;        // A cell on the contour: the first cell of the first spoke
+  int seed_r;            //
+  int64_t time;          // Time of the seed spoke, to check that the history still holds this sweep
+  uint32_t swept;        // GetSweptSpokes() when the blob was completed
+};
+
+class HistoryBlobs {
+ public:
+  HistoryBlobs(size_t spokes, size_t spoke_len);
+  ~HistoryBlobs();
+
+  // Forget all blobs, also the ones that are not complete yet
+  void Clear();
+
+  // Only keep blobs with a contour longer than this, see RadarInfo::m_min_contour_length
+  void SetMinContourLength(int length) { m_min_contour_length = length; }
+
+  // Label the cells of 'spoke' that are set in 'row', a row of SpokeHistory::GetWords() words.
+  // 'time' is the time of the spoke in the history.
+  void AddSpoke(size_t spoke, const uint64_t *row, int64_t time);
+
+  // Number of spokes added so far, wraps
+  uint32_t GetSweptSpokes() const { return m_swept; }
+
+  // The blobs kept are numbered [GetBegin()..GetEnd()>, these numbers wrap
+  uint32_t GetBegin() const { return m_end - m_count; }
+  uint32_t GetEnd() const { return m_end; }
+  const HistoryBlob &Get(uint32_t n) const { return m_blobs[n & (HISTORY_BLOBS - 1)]; }
+
+  // The sectors of the index, [0..GetSectorCount()>, and the one that holds 'angle', which wraps
+  size_t GetSectorCount() const { return m_sectors.size(); }
+  size_t GetSector(int angle) const {
+    return (size_t)(((angle % (int)m_spokes) + (int)m_spokes) % (int)m_spokes) / HISTORY_BLOB_SECTOR;
+  }
+
+  // Set the sectors that spokes [angle_min..angle_max] are in, in 'sectors' of GetSectorCount()
+  void MarkSectors(int angle_min, int angle_max, std::vector<uint8_t> *sectors) const;
+
+  // Put the numbers of the blobs kept in 'found', newest first, that are in the sectors set in
+  // 'sectors' or in the sectors of spokes [angle_min..angle_max]. That includes every blob that
+  // covers one of those spokes, and some that only come near them.
+  void Find(const std::vector<uint8_t> &sectors, std::vector<uint32_t> *found) const;
+  void Find(int angle_min, int angle_max, std::vector<uint32_t> *found) const;
+
+ private:
+  struct Run {
+    int begin;  // First cell
+    int end;    // One past the last cell
+    int label;  // Index in m_labels
+  };
+
+  struct Label {
+    int parent;  // Union-find, the label itself when it is the root
+    bool alive;  // Has a run in the latest spoke
+    int64_t first;
+    int64_t last;
+    int angle_min;
+    int r_min;
+    int r_max;
+    int area;
+    int edges;  // Sides of cells that border on an empty cell
+    double angle_sum;
+    double r_sum;
+    int seed_r;
+    int64_t time;
+  };
+
+  int Find(int label);
+  void Union(int a, int b);
+  void CompleteBlobs(int labels);
+  void Emit(const Label &label);
+  size_t GetSectors(int angle_min, int angle_max, size_t *first) const;
+  void AddToSectors(const HistoryBlob &blob, uint32_t n);
+  void AddSector(size_t sector, std::vector<uint32_t> *found) const;
+  bool IsKept(uint32_t n) const { return m_end - 1 - n < m_count; }
+  size_t GetRuns(Run *runs, const uint64_t *row);
+
+  size_t m_spokes;
+  size_t m_spoke_len;
+  size_t m_words;
+  int m_min_contour_length;
+  uint32_t m_swept;
+  int64_t m_index;  // Of the latest spoke, counting on across north
+  int m_last_spoke;
+
+  uint64_t *m_previous;  // The latest row, m_words
+  Run *m_runs;           // Runs of the latest row
+  size_t m_run_count;
+  Run *m_new_runs;
+  Label *m_labels;  // Labels of the blobs that are not complete yet, then those of the new runs, then spare
+  int m_label_count;
+  int *m_map;  // Compacting the labels
+
+  HistoryBlob *m_blobs;  // HISTORY_BLOBS
+  uint32_t m_end;
+  uint32_t m_count;
+
+  struct Sector {
+    std::vector<uint32_t> blobs;  // Numbers of the blobs that cover the sector, oldest first
+    size_t first;                 // The ones before this are no longer kept
+  };
+  std::vector<Sector> m_sectors;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _HISTORY_BLOBS_H_ */
@@ -38,7 +38,7 @@
  */
 
 #include "Kalman.h"
-#include "RadarInfo.h"
+#include <math.h>
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -185,6 +185,163 @@ void KalmanFilter::SetMeasurement(Polar* pol, LocalPosition* x, Polar* expected,
   return;
 }
 
+// The same filter as KalmanFilter for many targets.
+//
+// The products below leave out the terms that are 0 in the generic products of KalmanFilter. A
+// sum there starts at +0 and so never ends up as -0; adding a term of +0 or -0 to it changes
+// nothing. P is only ever set to such sums, so a P element on its own is never -0 either and
+// the +0 that a generic sum starts with is left out when the first term is an element of P.
+KalmanBatch::KalmanBatch(size_t spokes) { m_spokes = spokes; }
+
+KalmanBatch::~KalmanBatch() {}
+
+void KalmanBatch::Resize(size_t filters) {
+  size_t old_size = m_dt.size();
+
+  m_dt.resize(filters);
+  for (int e = 0; e < 16; e++) {
+    m_p[e].resize(filters);
+  }
+  for (size_t f = old_size; f < filters; f++) {
+    ResetFilter((int)f);
+  }
+}
+
+void KalmanBatch::ResetFilter(int filter) {
+  // see KalmanFilter::ResetFilter()
+  m_dt[filter] = 0.;
+  for (int e = 0; e < 16; e++) {
+    m_p[e][filter] = 0.;
+  }
+  m_p[0][filter] = 20.;
+  m_p[5][filter] = 20.;
+  m_p[10][filter] = 4.;
+  m_p[15][filter] = 4.;
+}
+
+void KalmanBatch::Predict(size_t n, const int* filters, LocalPosition* x, const double* delta_time) {
+  for (size_t k = 0; k < n; k++) {
+    int f = filters[k];
+    double dt = delta_time[k];
+    LocalPosition* xx = x + k;
+
+    // X = A * X
+    m_dt[f] = dt;
+    xx->pos.lat = (0. + xx->pos.lat) + dt * xx->dlat_dt;
+    xx->pos.lon = (0. + xx->pos.lon) + dt * xx->dlon_dt;
+    xx->dlat_dt = 0. + xx->dlat_dt;
+    xx->dlon_dt = 0. + xx->dlon_dt;
+    xx->sd_speed_m_s = sqrt((m_p[10][f] + m_p[15][f]) / 2.);  // rough approximation of standard dev of speed
+  }
+}
+
+void KalmanBatch::Update_P(size_t n, const int* filters) {
+  // P = A * P * AT + W * Q * WT, where A is the identity plus dt in A(0, 2) and A(1, 3), and
+  // W * Q * WT is 0 apart from NOISE in (2, 2) and (3, 3)
+  for (size_t k = 0; k < n; k++) {
+    int f = filters[k];
+    double dt = m_dt[f];
+    double t[16];  // A * P
+
+    for (int c = 0; c < 4; c++) {
+      t[0 * 4 + c] = m_p[0 * 4 + c][f] + dt * m_p[2 * 4 + c][f];
+      t[1 * 4 + c] = m_p[1 * 4 + c][f] + dt * m_p[3 * 4 + c][f];
+      t[2 * 4 + c] = m_p[2 * 4 + c][f];
+      t[3 * 4 + c] = m_p[3 * 4 + c][f];
+    }
+    for (int r = 0; r < 4; r++) {
+      m_p[r * 4 + 0][f] = t[r * 4 + 0] + t[r * 4 + 2] * dt;
+      m_p[r * 4 + 1][f] = t[r * 4 + 1] + t[r * 4 + 3] * dt;
+      m_p[r * 4 + 2][f] = t[r * 4 + 2];
+      m_p[r * 4 + 3][f] = t[r * 4 + 3];
+    }
+    m_p[10][f] += NOISE;
+    m_p[15][f] += NOISE;
+  }
+}
+
+void KalmanBatch::SetMeasurement(size_t n, const int* filters, Polar* pol, LocalPosition* x, Polar* expected, double scale) {
+  // see KalmanFilter::SetMeasurement(), H and HT are 0 outside their first two columns and rows
+  for (size_t k = 0; k < n; k++) {
+    int f = filters[k];
+    LocalPosition* xx = x + k;
+    double h[2][2];
+    double p[16];
+
+    for (int e = 0; e < 16; e++) {
+      p[e] = m_p[e][f];
+    }
+
+    double q_sum = SQUARED(xx->pos.lon) + SQUARED(xx->pos.lat);
+    double c = m_spokes / (2. * PI);
+    h[0][0] = -c * xx->pos.lon / q_sum;
+    h[0][1] = c * xx->pos.lat / q_sum;
+
+    q_sum = sqrt(q_sum);
+    h[1][0] = xx->pos.lat / q_sum * scale;
+    h[1][1] = xx->pos.lon / q_sum * scale;
+
+    double z[2];
+    z[0] = (double)(pol[k].angle - expected[k].angle);  // Z is  difference between measured and expected
+    if (z[0] > m_spokes / 2) {
+      z[0] -= m_spokes;
+    }
+    if (z[0] < -(int)m_spokes / 2) {
+      z[0] += m_spokes;
+    }
+    z[1] = (double)(pol[k].r - expected[k].r);
+
+    // calculate Kalman gain K = P * HT * (H * P * HT + R)^-1
+    double hp[2][4];
+    for (int r = 0; r < 2; r++) {
+      for (int cc = 0; cc < 4; cc++) {
+        hp[r][cc] = (0. + h[r][0] * p[0 * 4 + cc]) + h[r][1] * p[1 * 4 + cc];
+      }
+    }
+    double s[2][2];
+    for (int r = 0; r < 2; r++) {
+      for (int cc = 0; cc < 2; cc++) {
+        s[r][cc] = (0. + hp[r][0] * h[cc][0]) + hp[r][1] * h[cc][1];
+      }
+    }
+    s[0][0] += 100.0;  // R, see KalmanFilter::ResetFilter()
+    s[1][1] += 25.;
+    double det = s[0][0] * s[1][1] - s[0][1] * s[1][0];
+    double inv[2][2];
+    inv[0][0] = s[1][1] / det;
+    inv[1][1] = s[0][0] / det;
+    inv[0][1] = -s[0][1] / det;
+    inv[1][0] = -s[1][0] / det;
+    double kg[4][2];
+    for (int r = 0; r < 4; r++) {
+      double pht0 = (0. + p[r * 4 + 0] * h[0][0]) + p[r * 4 + 1] * h[0][1];
+      double pht1 = (0. + p[r * 4 + 0] * h[1][0]) + p[r * 4 + 1] * h[1][1];
+      kg[r][0] = (0. + pht0 * inv[0][0]) + pht1 * inv[1][0];
+      kg[r][1] = (0. + pht0 * inv[0][1]) + pht1 * inv[1][1];
+    }
+
+    // calculate apostriori expected position
+    xx->pos.lat = xx->pos.lat + ((0. + kg[0][0] * z[0]) + kg[0][1] * z[1]);
+    xx->pos.lon = xx->pos.lon + ((0. + kg[1][0] * z[0]) + kg[1][1] * z[1]);
+    xx->dlat_dt = xx->dlat_dt + ((0. + kg[2][0] * z[0]) + kg[2][1] * z[1]);
+    xx->dlon_dt = xx->dlon_dt + ((0. + kg[3][0] * z[0]) + kg[3][1] * z[1]);
+
+    // update covariance P = (I - K * H) * P, where only the first two columns of K * H are not 0
+    for (int r = 0; r < 4; r++) {
+      double m0 = (r == 0 ? 1. : 0.) - ((0. + kg[r][0] * h[0][0]) + kg[r][1] * h[1][0]);
+      double m1 = (r == 1 ? 1. : 0.) - ((0. + kg[r][0] * h[0][1]) + kg[r][1] * h[1][1]);
+      for (int cc = 0; cc < 4; cc++) {
+        double sum = (0. + m0 * p[0 * 4 + cc]) + m1 * p[1 * 4 + cc];
+        if (r >= 2) {
+          sum += p[r * 4 + cc];
+        }
+        m_p[r * 4 + cc][f] = sum;
+      }
+    }
+    xx->sd_speed_m_s = sqrt((m_p[10][f] + m_p[15][f]) / 2.);  // rough approximation of standard dev of speed
+  }
+}
+
 // Kalman filter to stabilize the GPS position and to calculate intermediate positions (Predict())
 GPSKalmanFilter::GPSKalmanFilter() {
   // as the measurement to state transformation is non-linear, the extended Kalman filter is used
@@ -248,13 +405,13 @@ GPSKalmanFilter::~GPSKalmanFilter() {}
 void GPSKalmanFilter::Predict(ExtendedPosition* old, ExtendedPosition* updated) {
   // predicts current position based on position old in updated at time now
 
-  wxLongLong now = wxGetUTCTimeMillis();  // millis
+  int64_t now = CoreGetTimeMillis();  // millis
   Matrix<double, 4, 1> X;
   X(0, 0) = old->pos.lat;  // X in meters and m / sec
   X(1, 0) = old->pos.lon;
   X(2, 0) = old->dlat_dt;
   X(3, 0) = old->dlon_dt;
-  A(0, 2) = (now - old->time).GetLo() / 1000.;  // delta time in seconds
+  A(0, 2) = (double)(now - old->time) / 1000.;  // delta time in seconds
   A(1, 3) = A(0, 2);
 
   AT(2, 0) = A(0, 2);
@@ -33,8 +33,10 @@
 #ifndef _KALMAN_H_
 #define _KALMAN_H_
 
+#include <vector>
+
 #include "Matrix.h"
-#include "RadarInfo.h"
+#include "RadarCore.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -45,13 +47,6 @@ PLUGIN_BEGIN_NAMESPACE
                                                         // higher values allow target to make curves
 #define CONVERT ((((1. / 1852.) / 1852.) / 60.) / 60.)  // converts meters ^ 2 to degrees ^ 2
 
-class Polar {
- public:
-  int angle;
-  int r;
-  wxLongLong time;  // wxGetUTCTimeMillis
-};
-
 class LocalPosition {
  public:
   GeoPosition pos;
@@ -90,6 +85,31 @@ class KalmanFilter {
   size_t m_spokes;
 };
 
+// The Kalman filters of all targets of a radar, stored as one array per element so that a step
+// can be done for many filters at once. Each filter computes bit for bit what a KalmanFilter
+// does, as long as the values are finite, see Kalman-test.cpp. Of A only the delta time is kept,
+// and the products only take the elements of A, W, H, Q and R that are not 0.
+class KalmanBatch {
+ public:
+  KalmanBatch(size_t spokes);
+  ~KalmanBatch();
+  void Resize(size_t filters);  // new filters start out reset
+  size_t Size() { return m_dt.size(); }
+  void ResetFilter(int filter);
+
+  // Do the step for filters[k] on x[k], pol[k] and expected[k], for k in [0..n>
+  void Predict(size_t n, const int* filters, LocalPosition* x, const double* delta_time);
+  void Update_P(size_t n, const int* filters);
+  void SetMeasurement(size_t n, const int* filters, Polar* pol, LocalPosition* x, Polar* expected, double scale);
+
+  double P(int filter, int r, int c) { return m_p[r * 4 + c][filter]; }
+
+ private:
+  size_t m_spokes;
+  std::vector<double> m_dt;     // A(0, 2) and A(1, 3) of each filter, set by Predict()
+  std::vector<double> m_p[16];  // P(r, c) of each filter is in m_p[r * 4 + c]
+};
+
 class GPSKalmanFilter {
  public:
   GPSKalmanFilter();
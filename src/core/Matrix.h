@@ -26,9 +26,10 @@
 #ifndef _MATRIX_H_
 #define _MATRIX_H_
 
+#include <cassert>
 #include <cstdlib>
 #include <iostream>
-#include "pi_common.h"
+#include "RadarCore.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -70,8 +71,8 @@ struct Matrix {
   }
 
   // Return matrix initialized to value
-  Matrix<Ty, M, N> Init(Ty value) const {
-    Matrix<Ty, M, N> result;
+  Matrix<Ty, N, M> Init(Ty value) const {
+    Matrix<Ty, N, M> result;
     for (int e = 0; e < M * N; ++e) {
       result.flatten[e] = Ty(value);
     }
@@ -130,9 +131,10 @@ Matrix<Ty, N, M> Matrix<Ty, N, M>::Inverse() {
 ///
 //  Matrix operations
 ///
-// Matrix product
+// Matrix product, as a plain loop. operator*() below forms the same sums in the same order with
+// the loops unrolled, so the results are bit for bit the same, see Kalman-test.cpp.
 template <typename Ty, int N, int M, int P>
-Matrix<Ty, N, P> operator*(const Matrix<Ty, N, M>& a, const Matrix<Ty, M, P>& b) {
+Matrix<Ty, N, P> MatrixProduct(const Matrix<Ty, N, M>& a, const Matrix<Ty, M, P>& b) {
   Matrix<Ty, N, P> result;
 
   for (int r = 0; r < N; ++r) {
@@ -147,6 +149,47 @@ Matrix<Ty, N, P> operator*(const Matrix<Ty, N, M>& a, const Matrix<Ty, M, P>& b)
   return result;
 }
 
+// Matrix product helpers, the matrices here are at most 4 x 4 so the loops are unrolled at
+// compile time. This leaves no loop counters or bounds checks, and the compiler can keep the
+// elements of small matrices in registers.
+namespace detail {
+// 'accum' plus a(R, i) * b(i, C) for i in [I..M>, added one by one as MatrixProduct() does
+template <typename Ty, int N, int M, int P, int R, int C, int I>
+struct product_sum {
+  static Ty Sum(const Matrix<Ty, N, M>& a, const Matrix<Ty, M, P>& b, Ty accum) {
+    return product_sum<Ty, N, M, P, R, C, I + 1>::Sum(a, b, accum + a.element[R][I] * b.element[I][C]);
+  }
+};
+
+template <typename Ty, int N, int M, int P, int R, int C>
+struct product_sum<Ty, N, M, P, R, C, M> {
+  static Ty Sum(const Matrix<Ty, N, M>&, const Matrix<Ty, M, P>&, Ty accum) { return accum; }
+};
+
+// Elements [E..N * P> of a * b, in row order
+template <typename Ty, int N, int M, int P, int E>
+struct product {
+  static void Fill(Matrix<Ty, N, P>& result, const Matrix<Ty, N, M>& a, const Matrix<Ty, M, P>& b) {
+    result.flatten[E] = product_sum<Ty, N, M, P, E / P, E % P, 0>::Sum(a, b, Ty(0));
+    product<Ty, N, M, P, E + 1>::Fill(result, a, b);
+  }
+};
+
+template <typename Ty, int N, int M, int P>
+struct product<Ty, N, M, P, N * P> {
+  static void Fill(Matrix<Ty, N, P>&, const Matrix<Ty, N, M>&, const Matrix<Ty, M, P>&) {}
+};
+}  // namespace detail
+
+// Matrix product
+template <typename Ty, int N, int M, int P>
+Matrix<Ty, N, P> operator*(const Matrix<Ty, N, M>& a, const Matrix<Ty, M, P>& b) {
+  Matrix<Ty, N, P> result;
+
+  detail::product<Ty, N, M, P, 0>::Fill(result, a, b);
+  return result;
+}
+
 // Unary negation
 template <typename Ty, int N, int M>
 Matrix<Ty, N, M> operator-(const Matrix<Ty, N, M>& a) {
@@ -0,0 +1,107 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "PolarLookup.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+static CoreLock s_lookups_lock;
+static PolarToCartesianLookup *s_lookups = 0;
+
+PolarToCartesianLookup *PolarToCartesianLookup::Acquire(size_t spokes, size_t spoke_len) {
+  CoreLocker lock(s_lookups_lock);
+
+  for (PolarToCartesianLookup *lookup = s_lookups; lookup; lookup = lookup->m_next) {
+    if (lookup->m_spokes == spokes && lookup->m_spoke_len == spoke_len + 1) {
+      lookup->m_references++;
+      return lookup;
+    }
+  }
+
+  PolarToCartesianLookup *lookup = new PolarToCartesianLookup(spokes, spoke_len);
+  lookup->m_next = s_lookups;
+  s_lookups = lookup;
+  return lookup;
+}
+
+void PolarToCartesianLookup::Release() {
+  CoreLocker lock(s_lookups_lock);
+
+  if (--m_references > 0) {
+    return;
+  }
+  for (PolarToCartesianLookup **link = &s_lookups; *link; link = &(*link)->m_next) {
+    if (*link == this) {
+      *link = m_next;
+      break;
+    }
+  }
+  delete this;
+}
+
+PolarToCartesianLookup::PolarToCartesianLookup(size_t spokes, size_t spoke_len) {
+  m_spokes = spokes;
+  m_spoke_len = spoke_len + 1;
+  m_rows = m_spokes % 4 == 0 ? m_spokes / 4 : m_spokes;
+  m_references = 1;
+  m_next = 0;
+
+  m_sine = (float *)malloc(sizeof(float) * m_spokes);
+  m_cosine = (float *)malloc(sizeof(float) * m_spokes);
+  m_xyi = (PointInt *)malloc(sizeof(PointInt) * m_rows * m_spoke_len);
+
+  if (!m_sine || !m_cosine || !m_xyi) {
+    CoreOutOfMemory();
+  }
+
+  for (size_t arc = 0; arc < m_spokes; arc++) {
+    m_sine[arc] = sinf((float)arc * PI * 2 / m_spokes);
+    m_cosine[arc] = cosf((float)arc * PI * 2 / m_spokes);
+  }
+
+  for (size_t arc = 0; arc < m_rows; arc++) {
+    PointInt *row = m_xyi + arc * m_spoke_len;
+
+    for (size_t radius = 0; radius < m_spoke_len; radius++) {
+      row[radius].x = (int16_t)((float)radius * m_cosine[arc]);
+      row[radius].y = (int16_t)((float)radius * m_sine[arc]);
+    }
+  }
+}
+
+PolarToCartesianLookup::~PolarToCartesianLookup() {
+  free(m_sine);
+  free(m_cosine);
+  free(m_xyi);
+}
+
+PLUGIN_END_NAMESPACE
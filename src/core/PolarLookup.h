@@ -0,0 +1,130 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _POLAR_LOOKUP_H_
+#define _POLAR_LOOKUP_H_
+
+#include <math.h>
+#include "RadarCore.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+typedef struct {
+  float x;
+  float y;
+} Point;
+
+typedef struct {
+  int16_t x;
+  int16_t y;
+} PointInt;
+
+// Rotate a point 'quadrant' quarter turns, in the direction of increasing spoke angle
+template <int quadrant>
+inline PointInt RotatePointInt(PointInt p) {
+  PointInt r;
+
+  r.x = quadrant == 0 ? p.x : quadrant == 1 ? -p.y : quadrant == 2 ? -p.x : p.y;
+  r.y = quadrant == 0 ? p.y : quadrant == 1 ? p.x : quadrant == 2 ? -p.y : -p.x;
+  return r;
+}
+
+// The integer points of one spoke. Spokes a quarter turn apart have the same points rotated,
+// so only the first quadrant is stored and the other spokes rotate those.
+struct PointIntRow {
+  const PointInt *points;  // The spoke in the first quadrant at the same angle within its quadrant
+  int quadrant;            // Number of quarter turns to rotate 'points' by, [0..3]
+
+  PointInt Get(size_t radius) const {
+    switch (quadrant) {
+      case 1:
+        return RotatePointInt<1>(points[radius]);
+      case 2:
+        return RotatePointInt<2>(points[radius]);
+      case 3:
+        return RotatePointInt<3>(points[radius]);
+      default:
+        return points[radius];
+    }
+  }
+};
+
+//
+// Cartesian coordinates for every (spoke, radius) of a radar image.
+//
+// The float points are the radius times the sine and cosine of the spoke, which are stored per
+// spoke. The integer points are stored for the first quadrant only, see PointIntRow. Radars with
+// the same geometry share one lookup: get it with Acquire() and give it back with Release().
+//
+class PolarToCartesianLookup {
+ public:
+  static PolarToCartesianLookup *Acquire(size_t spokes, size_t spoke_len);
+  void Release();
+
+  // We trust that the optimizer will inline this
+  Point GetPoint(size_t angle, size_t radius) {
+    size_t arc = (angle + m_spokes) % m_spokes;
+    Point p;
+
+    p.x = (float)radius * m_cosine[arc];
+    p.y = (float)radius * m_sine[arc];
+    return p;
+  }
+  PointInt GetPointInt(size_t angle, size_t radius) { return GetPointIntRow((angle + m_spokes) % m_spokes).Get(radius); }
+
+  // All points for one spoke, 'angle' must be in [0..spokes>
+  PointIntRow GetPointIntRow(size_t angle) {
+    PointIntRow row;
+
+    row.points = m_xyi + (angle % m_rows) * m_spoke_len;
+    row.quadrant = (int)(angle / m_rows);
+    return row;
+  }
+
+ private:
+  PolarToCartesianLookup(size_t spokes, size_t spoke_len);
+  ~PolarToCartesianLookup();
+
+  size_t m_spokes;
+  size_t m_spoke_len;
+  size_t m_rows;    // Spokes that have their integer points stored, a quarter of them when that is exact
+  float *m_sine;    // [m_spokes]
+  float *m_cosine;  // [m_spokes]
+  PointInt *m_xyi;  // [m_rows * m_spoke_len]
+
+  int m_references;
+  PolarToCartesianLookup *m_next;  // In the list of shared lookups
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _POLAR_LOOKUP_H_ */
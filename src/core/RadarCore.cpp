@@ -0,0 +1,172 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "RadarCore.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#if defined(CORE_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+PLUGIN_BEGIN_NAMESPACE
+
+static CoreLogSink s_log_sink = 0;
+static void *s_log_context = 0;
+
+int64_t CoreGetTimeMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t CoreGetTimeMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void CoreSetLogSink(CoreLogSink sink, void *context) {
+  s_log_context = context;
+  s_log_sink = sink;
+}
+
+void CoreLog(CoreLogLevel level, const char *format, ...) {
+  char message[1024];
+  va_list ap;
+
+  va_start(ap, format);
+  vsnprintf(message, sizeof(message), format, ap);
+  va_end(ap);
+
+  if (s_log_sink) {
+    s_log_sink(s_log_context, level, message);
+  } else {
+    fprintf(stderr, "%s\n", message);
+  }
+}
+
+void CoreOutOfMemory() {
+  CoreLog(CORE_LOG_ERROR, "radar_pi: Out Of Memory, fatal!");
+  abort();
+}
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+void *CoreAlignedAlloc(size_t size, size_t alignment, bool huge_pages) {
+  void *p;
+
+  if (huge_pages && size >= HUGE_PAGE_SIZE) {
+    alignment = HUGE_PAGE_SIZE;
+    size = (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+  } else {
+    huge_pages = false;
+  }
+#ifdef _MSC_VER
+  p = _aligned_malloc(size, alignment);
+#else
+  if (posix_memalign(&p, alignment, size)) {
+    p = 0;
+  }
+#endif
+  if (!p) {
+    CoreOutOfMemory();
+  }
+#ifdef MADV_HUGEPAGE
+  if (huge_pages) {
+    madvise(p, size, MADV_HUGEPAGE);  // Only advice, fine if the kernel says no
+  }
+#endif
+  memset(p, 0, size);
+  return p;
+}
+
+void CoreAlignedFree(void *p) {
+#ifdef _MSC_VER
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+#if defined(CORE_SIMD_X86)
+static bool CpuHasAVX2() {
+#if defined(_MSC_VER)
+  int info[4];
+
+  __cpuid(info, 1);
+  if (!(info[2] & (1 << 27))) {  // OSXSAVE, otherwise the OS does not save the YMM registers
+    return false;
+  }
+  if ((_xgetbv(0) & 6) != 6) {  // XMM and YMM state enabled by the OS
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+CoreSimdLevel CoreGetSimdLevel() {
+#if defined(CORE_SIMD_X86)
+  static CoreSimdLevel level = CpuHasAVX2() ? CORE_SIMD_AVX2 : CORE_SIMD_SSE2;
+  return level;
+#elif defined(CORE_SIMD_ARM)
+  return CORE_SIMD_NEON;
+#else
+  return CORE_SIMD_NONE;
+#endif
+}
+
+const char *CoreSimdLevelName(CoreSimdLevel level) {
+  switch (level) {
+    case CORE_SIMD_SSE2:
+      return "sse2";
+    case CORE_SIMD_AVX2:
+      return "avx2";
+    case CORE_SIMD_NEON:
+      return "neon";
+    default:
+      return "scalar";
+  }
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,201 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _RADAR_CORE_H_
+#define _RADAR_CORE_H_
+
+//
+// Basic services for the radar_core library.
+//
+// The code in src/core does not include wxWidgets, OpenGL or OpenCPN headers, so it can be
+// compiled into a plain process for tests and benchmarks. Instead of wxGetUTCTimeMillis(),
+// wxCriticalSection and wxLogMessage() it uses the time, lock and log functions below.
+// The plugin routes the core log to the wxWidgets log with CoreSetLogSink().
+//
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <mutex>
+
+#ifndef PLUGIN_NAMESPACE
+#define PLUGIN_NAMESPACE RadarPlugin
+#define PLUGIN_BEGIN_NAMESPACE namespace PLUGIN_NAMESPACE {
+#define PLUGIN_END_NAMESPACE }
+#endif
+
+#ifndef PI
+#define PI (3.1415926535897931160E0)
+#endif
+
+// Which vector instruction sets the compiler can generate code for.
+// SSE2 is part of every x86-64 CPU, AVX2 code is only run after CoreGetSimdLevel()
+// says the CPU has it. NEON is only used when the whole build targets it.
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CORE_SIMD_X86
+#if defined(__GNUC__)
+#define CORE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CORE_TARGET_AVX2
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CORE_SIMD_ARM
+#endif
+
+struct GeoPosition {
+  double lat;
+  double lon;
+};
+
+struct ExtendedPosition {
+  GeoPosition pos;
+  double dlat_dt;  // m / sec
+  double dlon_dt;  // m / sec
+  int64_t time;    // millis, see CoreGetTimeMillis()
+  double speed_kn;
+  double sd_speed_kn;  // standard deviation of the speed in knots
+};
+
+PLUGIN_BEGIN_NAMESPACE
+
+class Polar {
+ public:
+  int angle;
+  int r;
+  int64_t time;  // CoreGetTimeMillis
+};
+
+/*
+ * Time
+ */
+extern int64_t CoreGetTimeMillis();  // UTC, same epoch and value as wxGetUTCTimeMillis()
+extern int64_t CoreGetTimeMicros();  // UTC, same epoch and value as wxGetUTCTimeUSec()
+
+/*
+ * Locking
+ *
+ * A recursive lock with the same semantics as wxCriticalSection.
+ */
+class CoreLock {
+ public:
+  void Enter() { m_mutex.lock(); }
+  void Leave() { m_mutex.unlock(); }
+
+ private:
+  std::recursive_mutex m_mutex;
+};
+
+class CoreLocker {
+ public:
+  CoreLocker(CoreLock &lock) : m_lock(lock) { m_lock.Enter(); }
+  ~CoreLocker() { m_lock.Leave(); }
+
+ private:
+  CoreLock &m_lock;
+};
+
+/*
+ * Logging
+ *
+ * Levels other than CORE_LOG_ERROR and CORE_LOG_INFO use the same bit values as
+ * the plugin's LOGLEVEL_xxx, so the sink can filter them on the 'verbose' setting.
+ * Without a sink messages are written to stderr.
+ */
+enum CoreLogLevel { CORE_LOG_ERROR = -1, CORE_LOG_INFO = 0, CORE_LOG_VERBOSE = 1 };
+
+typedef void (*CoreLogSink)(void *context, CoreLogLevel level, const char *message);
+
+extern void CoreSetLogSink(CoreLogSink sink, void *context);
+extern void CoreLog(CoreLogLevel level, const char *format, ...)
+#ifdef __GNUC__
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+// Log and abort when a (large) buffer cannot be allocated, there is no way to continue
+extern void CoreOutOfMemory();
+
+/*
+ * Memory
+ *
+ * Zeroed memory aligned to 'alignment' bytes, a power of two. Aborts when out of memory.
+ * With 'huge_pages' large buffers are aligned to 2 MB and the kernel is asked to back
+ * them with huge pages (Linux only), which saves TLB misses when they are walked at random.
+ */
+#define CORE_CACHE_LINE (64)
+
+extern void *CoreAlignedAlloc(size_t size, size_t alignment, bool huge_pages = false);
+extern void CoreAlignedFree(void *p);
+
+/*
+ * Bits
+ *
+ * Count the bits set, and the zero bits below the lowest bit set ('x' must not be 0).
+ */
+static inline size_t CorePopCount64(uint64_t x) {
+#if defined(__GNUC__)
+  return (size_t)__builtin_popcountll(x);
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return (size_t)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+static inline size_t CoreTrailingZeros64(uint64_t x) {
+#if defined(__GNUC__)
+  return (size_t)__builtin_ctzll(x);
+#else
+  size_t n = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+/*
+ * SIMD
+ *
+ * Kernels that have vectorized versions pick one at startup with CoreGetSimdLevel().
+ * The scalar version (CORE_SIMD_NONE) is always available and is the reference
+ * that the other versions must match bit for bit.
+ */
+enum CoreSimdLevel { CORE_SIMD_NONE, CORE_SIMD_SSE2, CORE_SIMD_AVX2, CORE_SIMD_NEON };
+
+extern CoreSimdLevel CoreGetSimdLevel();  // Best level supported by this build and this CPU
+extern const char *CoreSimdLevelName(CoreSimdLevel level);
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _RADAR_CORE_H_ */
@@ -0,0 +1,295 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+
+#include "SectorPartition.h"
+
+#include <algorithm>
+
+PLUGIN_BEGIN_NAMESPACE
+
+SectorPartition::SectorPartition(size_t spokes, size_t spoke_len, int margin) {
+  m_spokes = spokes;
+  m_spoke_len = spoke_len;
+  m_words = (spoke_len + 63) / 64;
+  m_tiles = (spoke_len + (1 << SECTOR_TILE_SHIFT) - 1) >> SECTOR_TILE_SHIFT;
+  m_margin = margin;
+  m_history = 0;
+}
+
+void SectorPartition::Begin(SpokeHistory &history) {
+  m_history = &history;
+  m_component.assign(m_spokes * m_tiles, -1);
+  m_items.clear();
+  m_targets.clear();
+  m_echoes.clear();
+  m_blobs.clear();
+}
+
+int SectorPartition::AddItem(const SectorBox &box) {
+  int spokes = (int)m_spokes;
+  int shift = ((box.angle_min % spokes) + spokes) % spokes - box.angle_min;
+  Item item;
+
+  item.box = box;
+  item.box.angle_min += shift;
+  item.box.angle_max += shift;
+  item.parent = (int)m_items.size();
+  m_items.push_back(item);
+  return item.parent;
+}
+
+int SectorPartition::Find(int item) {
+  while (m_items[item].parent != item) {
+    m_items[item].parent = m_items[m_items[item].parent].parent;
+    item = m_items[item].parent;
+  }
+  return item;
+}
+
+void SectorPartition::Union(int a, int b) {
+  a = Find(a);
+  b = Find(b);
+  if (a < b) {
+    m_items[b].parent = a;
+  } else if (b < a) {
+    m_items[a].parent = b;
+  }
+}
+
+bool SectorPartition::Echo(int spoke, int tile) {
+  const uint64_t *row = m_history->Row(HISTORY_DUPLICATE, (size_t)spoke);
+  int shift = (tile << SECTOR_TILE_SHIFT) & 63;
+
+  return ((row[tile >> (6 - SECTOR_TILE_SHIFT)] >> shift) & (((uint64_t)1 << (1 << SECTOR_TILE_SHIFT)) - 1)) != 0;
+}
+
+// Returns the item of the echo in the tile, flooding it when that was not done before
+int SectorPartition::Flood(int spoke, int tile) {
+  static const int neighbours[4][2] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+  int spokes = (int)m_spokes;
+  int tiles = (int)m_tiles;
+  int &component = m_component[(size_t)spoke * m_tiles + tile];
+
+  if (component >= 0) {
+    return component;
+  }
+
+  SectorBox box = {spoke, spoke, tile, tile};
+  component = (int)m_items.size();
+  m_stack.push_back(tile);
+  m_stack.push_back(spoke);
+  while (!m_stack.empty()) {
+    int angle = m_stack.back();  // Counted on across north from the first tile, so the box does not wrap
+    m_stack.pop_back();
+    int t = m_stack.back();
+    m_stack.pop_back();
+
+    for (int n = 0; n < 4; n++) {
+      int a = angle + neighbours[n][0];
+      int next = t + neighbours[n][1];
+      int s = a >= 0 && a < spokes ? a : ((a % spokes) + spokes) % spokes;  // A ring goes round more than once
+      if (next < 0 || next >= tiles || m_component[(size_t)s * m_tiles + next] >= 0 || !Echo(s, next)) {
+        continue;
+      }
+      m_component[(size_t)s * m_tiles + next] = component;
+      m_stack.push_back(next);
+      m_stack.push_back(a);
+      box.angle_min = std::min(box.angle_min, a);
+      box.angle_max = std::max(box.angle_max, a);
+      box.r_min = std::min(box.r_min, next);
+      box.r_max = std::max(box.r_max, next);
+    }
+  }
+
+  if (box.angle_max - box.angle_min + 1 >= spokes) {
+    box.angle_min = 0;
+    box.angle_max = spokes - 1;
+  }
+  box.r_min <<= SECTOR_TILE_SHIFT;
+  box.r_max = ((box.r_max + 1) << SECTOR_TILE_SHIFT) - 1;
+  int item = AddItem(box);
+  m_echoes.push_back(item);
+  return item;
+}
+
+// Join 'item' with the echoes in the tiles of 'box'
+void SectorPartition::Touch(int item, SectorBox box) {
+  int span = std::min(box.angle_max - box.angle_min + 1, (int)m_spokes);
+  int tile_min = std::max(box.r_min, 0) >> SECTOR_TILE_SHIFT;
+  int tile_max = std::min(box.r_max, (int)m_spoke_len - 1);
+  int last = -1;
+
+  if (tile_max < 0) {
+    return;
+  }
+  tile_max >>= SECTOR_TILE_SHIFT;
+  for (int i = 0; i < span; i++) {
+    int spoke = (box.angle_min + i) % (int)m_spokes;
+    for (int t = tile_min; t <= tile_max; t++) {
+      int echo = m_component[(size_t)spoke * m_tiles + t];
+      if (echo >= 0 ? echo != last : Echo(spoke, t)) {
+        last = Flood(spoke, t);
+        Union(item, last);
+      }
+    }
+  }
+}
+
+void SectorPartition::AddTarget(const SectorBox *box, int angle, int r) {
+  if (!box) {
+    m_targets.push_back(-1);
+    return;
+  }
+
+  SectorBox look = *box;
+  if (r > 0 && r < (int)m_spoke_len) {
+    int spokes = (int)m_spokes;
+    int back = 0;
+    while (back < spokes && m_history->Test(HISTORY_DUPLICATE, (size_t)((((angle - back) % spokes) + spokes) % spokes), r)) {
+      back++;
+    }
+    if (back > 0) {
+      look.angle_min -= back - 1;
+    }
+  }
+  int item = AddItem(look);
+  m_targets.push_back(item);
+  Touch(item, m_items[item].box);
+}
+
+void SectorPartition::AddBlob(const SectorBox &box, int seed_angle, int seed_r) {
+  Blob blob = {box, seed_angle, seed_r};
+
+  m_blobs.push_back(blob);
+}
+
+void SectorPartition::MarkTargetSectors(const HistoryBlobs &blobs, std::vector<uint8_t> *sectors) const {
+  sectors->assign(blobs.GetSectorCount(), 0);
+  for (size_t t = 0; t < m_targets.size(); t++) {
+    if (m_targets[t] >= 0) {
+      const SectorBox &box = m_items[m_targets[t]].box;
+      blobs.MarkSectors(box.angle_min - m_margin, box.angle_max + m_margin, sectors);
+    }
+  }
+}
+
+// Draw the box of 'item' on the words, grown by the margin on every side when 'grow' is set. Items
+// whose boxes meet are joined, returns an item that was drawn there before or -1 when there was none.
+int SectorPartition::Draw(int item, bool grow) {
+  const SectorBox &box = m_items[item].box;
+  int margin = grow ? m_margin : 0;
+  int first = box.angle_min - margin + (int)m_spokes;  // Not negative, angle_min is in [0..spokes>
+  int span = std::min(box.angle_max - box.angle_min + 1 + 2 * margin, (int)m_spokes);
+  int word_min = std::max(box.r_min - margin, 0) >> 6;
+  int word_max = std::min(box.r_max + margin, (int)m_spoke_len - 1);
+  int met = -1;
+
+  if (word_max < 0) {
+    return -1;
+  }
+  word_max >>= 6;
+  for (int a = 0; a < span; a++) {
+    size_t spoke = (size_t)(first + a) % m_spokes;
+    for (int w = word_min; w <= word_max; w++) {
+      int &owner = m_owner[spoke * m_words + w];
+      if (owner < 0) {
+        owner = item;
+      } else if (owner != met) {
+        met = owner;
+        Union(owner, item);
+      }
+    }
+  }
+  return met;
+}
+
+size_t SectorPartition::Partition(std::vector<int> *groups) {
+  m_owner.assign(m_spokes * m_words, -1);
+
+  // The boxes that the targets look in
+  for (size_t t = 0; t < m_targets.size(); t++) {
+    if (m_targets[t] >= 0) {
+      Draw(m_targets[t], true);
+    }
+  }
+
+  // The blobs near those boxes, and the echoes that they start in
+  for (size_t b = 0; b < m_blobs.size(); b++) {
+    const Blob &blob = m_blobs[b];
+    int span = std::min(blob.box.angle_max - blob.box.angle_min + 1, (int)m_spokes);
+    int word_min = std::max(blob.box.r_min, 0) >> 6;
+    int word_max = std::min(blob.box.r_max, (int)m_spoke_len - 1) >> 6;
+    int seed_tile = blob.seed_r >> SECTOR_TILE_SHIFT;
+    int seed_spoke = ((blob.seed_angle % (int)m_spokes) + (int)m_spokes) % (int)m_spokes;
+    int near = -1;
+
+    for (int a = 0; a < span; a++) {
+      size_t spoke = (size_t)((blob.box.angle_min + a) % (int)m_spokes + (int)m_spokes) % m_spokes;
+      for (int w = word_min; w <= word_max; w++) {
+        int owner = m_owner[spoke * m_words + w];
+        if (owner >= 0) {
+          if (near >= 0) {
+            Union(near, owner);
+          }
+          near = owner;
+        }
+      }
+    }
+    if (near >= 0 && blob.seed_r >= 0 && blob.seed_r < (int)m_spoke_len && Echo(seed_spoke, seed_tile)) {
+      Union(near, Flood(seed_spoke, seed_tile));
+    }
+  }
+
+  // The echoes that the targets may follow, and the cells they clear around them
+  for (size_t e = 0; e < m_echoes.size(); e++) {
+    Draw(m_echoes[e], true);
+  }
+
+  size_t count = 0;
+  m_group.assign(m_items.size(), -1);
+  groups->resize(m_targets.size());
+  for (size_t t = 0; t < m_targets.size(); t++) {
+    if (m_targets[t] < 0) {
+      (*groups)[t] = (int)count++;
+      continue;
+    }
+    int root = Find(m_targets[t]);
+    if (m_group[root] < 0) {
+      m_group[root] = (int)count++;
+    }
+    (*groups)[t] = m_group[root];
+  }
+  return count;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,132 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _SECTOR_PARTITION_H_
+#define _SECTOR_PARTITION_H_
+
+#include <vector>
+
+#include "HistoryBlobs.h"
+#include "SpokeHistory.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Splits the ARPA targets in groups that touch different cells of the SpokeHistory when they
+// are refreshed, so the groups can be refreshed on separate threads without locking, and each
+// target ends up the same as when all targets are refreshed one after the other.
+//
+// A target looks for an echo in a box around its expected position, or picks a blob near
+// that box. It follows the contour of the echo that it finds and clears the cells around it.
+// So it touches the box, the blobs near it, and every echo connected to the cells in those.
+// The echoes are found by flooding tiles of 8 cells of one spoke that have a cell set in
+// HISTORY_DUPLICATE, which holds all cells of HISTORY_TARGET. Boxes and echoes are grown by
+// 'margin' cells on every side, in angle and in range, and those that then share a history word
+// are put in the same group, as clearing a cell rewrites its whole word. A target clears up to
+// 'margin' - 1 cells around the echo it follows, so two echoes far enough apart to be refreshed
+// in parallel are at least 2 * 'margin' spokes apart.
+//
+// The partition is only valid while nothing else writes to the history.
+//
+#define SECTOR_TILE_SHIFT (3)  // Tiles of 8 cells
+
+struct SectorBox {
+  int angle_min;  // First spoke, [0..spokes>
+  int angle_max;  // Last spoke, >= spokes across north
+  int r_min;      // Range of the cells
+  int r_max;      //
+};
+
+class SectorPartition {
+ public:
+  SectorPartition(size_t spokes, size_t spoke_len, int margin);
+
+  // Start over with the echoes that are in 'history' now
+  void Begin(SpokeHistory &history);
+
+  // Add the next target: it looks for echoes in 'box' around its expected position (angle, r).
+  // When that cell is an echo the target may first follow it back to the start of the echo on
+  // range r and look from there, see ArpaTarget::FindContourFromInside(). 'box' is 0 when the
+  // target will not look in the history at all.
+  void AddTarget(const SectorBox *box, int angle, int r);
+
+  // Add a blob that a target looking near 'box' may pick, it then follows the echo from the seed
+  void AddBlob(const SectorBox &box, int seed_angle, int seed_r);
+
+  // Set the sectors of 'blobs' that the boxes of the targets added so far are in, grown by the
+  // margin. Only the blobs in those sectors can join a target, so the others need not be added.
+  void MarkTargetSectors(const HistoryBlobs &blobs, std::vector<uint8_t> *sectors) const;
+
+  // Put the group of each target in 'groups', in the order the targets were added, and return the
+  // number of groups. Groups are numbered in the order of their first target.
+  size_t Partition(std::vector<int> *groups);
+
+ private:
+  struct Item {
+    SectorBox box;
+    int parent;  // Union-find
+  };
+
+  struct Blob {
+    SectorBox box;
+    int seed_angle;
+    int seed_r;
+  };
+
+  int AddItem(const SectorBox &box);
+  int Find(int item);
+  void Union(int a, int b);
+  bool Echo(int spoke, int tile);
+  int Flood(int spoke, int tile);
+  void Touch(int item, SectorBox box);  // A copy, Flood() adds items
+  int Draw(int item, bool grow);
+
+  size_t m_spokes;
+  size_t m_spoke_len;
+  size_t m_words;
+  size_t m_tiles;  // Per spoke
+  int m_margin;
+  SpokeHistory *m_history;
+
+  std::vector<int> m_component;  // m_spokes * m_tiles, item of the echo in the tile, -1 when not flooded yet
+  std::vector<Item> m_items;     // Targets that look in the history, and echoes
+  std::vector<int> m_targets;    // Item of each target, -1 when it does not look
+  std::vector<int> m_echoes;     // Items that are echoes
+  std::vector<Blob> m_blobs;     //
+  std::vector<int> m_stack;      // Flood(), pairs of tile and spoke counted on across north
+  std::vector<int> m_owner;      // m_spokes * m_words, Partition(): an item whose box covers the word
+  std::vector<int> m_group;      // Partition()
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _SECTOR_PARTITION_H_ */
@@ -0,0 +1,334 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "SpokeDecode.h"
+
+#include <string.h>
+#include "SpokeKernels.h"
+
+#if defined(CORE_SIMD_X86)
+#include <immintrin.h>
+#elif defined(CORE_SIMD_ARM)
+#include <arm_neon.h>
+#endif
+
+PLUGIN_BEGIN_NAMESPACE
+
+enum LookupSpokeEnum {
+  LOOKUP_SPOKE_LOW_NORMAL,
+  LOOKUP_SPOKE_LOW_BOTH,
+  LOOKUP_SPOKE_LOW_APPROACHING,
+  LOOKUP_SPOKE_HIGH_NORMAL,
+  LOOKUP_SPOKE_HIGH_BOTH,
+  LOOKUP_SPOKE_HIGH_APPROACHING
+};
+
+static uint8_t lookupData[6][256];
+
+void SpokeDecodeInit() {
+  if (lookupData[5][255] == 0) {
+    for (int j = 0; j <= UINT8_MAX; j++) {
+      uint8_t low = (j & 0x0f) << 4;
+      uint8_t high = (j & 0xf0);
+
+      lookupData[LOOKUP_SPOKE_LOW_NORMAL][j] = low;
+      lookupData[LOOKUP_SPOKE_HIGH_NORMAL][j] = high;
+
+      switch (low) {
+        case 0xf0:
+          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = 0xff;
+          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = 0xff;
+          break;
+
+        case 0xe0:
+          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = 0xfe;
+          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = low;
+          break;
+
+        default:
+          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = low;
+          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = low;
+      }
+
+      switch (high) {
+        case 0xf0:
+          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = 0xff;
+          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = 0xff;
+          break;
+
+        case 0xe0:
+          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = 0xfe;
+          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = high;
+          break;
+
+        default:
+          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = high;
+          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = high;
+      }
+    }
+    CoreSimdLevel level = SpokeDecodeSetSimdLevel(CoreGetSimdLevel());
+    CoreLog(CORE_LOG_INFO, "radar_pi: spoke decoding uses %s", CoreSimdLevelName(level));
+  }
+}
+
+typedef void (*NavicoUnpackFunction)(uint8_t *out, const uint8_t *packed, size_t packed_len, int doppler);
+
+static void NavicoUnpackScalar(uint8_t *out, const uint8_t *packed, size_t packed_len, int doppler) {
+  const uint8_t *lookup_low = lookupData[LOOKUP_SPOKE_LOW_NORMAL + doppler];
+  const uint8_t *lookup_high = lookupData[LOOKUP_SPOKE_HIGH_NORMAL + doppler];
+
+  for (size_t i = 0; i < packed_len; i++) {
+    out[2 * i] = lookup_low[packed[i]];
+    out[2 * i + 1] = lookup_high[packed[i]];
+  }
+}
+
+//
+// The vector versions compute the lookup table instead of reading it. Every nibble n
+// becomes n << 4, and then with doppler on 0xf0 turns into 0xff (approaching) and for
+// NAVICO_DOPPLER_BOTH 0xe0 turns into 0xfe (receding). This is done by comparing with
+// 0xf0 and 0xe0 and OR-ing in 'fix_f' and 'fix_e', which are zero when the mode
+// does not remap that value.
+//
+static inline void NavicoDopplerFix(int doppler, uint8_t *fix_f, uint8_t *fix_e) {
+  *fix_f = doppler != NAVICO_DOPPLER_OFF ? 0x0f : 0x00;
+  *fix_e = doppler == NAVICO_DOPPLER_BOTH ? 0x1e : 0x00;
+}
+
+#if defined(CORE_SIMD_X86)
+static void NavicoUnpackSSE2(uint8_t *out, const uint8_t *packed, size_t packed_len, int doppler) {
+  uint8_t f, e;
+  NavicoDopplerFix(doppler, &f, &e);
+  const __m128i mask = _mm_set1_epi8((char)0xf0);
+  const __m128i value_e = _mm_set1_epi8((char)0xe0);
+  const __m128i fix_f = _mm_set1_epi8((char)f);
+  const __m128i fix_e = _mm_set1_epi8((char)e);
+  size_t i = 0;
+
+  for (; i + 16 <= packed_len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(packed + i));
+    __m128i low = _mm_and_si128(_mm_slli_epi16(v, 4), mask);
+    __m128i high = _mm_and_si128(v, mask);
+
+    low = _mm_or_si128(low, _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi8(low, mask), fix_f),
+                                         _mm_and_si128(_mm_cmpeq_epi8(low, value_e), fix_e)));
+    high = _mm_or_si128(high, _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi8(high, mask), fix_f),
+                                           _mm_and_si128(_mm_cmpeq_epi8(high, value_e), fix_e)));
+    _mm_storeu_si128((__m128i *)(out + 2 * i), _mm_unpacklo_epi8(low, high));
+    _mm_storeu_si128((__m128i *)(out + 2 * i + 16), _mm_unpackhi_epi8(low, high));
+  }
+  NavicoUnpackScalar(out + 2 * i, packed + i, packed_len - i, doppler);
+}
+
+CORE_TARGET_AVX2 static void NavicoUnpackAVX2(uint8_t *out, const uint8_t *packed, size_t packed_len, int doppler) {
+  uint8_t f, e;
+  NavicoDopplerFix(doppler, &f, &e);
+  const __m256i mask = _mm256_set1_epi8((char)0xf0);
+  const __m256i value_e = _mm256_set1_epi8((char)0xe0);
+  const __m256i fix_f = _mm256_set1_epi8((char)f);
+  const __m256i fix_e = _mm256_set1_epi8((char)e);
+  size_t i = 0;
+
+  for (; i + 32 <= packed_len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(packed + i));
+    __m256i low = _mm256_and_si256(_mm256_slli_epi16(v, 4), mask);
+    __m256i high = _mm256_and_si256(v, mask);
+
+    low = _mm256_or_si256(low, _mm256_or_si256(_mm256_and_si256(_mm256_cmpeq_epi8(low, mask), fix_f),
+                                               _mm256_and_si256(_mm256_cmpeq_epi8(low, value_e), fix_e)));
+    high = _mm256_or_si256(high, _mm256_or_si256(_mm256_and_si256(_mm256_cmpeq_epi8(high, mask), fix_f),
+                                                 _mm256_and_si256(_mm256_cmpeq_epi8(high, value_e), fix_e)));
+
+    // unpack works per 128 bit lane, so the halves come out as [0-7, 16-23] and [8-15, 24-31]
+    __m256i first = _mm256_unpacklo_epi8(low, high);
+    __m256i second = _mm256_unpackhi_epi8(low, high);
+    _mm256_storeu_si256((__m256i *)(out + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+    _mm256_storeu_si256((__m256i *)(out + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+  }
+  _mm256_zeroupper();  // Avoid the AVX to SSE transition penalty in the code that follows
+  NavicoUnpackScalar(out + 2 * i, packed + i, packed_len - i, doppler);
+}
+#endif
+
+#if defined(CORE_SIMD_ARM)
+static void NavicoUnpackNEON(uint8_t *out, const uint8_t *packed, size_t packed_len, int doppler) {
+  uint8_t f, e;
+  NavicoDopplerFix(doppler, &f, &e);
+  const uint8x16_t mask = vdupq_n_u8(0xf0);
+  const uint8x16_t value_e = vdupq_n_u8(0xe0);
+  const uint8x16_t fix_f = vdupq_n_u8(f);
+  const uint8x16_t fix_e = vdupq_n_u8(e);
+  size_t i = 0;
+
+  for (; i + 16 <= packed_len; i += 16) {
+    uint8x16_t v = vld1q_u8(packed + i);
+    uint8x16x2_t lh;
+
+    lh.val[0] = vshlq_n_u8(v, 4);
+    lh.val[1] = vandq_u8(v, mask);
+    for (int n = 0; n < 2; n++) {
+      lh.val[n] = vorrq_u8(lh.val[n], vorrq_u8(vandq_u8(vceqq_u8(lh.val[n], mask), fix_f),
+                                                vandq_u8(vceqq_u8(lh.val[n], value_e), fix_e)));
+    }
+    vst2q_u8(out + 2 * i, lh);  // Interleaves low and high
+  }
+  NavicoUnpackScalar(out + 2 * i, packed + i, packed_len - i, doppler);
+}
+#endif
+
+typedef void (*GarminHDExpandFunction)(uint8_t *out, const uint8_t *packed, size_t packed_len);
+
+static void GarminHDExpandScalar(uint8_t *out, const uint8_t *packed, size_t packed_len) {
+  uint8_t *p = out;
+  const uint8_t *s = packed;
+
+  for (size_t i = 0; i < packed_len; i++, s++) {
+    *p++ = (*s & 0x01) > 0 ? 255 : 0;
+    *p++ = (*s & 0x02) > 0 ? 255 : 0;
+    *p++ = (*s & 0x04) > 0 ? 255 : 0;
+    *p++ = (*s & 0x08) > 0 ? 255 : 0;
+    *p++ = (*s & 0x10) > 0 ? 255 : 0;
+    *p++ = (*s & 0x20) > 0 ? 255 : 0;
+    *p++ = (*s & 0x40) > 0 ? 255 : 0;
+    *p++ = (*s & 0x80) > 0 ? 255 : 0;
+  }
+}
+
+//
+// The vector versions broadcast every input byte to eight output bytes, AND those
+// with the bit that each output byte represents and compare that with the bit,
+// which gives 0xff for a set bit and 0x00 otherwise.
+//
+#if defined(CORE_SIMD_X86)
+static void GarminHDExpandSSE2(uint8_t *out, const uint8_t *packed, size_t packed_len) {
+  const __m128i bits = _mm_set_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04,
+                                    0x02, 0x01);
+  size_t i = 0;
+
+  for (; i + 16 <= packed_len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(packed + i));
+    __m128i bytes2[2] = {_mm_unpacklo_epi8(v, v), _mm_unpackhi_epi8(v, v)};  // Every byte twice
+
+    for (int h = 0; h < 2; h++) {
+      __m128i bytes4[2] = {_mm_unpacklo_epi16(bytes2[h], bytes2[h]), _mm_unpackhi_epi16(bytes2[h], bytes2[h])};
+
+      for (int q = 0; q < 2; q++) {
+        __m128i bytes8[2] = {_mm_unpacklo_epi32(bytes4[q], bytes4[q]), _mm_unpackhi_epi32(bytes4[q], bytes4[q])};
+        uint8_t *d = out + 8 * i + 64 * h + 32 * q;
+
+        _mm_storeu_si128((__m128i *)d, _mm_cmpeq_epi8(_mm_and_si128(bytes8[0], bits), bits));
+        _mm_storeu_si128((__m128i *)(d + 16), _mm_cmpeq_epi8(_mm_and_si128(bytes8[1], bits), bits));
+      }
+    }
+  }
+  GarminHDExpandScalar(out + 8 * i, packed + i, packed_len - i);
+}
+
+CORE_TARGET_AVX2 static void GarminHDExpandAVX2(uint8_t *out, const uint8_t *packed, size_t packed_len) {
+  const __m256i bits = _mm256_set1_epi64x((long long)0x8040201008040201ULL);
+  // Byte n of the output comes from byte n / 8 of the input, shuffle works per 128 bit lane
+  const __m256i spread =
+      _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+  size_t i = 0;
+
+  for (; i + 4 <= packed_len; i += 4) {
+    int32_t four;
+    memcpy(&four, packed + i, sizeof(four));
+    __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(four), spread);
+    _mm256_storeu_si256((__m256i *)(out + 8 * i), _mm256_cmpeq_epi8(_mm256_and_si256(v, bits), bits));
+  }
+  _mm256_zeroupper();  // Avoid the AVX to SSE transition penalty in the code that follows
+  GarminHDExpandScalar(out + 8 * i, packed + i, packed_len - i);
+}
+#endif
+
+#if defined(CORE_SIMD_ARM)
+static void GarminHDExpandNEON(uint8_t *out, const uint8_t *packed, size_t packed_len) {
+  static const uint8_t bit_values[16] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                                         0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+  const uint8x16_t bits = vld1q_u8(bit_values);
+  size_t i = 0;
+
+  for (; i + 2 <= packed_len; i += 2) {
+    uint8x16_t v = vcombine_u8(vdup_n_u8(packed[i]), vdup_n_u8(packed[i + 1]));
+    vst1q_u8(out + 8 * i, vtstq_u8(v, bits));  // 0xff where (v & bits) != 0
+  }
+  GarminHDExpandScalar(out + 8 * i, packed + i, packed_len - i);
+}
+#endif
+
+static NavicoUnpackFunction navicoUnpack = NavicoUnpackScalar;
+static GarminHDExpandFunction garminHDExpand = GarminHDExpandScalar;
+
+CoreSimdLevel SpokeDecodeSetSimdLevel(CoreSimdLevel level) {
+  CoreSimdLevel best = CoreGetSimdLevel();
+
+  if (level > best) {
+    level = best;
+  }
+  switch (level) {
+#if defined(CORE_SIMD_X86)
+    case CORE_SIMD_AVX2:
+      navicoUnpack = NavicoUnpackAVX2;
+      garminHDExpand = GarminHDExpandAVX2;
+      break;
+    case CORE_SIMD_SSE2:
+      navicoUnpack = NavicoUnpackSSE2;
+      garminHDExpand = GarminHDExpandSSE2;
+      break;
+#endif
+#if defined(CORE_SIMD_ARM)
+    case CORE_SIMD_NEON:
+      navicoUnpack = NavicoUnpackNEON;
+      garminHDExpand = GarminHDExpandNEON;
+      break;
+#endif
+    default:
+      level = CORE_SIMD_NONE;
+      navicoUnpack = NavicoUnpackScalar;
+      garminHDExpand = GarminHDExpandScalar;
+      break;
+  }
+  SpokeKernelsSetSimdLevel(level);
+  return level;
+}
+
+void NavicoUnpackSpoke(uint8_t *out, const uint8_t *packed, size_t packed_len, int doppler) {
+  if (doppler < NAVICO_DOPPLER_OFF || doppler > NAVICO_DOPPLER_APPROACHING) {
+    doppler = NAVICO_DOPPLER_OFF;
+  }
+  navicoUnpack(out, packed, packed_len, doppler);
+}
+
+void GarminHDExpandSpoke(uint8_t *out, const uint8_t *packed, size_t packed_len) { garminHDExpand(out, packed, packed_len); }
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,68 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _SPOKE_DECODE_H_
+#define _SPOKE_DECODE_H_
+
+#include "RadarCore.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Conversion of the packed sample formats sent by the radars into the
+// one byte per sample format used by the rest of the plugin.
+//
+
+// Must be called once before the first use of the functions below, from a single thread.
+// Builds the lookup tables and selects the best implementation for this CPU.
+extern void SpokeDecodeInit();
+
+// Select the implementation used by the functions below and by the vectorized kernels in
+// SpokeKernels.h. When 'level' is not supported by this build or CPU the next lower level
+// is used. Returns the level selected.
+// Not thread safe, only for initialization and benchmarks.
+extern CoreSimdLevel SpokeDecodeSetSimdLevel(CoreSimdLevel level);
+
+// Navico: two 4 bit samples per byte, low nibble first.
+// The doppler mode selects how the top two levels are mapped, see SpokeDecodeInit().
+enum NavicoDopplerMode { NAVICO_DOPPLER_OFF = 0, NAVICO_DOPPLER_BOTH = 1, NAVICO_DOPPLER_APPROACHING = 2 };
+
+// Expand 'packed_len' bytes into 2 * 'packed_len' samples in 'out'.
+extern void NavicoUnpackSpoke(uint8_t *out, const uint8_t *packed, size_t packed_len, int doppler);
+
+// Garmin HD: eight 1 bit samples per byte, least significant bit first.
+// Expand 'packed_len' bytes into 8 * 'packed_len' samples of 0 or 255 in 'out'.
+extern void GarminHDExpandSpoke(uint8_t *out, const uint8_t *packed, size_t packed_len);
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _SPOKE_DECODE_H_ */
@@ -0,0 +1,116 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "SpokeHistory.h"
+
+#include <string.h>
+#include "SpokeKernels.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define WORDS_PER_CACHE_LINE (CORE_CACHE_LINE / sizeof(uint64_t))
+
+SpokeHistory::SpokeHistory(size_t spokes, size_t spoke_len) {
+  m_spokes = spokes;
+  m_spoke_len = spoke_len;
+  m_words = (spoke_len + 63) / 64;
+  m_words = (m_words + WORDS_PER_CACHE_LINE - 1) & ~(size_t)(WORDS_PER_CACHE_LINE - 1);
+  for (int p = 0; p < HISTORY_PLANES; p++) {
+    m_plane[p] = (uint64_t *)CoreAlignedAlloc(m_spokes * m_words * sizeof(uint64_t), CORE_CACHE_LINE, true);
+  }
+  m_guard = (uint64_t *)CoreAlignedAlloc(m_words * sizeof(uint64_t), CORE_CACHE_LINE);
+  m_guard_counts = (uint32_t *)CoreAlignedAlloc((m_words + 1) * sizeof(uint32_t), CORE_CACHE_LINE);
+  m_time = (int64_t *)CoreAlignedAlloc(m_spokes * sizeof(int64_t), CORE_CACHE_LINE);
+  m_pos = (GeoPosition *)CoreAlignedAlloc(m_spokes * sizeof(GeoPosition), CORE_CACHE_LINE);
+}
+
+SpokeHistory::~SpokeHistory() {
+  for (int p = 0; p < HISTORY_PLANES; p++) {
+    CoreAlignedFree(m_plane[p]);
+  }
+  CoreAlignedFree(m_guard);
+  CoreAlignedFree(m_guard_counts);
+  CoreAlignedFree(m_time);
+  CoreAlignedFree(m_pos);
+}
+
+void SpokeHistory::Clear() {
+  for (int p = 0; p < HISTORY_PLANES; p++) {
+    memset(m_plane[p], 0, m_spokes * m_words * sizeof(uint64_t));
+  }
+  memset(m_guard, 0, m_words * sizeof(uint64_t));
+  memset(m_time, 0, m_spokes * sizeof(int64_t));
+  memset(m_pos, 0, m_spokes * sizeof(GeoPosition));
+}
+
+void SpokeHistory::SetSpoke(size_t spoke, const uint8_t *data, size_t len, uint8_t threshold, uint8_t guard_threshold) {
+  uint64_t *target = Row(HISTORY_TARGET, spoke);
+
+  if (len > m_spoke_len) {
+    len = m_spoke_len;
+  }
+  SpokeThresholdBits(target, m_guard, m_words, data, len, threshold, guard_threshold);
+  memcpy(Row(HISTORY_DUPLICATE, spoke), target, m_words * sizeof(uint64_t));
+}
+
+const uint32_t *SpokeHistory::CountGuardRow() {
+  SpokeBitsPrefix(m_guard_counts, m_guard, m_words);
+  return m_guard_counts;
+}
+
+void SpokeHistory::ClearCells(size_t spoke, size_t start, size_t end, int planes) {
+  size_t first = start >> 6;
+  size_t last = end >> 6;
+  uint64_t first_mask = ~(uint64_t)0 << (start & 63);
+  uint64_t last_mask = ~(uint64_t)0 >> (63 - (end & 63));
+
+  if (start > end || last >= m_words) {
+    return;
+  }
+  for (int p = 0; p < HISTORY_PLANES; p++) {
+    if (!(planes & HISTORY_PLANE_BIT(p))) {
+      continue;
+    }
+    uint64_t *row = Row((HistoryPlane)p, spoke);
+    if (first == last) {
+      row[first] &= ~(first_mask & last_mask);
+    } else {
+      row[first] &= ~first_mask;
+      for (size_t w = first + 1; w < last; w++) {
+        row[w] = 0;
+      }
+      row[last] &= ~last_mask;
+    }
+  }
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,112 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _SPOKE_HISTORY_H_
+#define _SPOKE_HISTORY_H_
+
+#include "RadarCore.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// The last revolution of thresholded spokes, as used by ARPA and the guard zones,
+// plus the time and boat position at which each spoke was received.
+//
+// Only two bits of information are kept per range cell, so the history is stored as
+// two bit planes of 64 cells per word:
+//
+// HISTORY_TARGET     Echo that can still become (part of) a target. Cleared when a blob
+//                    has been handled, so it is not found again in the same sweep.
+// HISTORY_DUPLICATE  Echo, only cleared when a blob turned out to be too small. Used to
+//                    check whether a new target duplicates an existing one.
+//
+// SetSpoke() also keeps one row with the cells of the latest spoke at or above the
+// (weaker) guard zone threshold, so the guard zones can count their echoes from that
+// without reading the samples again. CountGuardRow() counts that row once for all zones.
+//
+// Each row of a plane starts on a cache line boundary. Times and positions are kept in
+// their own arrays, so walking a contour across spokes only touches one plane.
+// Large planes are allocated on huge pages when the system allows it.
+//
+enum HistoryPlane { HISTORY_TARGET, HISTORY_DUPLICATE, HISTORY_PLANES };
+
+#define HISTORY_PLANE_BIT(p) (1 << (p))
+#define HISTORY_ALL_PLANES (HISTORY_PLANE_BIT(HISTORY_TARGET) | HISTORY_PLANE_BIT(HISTORY_DUPLICATE))
+
+class SpokeHistory {
+ public:
+  SpokeHistory(size_t spokes, size_t spoke_len);
+  ~SpokeHistory();
+
+  // Zero all planes, times and positions
+  void Clear();
+
+  size_t GetSpokes() const { return m_spokes; }
+  size_t GetSpokeLen() const { return m_spoke_len; }
+  size_t GetWords() const { return m_words; }  // # of uint64_t in a row, a multiple of 8
+
+  // 'spoke' must be in [0, GetSpokes()>, the caller takes care of wrapping
+  uint64_t *Row(HistoryPlane plane, size_t spoke) { return m_plane[plane] + spoke * m_words; }
+  int64_t &Time(size_t spoke) { return m_time[spoke]; }  // millis, see CoreGetTimeMillis()
+  GeoPosition &Pos(size_t spoke) { return m_pos[spoke]; }
+
+  // 'r' must be in [0, GetSpokeLen()>
+  bool Test(HistoryPlane plane, size_t spoke, size_t r) { return (Row(plane, spoke)[r >> 6] >> (r & 63)) & 1; }
+
+  // Threshold a spoke in one pass: set both planes where data >= threshold and the guard row
+  // where data >= guard_threshold, clear the rest of the rows
+  void SetSpoke(size_t spoke, const uint8_t *data, size_t len, uint8_t threshold, uint8_t guard_threshold);
+
+  // The guard row of the latest SetSpoke(), see SpokeBitsCount()
+  const uint64_t *GuardRow() const { return m_guard; }
+
+  // Count the guard row once so that every guard zone can count its range in constant time,
+  // returns the counts for SpokeBitsCountPrefix()
+  const uint32_t *CountGuardRow();
+
+  // Clear cells [start, end] (inclusive) of 'spoke' in the planes given as HISTORY_PLANE_BIT()s
+  void ClearCells(size_t spoke, size_t start, size_t end, int planes);
+
+ private:
+  size_t m_spokes;
+  size_t m_spoke_len;
+  size_t m_words;
+  uint64_t *m_plane[HISTORY_PLANES];  // m_spokes * m_words each
+  uint64_t *m_guard;                  // m_words
+  uint32_t *m_guard_counts;           // m_words + 1
+  int64_t *m_time;
+  GeoPosition *m_pos;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _SPOKE_HISTORY_H_ */
@@ -0,0 +1,492 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "SpokeKernels.h"
+
+#include <string.h>
+
+#if defined(CORE_SIMD_X86)
+#include <immintrin.h>
+#elif defined(CORE_SIMD_ARM)
+#include <arm_neon.h>
+#endif
+
+PLUGIN_BEGIN_NAMESPACE
+
+typedef void (*ThresholdBitsFunction)(uint64_t *strong, uint64_t *weak, size_t words, const uint8_t *data, size_t len,
+                                      uint8_t strong_threshold, uint8_t weak_threshold);
+
+static void ThresholdBitsScalar(uint64_t *strong, uint64_t *weak, size_t words, const uint8_t *data, size_t len,
+                                uint8_t strong_threshold, uint8_t weak_threshold) {
+  for (size_t w = 0; w < words; w++, data += 64) {
+    size_t n = len > 64 ? 64 : len;
+    uint64_t s = 0;
+    uint64_t k = 0;
+
+    for (size_t i = 0; i < n; i++) {
+      s |= (uint64_t)(data[i] >= strong_threshold) << i;
+      k |= (uint64_t)(data[i] >= weak_threshold) << i;
+    }
+    strong[w] = s;
+    weak[w] = k;
+    len -= n;
+  }
+}
+
+//
+// The vector versions compare 64 samples at a time, using max(v, t) == v for the
+// unsigned v >= t, and collect the sign bits of the comparison results into one word
+// per threshold. The tail is left to the scalar code.
+//
+#if defined(CORE_SIMD_X86)
+static void ThresholdBitsSSE2(uint64_t *strong, uint64_t *weak, size_t words, const uint8_t *data, size_t len,
+                              uint8_t strong_threshold, uint8_t weak_threshold) {
+  const __m128i ts = _mm_set1_epi8((char)strong_threshold);
+  const __m128i tw = _mm_set1_epi8((char)weak_threshold);
+  size_t w = 0;
+
+  for (; w < words && (w + 1) * 64 <= len; w++) {
+    uint64_t s = 0;
+    uint64_t k = 0;
+
+    for (int q = 0; q < 4; q++) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(data + 64 * w + 16 * q));
+      s |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, ts), v)) << (16 * q);
+      k |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, tw), v)) << (16 * q);
+    }
+    strong[w] = s;
+    weak[w] = k;
+  }
+  ThresholdBitsScalar(strong + w, weak + w, words - w, data + 64 * w, len - 64 * w, strong_threshold, weak_threshold);
+}
+
+CORE_TARGET_AVX2 static void ThresholdBitsAVX2(uint64_t *strong, uint64_t *weak, size_t words, const uint8_t *data, size_t len,
+                                               uint8_t strong_threshold, uint8_t weak_threshold) {
+  const __m256i ts = _mm256_set1_epi8((char)strong_threshold);
+  const __m256i tw = _mm256_set1_epi8((char)weak_threshold);
+  size_t w = 0;
+
+  for (; w < words && (w + 1) * 64 <= len; w++) {
+    __m256i lo = _mm256_loadu_si256((const __m256i *)(data + 64 * w));
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(data + 64 * w + 32));
+
+    strong[w] = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(lo, ts), lo)) |
+                (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(hi, ts), hi)) << 32;
+    weak[w] = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(lo, tw), lo)) |
+              (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(hi, tw), hi)) << 32;
+  }
+  _mm256_zeroupper();  // Avoid the AVX to SSE transition penalty in the code that follows
+  ThresholdBitsScalar(strong + w, weak + w, words - w, data + 64 * w, len - 64 * w, strong_threshold, weak_threshold);
+}
+#endif
+
+#if defined(CORE_SIMD_ARM)
+// NEON has no movemask: weigh every lane with its bit and add the lanes of each half.
+static inline uint16_t MoveMaskNEON(uint8x16_t mask) {
+  static const uint8_t bit_values[16] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                                         0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+  uint8x16_t bits = vandq_u8(mask, vld1q_u8(bit_values));
+  uint8x8_t sum = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+
+  sum = vpadd_u8(sum, sum);
+  sum = vpadd_u8(sum, sum);
+  return (uint16_t)(vget_lane_u8(sum, 0) | (vget_lane_u8(sum, 1) << 8));
+}
+
+static void ThresholdBitsNEON(uint64_t *strong, uint64_t *weak, size_t words, const uint8_t *data, size_t len,
+                              uint8_t strong_threshold, uint8_t weak_threshold) {
+  const uint8x16_t ts = vdupq_n_u8(strong_threshold);
+  const uint8x16_t tw = vdupq_n_u8(weak_threshold);
+  size_t w = 0;
+
+  for (; w < words && (w + 1) * 64 <= len; w++) {
+    uint64_t s = 0;
+    uint64_t k = 0;
+
+    for (int q = 0; q < 4; q++) {
+      uint8x16_t v = vld1q_u8(data + 64 * w + 16 * q);
+      s |= (uint64_t)MoveMaskNEON(vcgeq_u8(v, ts)) << (16 * q);
+      k |= (uint64_t)MoveMaskNEON(vcgeq_u8(v, tw)) << (16 * q);
+    }
+    strong[w] = s;
+    weak[w] = k;
+  }
+  ThresholdBitsScalar(strong + w, weak + w, words - w, data + 64 * w, len - 64 * w, strong_threshold, weak_threshold);
+}
+#endif
+
+static ThresholdBitsFunction thresholdBits = ThresholdBitsScalar;
+
+CoreSimdLevel SpokeKernelsSetSimdLevel(CoreSimdLevel level) {
+  CoreSimdLevel best = CoreGetSimdLevel();
+
+  if (level > best) {
+    level = best;
+  }
+  switch (level) {
+#if defined(CORE_SIMD_X86)
+    case CORE_SIMD_AVX2:
+      thresholdBits = ThresholdBitsAVX2;
+      break;
+    case CORE_SIMD_SSE2:
+      thresholdBits = ThresholdBitsSSE2;
+      break;
+#endif
+#if defined(CORE_SIMD_ARM)
+    case CORE_SIMD_NEON:
+      thresholdBits = ThresholdBitsNEON;
+      break;
+#endif
+    default:
+      level = CORE_SIMD_NONE;
+      thresholdBits = ThresholdBitsScalar;
+      break;
+  }
+  return level;
+}
+
+void SpokeThresholdBits(uint64_t *strong, uint64_t *weak, size_t words, const uint8_t *data, size_t len,
+                        uint8_t strong_threshold, uint8_t weak_threshold) {
+  if (len > words * 64) {
+    len = words * 64;
+  }
+  thresholdBits(strong, weak, words, data, len, strong_threshold, weak_threshold);
+}
+
+size_t SpokeBitsCount(const uint64_t *bits, size_t start, size_t end) {
+  size_t first = start >> 6;
+  size_t last = end >> 6;
+  uint64_t first_mask = ~(uint64_t)0 << (start & 63);
+  uint64_t last_mask = ~(uint64_t)0 >> (63 - (end & 63));
+  size_t count;
+
+  if (start > end) {
+    return 0;
+  }
+  if (first == last) {
+    return CorePopCount64(bits[first] & first_mask & last_mask);
+  }
+  count = CorePopCount64(bits[first] & first_mask);
+  for (size_t w = first + 1; w < last; w++) {
+    count += CorePopCount64(bits[w]);
+  }
+  return count + CorePopCount64(bits[last] & last_mask);
+}
+
+void SpokeBitsPrefix(uint32_t *counts, const uint64_t *bits, size_t words) {
+  uint32_t count = 0;
+
+  for (size_t w = 0; w < words; w++) {
+    counts[w] = count;
+    count += (uint32_t)CorePopCount64(bits[w]);
+  }
+  counts[words] = count;
+}
+
+// Number of bits set in bits[0..n>
+static inline size_t SpokeBitsBefore(const uint32_t *counts, const uint64_t *bits, size_t n) {
+  if ((n & 63) == 0) {
+    return counts[n >> 6];
+  }
+  return counts[n >> 6] + CorePopCount64(bits[n >> 6] & ~(~(uint64_t)0 << (n & 63)));
+}
+
+size_t SpokeBitsCountPrefix(const uint32_t *counts, const uint64_t *bits, size_t start, size_t end) {
+  if (start > end) {
+    return 0;
+  }
+  return SpokeBitsBefore(counts, bits, end + 1) - SpokeBitsBefore(counts, bits, start);
+}
+
+void TrailsUpdateRelative(TrailStamp *trail, size_t spoke_len_max, uint8_t *data, size_t len, const TrailUpdate &update) {
+  size_t length = len > 0 ? len - 1 : 0;  // len - 1 : no trails on range circle
+  size_t radius = 0;
+
+  if (update.colour) {
+    for (; radius < length; radius++) {
+      if (data[radius] >= update.strong) {
+        trail[radius] = update.revolution;
+      } else if (data[radius] < update.weak) {
+        data[radius] = update.colour[TrailAge(trail[radius], update)];
+      }
+    }
+  } else {
+    for (; radius < length; radius++) {
+      if (data[radius] >= update.strong) {
+        trail[radius] = update.revolution;
+      }
+    }
+  }
+
+  if (radius < spoke_len_max) {  // And clear out empty bit of spoke when spoke_len < max_spoke_len
+    memset(trail + radius, 0, (spoke_len_max - radius) * sizeof(TrailStamp));
+  }
+}
+
+// TrailsUpdateTrue() for one quadrant, so that rotating the points costs nothing
+template <int quadrant>
+static void TrailsUpdateTrueQuadrant(TrailStamp *trails, int trail_size, int offset_x, int offset_y, const PointInt *points,
+                                     uint8_t *data, size_t len, const TrailUpdate &update) {
+  size_t length = len > 0 ? len - 1 : 0;  // len - 1 : no trails on range circle
+
+  for (size_t radius = 0; radius < length; radius++) {
+    if (!update.colour && data[radius] < update.strong) {
+      continue;  // Nothing to stamp or colour, so no need to look up the cell
+    }
+
+    PointInt point = RotatePointInt<quadrant>(points[radius]);
+
+    // when ship moves north, offset.lat > 0. Add to move trails image in opposite direction
+    // when ship moves east, offset.lon > 0. Add to move trails image in opposite direction
+    point.x += offset_x;
+    point.y += offset_y;
+
+    // The image wraps around, and a spoke is never longer than half of it
+    if (point.x < 0) {
+      point.x += trail_size;
+    } else if (point.x >= trail_size) {
+      point.x -= trail_size;
+    }
+    if (point.y < 0) {
+      point.y += trail_size;
+    } else if (point.y >= trail_size) {
+      point.y -= trail_size;
+    }
+
+    TrailStamp *trail = &trails[point.x * trail_size + point.y];
+    if (data[radius] >= update.strong) {
+      *trail = update.revolution;
+    } else if (update.colour && data[radius] < update.weak) {
+      data[radius] = update.colour[TrailAge(*trail, update)];
+    }
+  }
+}
+
+void TrailsUpdateTrue(TrailStamp *trails, int trail_size, int offset_x, int offset_y, const PointIntRow &points, uint8_t *data,
+                      size_t len, const TrailUpdate &update) {
+  switch (points.quadrant) {
+    case 1:
+      TrailsUpdateTrueQuadrant<1>(trails, trail_size, offset_x, offset_y, points.points, data, len, update);
+      break;
+    case 2:
+      TrailsUpdateTrueQuadrant<2>(trails, trail_size, offset_x, offset_y, points.points, data, len, update);
+      break;
+    case 3:
+      TrailsUpdateTrueQuadrant<3>(trails, trail_size, offset_x, offset_y, points.points, data, len, update);
+      break;
+    default:
+      TrailsUpdateTrueQuadrant<0>(trails, trail_size, offset_x, offset_y, points.points, data, len, update);
+      break;
+  }
+}
+
+void TrailsRenormalize(TrailStamp *trails, size_t count, const TrailUpdate &update) {
+  int oldest = (int)update.revolution - (update.max_age - 1);  // The stamp that has age max_age
+
+  if (oldest <= 0) {
+    oldest += TRAIL_STAMPS;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (trails[i] && TrailAge(trails[i], update) >= update.max_age) {
+      trails[i] = (TrailStamp)oldest;
+    }
+  }
+}
+
+void TrailsZoomIndex(TrailZoomMap &map, int trail_size, int margin, int offset, float zoom_factor) {
+  map.count = 0;
+  for (int i = margin; i < trail_size - margin; i++) {
+    int target = (int)(((double)i - (double)trail_size / 2) * zoom_factor + (double)trail_size / 2);
+    if (target >= trail_size - 1) {
+      break;  // allow adding an additional pixel later
+    }
+    if (target < 0) {
+      continue;
+    }
+    map.source[map.count] = ((i - trail_size / 2 + offset) % trail_size + trail_size) % trail_size;
+    map.target[map.count] = target;
+    map.wrapped[map.count] = ((target - trail_size / 2 + offset) % trail_size + trail_size) % trail_size;
+    map.count++;
+  }
+}
+
+void TrailsZoomTrue(TrailStamp *dst, const TrailStamp *src, int trail_size, int offset, const TrailZoomMap &rows,
+                    const TrailZoomMap &columns, float zoom_factor, int first, int end) {
+  bool extra_column = zoom_factor > 1.2;  // add an extra pixel in the y direction
+  bool extra_row = zoom_factor > 1.6;     // also add pixels in the x direction
+
+  for (int target = first; target < end; target++) {
+    int x = ((target - trail_size / 2 + offset) % trail_size + trail_size) % trail_size;
+    memset(dst + x * trail_size, 0, trail_size * sizeof(TrailStamp));
+  }
+
+  // The targets are ascending, so find the first one that may touch our rows
+  int low = 0;
+  int high = rows.count;
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (rows.target[middle] + 1 < first) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  for (int n = low; n < rows.count; n++) {
+    int target = rows.target[n];
+    bool row = target >= first && target < end;
+    bool next_row = extra_row && target + 1 >= first && target + 1 < end;
+
+    if (target >= end) {
+      break;
+    }
+    if (!row && !next_row) {
+      continue;
+    }
+
+    const TrailStamp *from = src + rows.source[n] * trail_size;
+    int x = rows.wrapped[n];
+    TrailStamp *to = dst + x * trail_size;
+    TrailStamp *to_next = dst + (x + 1 < trail_size ? x + 1 : 0) * trail_size;
+
+    for (int m = 0; m < columns.count; m++) {
+      TrailStamp pixel = from[columns.source[m]];
+      if (pixel != 0) {  // many to one mapping, prevent overwriting trails with 0
+        int y = columns.wrapped[m];
+        int next_y = y + 1 < trail_size ? y + 1 : 0;
+
+        if (row) {
+          to[y] = pixel;
+          if (extra_column) {
+            to[next_y] = pixel;
+          }
+        }
+        if (next_row) {
+          to_next[y] = pixel;
+          to_next[next_y] = pixel;
+        }
+      }
+    }
+  }
+}
+
+size_t TrailsZoomRelativeIndex(int *target, size_t spoke_len_max, float zoom_factor) {
+  size_t count = 0;
+
+  for (; count < spoke_len_max; count++) {
+    int index_j = count * zoom_factor;
+    if (index_j >= (int)spoke_len_max) {
+      break;
+    }
+    target[count] = index_j;
+  }
+  return count;
+}
+
+void TrailsZoomRelative(TrailStamp *dst, const TrailStamp *src, size_t spoke_len_max, size_t first, size_t end,
+                        const int *target, size_t count) {
+  memset(dst + first * spoke_len_max, 0, (end - first) * spoke_len_max * sizeof(TrailStamp));
+
+  for (size_t i = first; i < end; i++) {
+    const TrailStamp *from = src + i * spoke_len_max;
+    TrailStamp *to = dst + i * spoke_len_max;
+
+    for (size_t j = 0; j < count; j++) {
+      if (from[j] != 0) {
+        to[target[j]] = from[j];
+      }
+    }
+  }
+}
+
+void SpokeToRGBA(uint8_t *texture, size_t spoke_len_max, const uint8_t *data, size_t len, const uint8_t rgba[256][4]) {
+  uint8_t *d = texture;
+
+  for (size_t r = 0; r < len; r++) {
+    memcpy(d, rgba[data[r]], 4);
+    d += 4;
+  }
+  if (len < spoke_len_max) {
+    memset(d, 0, (spoke_len_max - len) * 4);
+  }
+}
+
+void SpokeToLuminance(uint8_t *texture, size_t spoke_len_max, const uint8_t *data, size_t len, const uint8_t luminance[256]) {
+  uint8_t *d = texture;
+
+  for (size_t r = 0; r < len; r++) {
+    *d++ = luminance[data[r]];
+  }
+  if (len < spoke_len_max) {
+    memset(d, 0, spoke_len_max - len);
+  }
+}
+
+size_t SpokeToBlobs(SpokeBlob *blobs, const uint8_t *data, size_t len, const uint8_t colour_map[256]) {
+  size_t count = 0;
+  uint8_t previous_colour = 0;
+  int r_begin = 0;
+  int r_end = 0;
+
+  for (size_t radius = 0; radius < len; radius++) {
+    uint8_t actual_colour = colour_map[data[radius]];
+
+    if (actual_colour == previous_colour) {
+      // continue with same color, just register it
+      r_end++;
+    } else if (previous_colour == 0 && actual_colour != 0) {
+      // blob starts, no display, just register
+      r_begin = radius;
+      r_end = r_begin + 1;
+      previous_colour = actual_colour;  // new color
+    } else if (previous_colour != 0 && (previous_colour != actual_colour)) {
+      blobs[count].r_begin = r_begin;
+      blobs[count].r_end = r_end;
+      blobs[count].colour = previous_colour;
+      count++;
+      previous_colour = actual_colour;
+      if (actual_colour != 0) {  // change of color, start new blob
+        r_begin = radius;
+        r_end = r_begin + 1;
+      }
+    }
+  }
+  if (previous_colour != 0) {  // Final blob
+    blobs[count].r_begin = r_begin;
+    blobs[count].r_end = r_end;
+    blobs[count].colour = previous_colour;
+    count++;
+  }
+  return count;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,161 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _SPOKE_KERNELS_H_
+#define _SPOKE_KERNELS_H_
+
+#include "PolarLookup.h"
+#include "RadarCore.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// The per-sample loops that RadarInfo::ProcessRadarSpoke() runs for every spoke,
+// without the state they are embedded in. The plugin classes named in the
+// comments call these, and the benchmark (Spoke-bench.cpp) measures them.
+//
+// Colour maps contain a BlobColour per value, where 0 (BLOB_NONE) means nothing is drawn.
+//
+
+// Select the implementation of the vectorized kernels below. When 'level' is not supported
+// by this build or CPU the next lower level is used. Returns the level selected.
+// Called by SpokeDecodeSetSimdLevel(), which also covers these kernels.
+extern CoreSimdLevel SpokeKernelsSetSimdLevel(CoreSimdLevel level);
+
+// SpokeHistory::SetSpoke: one pass over the samples that sets bit r of 'strong' when
+// data[r] >= strong_threshold and bit r of 'weak' when data[r] >= weak_threshold, for r < len.
+// All other bits of the 'words' long rows are cleared. Vectorized.
+extern void SpokeThresholdBits(uint64_t *strong, uint64_t *weak, size_t words, const uint8_t *data, size_t len,
+                               uint8_t strong_threshold, uint8_t weak_threshold);
+
+// GuardZone::ProcessSpoke: count the bits set in bits[start..end], inclusive.
+extern size_t SpokeBitsCount(const uint64_t *bits, size_t start, size_t end);
+
+// The same for many ranges of one row: SpokeBitsPrefix() sets counts[w] to the number of bits
+// set in words [0..w> of 'bits', for w in [0..words], after which SpokeBitsCountPrefix() counts
+// any range in constant time.
+extern void SpokeBitsPrefix(uint32_t *counts, const uint64_t *bits, size_t words);
+extern size_t SpokeBitsCountPrefix(const uint32_t *counts, const uint64_t *bits, size_t start, size_t end);
+
+// Trails store the revolution in which a cell last had a strong echo, so that only
+// hits have to be written. The age, the number of revolutions since that hit plus one,
+// is computed when a cell is read. Stamp 0 means the cell never had a hit, so the
+// revolution counts from 1 to TRAIL_STAMPS and then starts at 1 again.
+typedef uint8_t TrailStamp;
+
+#define TRAIL_STAMPS (255)
+
+// What the trail updates need to know about the settings
+struct TrailUpdate {
+  uint8_t strong;         // Samples at or above this start a new trail (threshold_red)
+  uint8_t weak;           // Samples below this are replaced by the trail colour (threshold_blue)
+  uint8_t max_age;        // Trails stop ageing at this number of revolutions
+  const uint8_t *colour;  // BlobColour for each trail age, or 0 when the trails are not shown
+  TrailStamp revolution;  // The current revolution, [1..TRAIL_STAMPS]
+};
+
+// The age of a trail cell, in [0..max_age]
+static inline uint8_t TrailAge(TrailStamp stamp, const TrailUpdate &update) {
+  if (!stamp) {
+    return 0;
+  }
+  int age = (int)update.revolution - (int)stamp;
+  if (age < 0) {
+    age += TRAIL_STAMPS;
+  }
+  age++;
+  return age < update.max_age ? (uint8_t)age : update.max_age;
+}
+
+// TrailBuffer::UpdateRelativeTrails: stamp the hits on trail line 'trail' of 'spoke_len_max' cells,
+// colour the weak samples when the trails are shown.
+extern void TrailsUpdateRelative(TrailStamp *trail, size_t spoke_len_max, uint8_t *data, size_t len, const TrailUpdate &update);
+
+// TrailBuffer::UpdateTrueTrails: the same for the true trails image (trail_size * trail_size) along
+// one spoke, where 'points' is the polar lookup for the spoke's bearing and 'offset_x', 'offset_y'
+// in [0..trail_size> is the position of the radar in the image. The image wraps around at its
+// edges, so it must be more than twice as large as the spoke is long.
+extern void TrailsUpdateTrue(TrailStamp *trails, int trail_size, int offset_x, int offset_y, const PointIntRow &points,
+                             uint8_t *data, size_t len, const TrailUpdate &update);
+
+// TrailBuffer: stamps wrap after TRAIL_STAMPS revolutions. Every few revolutions move the stamps of
+// all cells that have reached max_age forward, so that they stay at max_age instead of becoming
+// young again. This is a sequential pass, instead of ageing every cell on every spoke.
+extern void TrailsRenormalize(TrailStamp *trails, size_t count, const TrailUpdate &update);
+
+// TrailBuffer::ZoomTrails: when the range changes every trail cell moves to where it is at the new
+// scale. That only depends on its row for the row and on its column for the column, so the moves
+// are computed once per row and once per column, and the zoom itself only copies cells.
+struct TrailZoomMap {
+  int count;     // Number of rows or columns that stay in the image
+  int *source;   // [count] row or column in the current image
+  int *target;   // [count] row or column in the zoomed image, without wrapping; ascending
+  int *wrapped;  // [count] the same in the wrapped image
+};
+
+// Fill 'map', which has room for 'trail_size' entries, for the rows (offset = radar row) or columns
+// (offset = radar column) of the true trails image. Cells within 'margin' of the edge of the
+// centered image are not moved.
+extern void TrailsZoomIndex(TrailZoomMap &map, int trail_size, int margin, int offset, float zoom_factor);
+
+// Zoom the true trails of 'src' into 'dst', for the targets [first..end> of 'rows' only, so that
+// disjoint ranges can be zoomed in parallel. Clears the rows it owns in 'dst' first.
+extern void TrailsZoomTrue(TrailStamp *dst, const TrailStamp *src, int trail_size, int offset, const TrailZoomMap &rows,
+                           const TrailZoomMap &columns, float zoom_factor, int first, int end);
+
+// Fill 'target', which has room for 'spoke_len_max' entries, with the new radius for each radius of
+// the relative trails. Returns the number of radii that stay on the spoke.
+extern size_t TrailsZoomRelativeIndex(int *target, size_t spoke_len_max, float zoom_factor);
+
+// Zoom the relative trails of spokes [first..end> of 'src' into 'dst'.
+extern void TrailsZoomRelative(TrailStamp *dst, const TrailStamp *src, size_t spoke_len_max, size_t first, size_t end,
+                               const int *target, size_t count);
+
+// RadarDrawShader::ProcessRadarSpoke: fill one texture line with the RGBA value for each sample.
+extern void SpokeToRGBA(uint8_t *texture, size_t spoke_len_max, const uint8_t *data, size_t len, const uint8_t rgba[256][4]);
+
+// RadarDrawShader::ProcessRadarSpoke: fill one texture line with the luminance value for each sample.
+extern void SpokeToLuminance(uint8_t *texture, size_t spoke_len_max, const uint8_t *data, size_t len, const uint8_t luminance[256]);
+
+// RadarDrawVertex::ProcessRadarSpoke: split a spoke in runs of the same colour.
+struct SpokeBlob {
+  int r_begin;     // First sample
+  int r_end;       // One past the last sample
+  uint8_t colour;  // BlobColour
+};
+
+// Returns the number of blobs stored in 'blobs', which must have room for 'len' entries.
+extern size_t SpokeToBlobs(SpokeBlob *blobs, const uint8_t *data, size_t len, const uint8_t colour_map[256]);
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _SPOKE_KERNELS_H_ */
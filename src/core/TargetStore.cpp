@@ -0,0 +1,201 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+
+#include "TargetStore.h"
+
+#include <math.h>
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define CONTOUR_ARENA_MIN_GARBAGE (4096)  // Don't compact small arrays, moving them is not worth it
+#define TARGET_GRID_POINTS_PER_CELL (2)
+
+ContourArena::ContourArena() { m_garbage = 0; }
+
+void ContourArena::Store(size_t slot, const Polar *contour, int length) {
+  if (slot >= m_entries.size()) {
+    Entry empty = {0, 0};
+    m_entries.resize(slot + 1, empty);
+  }
+  m_garbage += m_entries[slot].length;
+  if (m_garbage > CONTOUR_ARENA_MIN_GARBAGE && m_garbage > m_points.size() / 2) {
+    m_entries[slot].length = 0;
+    Compact();
+  }
+  m_entries[slot].first = m_points.size();
+  m_entries[slot].length = length;
+  m_points.insert(m_points.end(), contour, contour + length);
+}
+
+void ContourArena::Release(size_t slot) {
+  if (slot < m_entries.size()) {
+    m_garbage += m_entries[slot].length;
+    m_entries[slot].length = 0;
+  }
+}
+
+const Polar *ContourArena::Get(size_t slot, int *length) const {
+  if (slot >= m_entries.size() || m_entries[slot].length == 0) {
+    *length = 0;
+    return 0;
+  }
+  *length = m_entries[slot].length;
+  return &m_points[m_entries[slot].first];
+}
+
+void ContourArena::Compact() {
+  m_spare.clear();
+  for (size_t i = 0; i < m_entries.size(); i++) {
+    Entry &entry = m_entries[i];
+    if (entry.length > 0) {
+      size_t first = m_spare.size();
+      m_spare.insert(m_spare.end(), m_points.begin() + entry.first, m_points.begin() + entry.first + entry.length);
+      entry.first = first;
+    }
+  }
+  m_points.swap(m_spare);
+  m_garbage = 0;
+}
+
+TargetGrid::TargetGrid() {
+  m_columns = 0;
+  m_rows = 0;
+  m_x0 = 0.;
+  m_y0 = 0.;
+  m_cell = 1.;
+}
+
+int TargetGrid::CellX(double x) const {
+  int c = (int)floor((x - m_x0) / m_cell);
+  return c < 0 ? 0 : c >= m_columns ? m_columns - 1 : c;
+}
+
+int TargetGrid::CellY(double y) const {
+  int c = (int)floor((y - m_y0) / m_cell);
+  return c < 0 ? 0 : c >= m_rows ? m_rows - 1 : c;
+}
+
+void TargetGrid::Build(const std::vector<TargetGridPoint> &points) {
+  m_points.resize(points.size());
+  if (points.empty()) {
+    m_columns = 0;
+    m_rows = 0;
+    m_start.assign(1, 0);
+    return;
+  }
+
+  double x_min = points[0].x, x_max = points[0].x;
+  double y_min = points[0].y, y_max = points[0].y;
+  for (size_t i = 1; i < points.size(); i++) {
+    x_min = fmin(x_min, points[i].x);
+    x_max = fmax(x_max, points[i].x);
+    y_min = fmin(y_min, points[i].y);
+    y_max = fmax(y_max, points[i].y);
+  }
+  double width = x_max - x_min;
+  double height = y_max - y_min;
+  double cells = (double)points.size() / TARGET_GRID_POINTS_PER_CELL;
+
+  m_x0 = x_min;
+  m_y0 = y_min;
+  m_cell = sqrt(fmax(width * height, 1.) / fmax(cells, 1.));
+  m_cell = fmax(m_cell, fmax(width, height) / fmax(cells, 1.));  // Points on a line: cells * cells would be too many
+  m_cell = fmax(m_cell, 1.);
+  m_columns = (int)(width / m_cell) + 1;
+  m_rows = (int)(height / m_cell) + 1;
+
+  // Counting sort of the points by cell
+  m_start.assign((size_t)m_columns * m_rows + 1, 0);
+  for (size_t i = 0; i < points.size(); i++) {
+    m_start[CellY(points[i].y) * m_columns + CellX(points[i].x) + 1]++;
+  }
+  for (size_t c = 1; c < m_start.size(); c++) {
+    m_start[c] += m_start[c - 1];
+  }
+  for (size_t i = 0; i < points.size(); i++) {
+    int c = CellY(points[i].y) * m_columns + CellX(points[i].x);
+    m_points[m_start[c]++] = points[i];
+  }
+  for (size_t c = m_start.size() - 1; c > 0; c--) {
+    m_start[c] = m_start[c - 1];
+  }
+  m_start[0] = 0;
+}
+
+int TargetGrid::Nearest(double x, double y, double max_dist, int exclude) const {
+  if (m_points.empty()) {
+    return -1;
+  }
+  int cx = CellX(x);
+  int cy = CellY(y);
+  int rings = m_columns > m_rows ? m_columns : m_rows;
+  double best = max_dist * max_dist;
+  int id = -1;
+
+  // Look at the rings of cells around (x, y) until the next ring can't have anything nearer
+  for (int ring = 0; ring < rings; ring++) {
+    if (ring > 0) {
+      // The distance from (x, y) to the nearest point outside the previous rings. When (x, y)
+      // is outside the grid it is at least as far from every cell as its clamped cell.
+      double inside = fmin(fmin(x - (m_x0 + (cx - ring + 1) * m_cell), m_x0 + (cx + ring) * m_cell - x),
+                           fmin(y - (m_y0 + (cy - ring + 1) * m_cell), m_y0 + (cy + ring) * m_cell - y));
+      if (inside > 0. && inside * inside > best) {
+        break;
+      }
+    }
+    for (int row = cy - ring; row <= cy + ring; row++) {
+      if (row < 0 || row >= m_rows) {
+        continue;
+      }
+      bool edge = row == cy - ring || row == cy + ring;
+      for (int column = cx - ring; column <= cx + ring; column += edge ? 1 : 2 * ring) {
+        if (column < 0 || column >= m_columns) {
+          continue;
+        }
+        int c = row * m_columns + column;
+        for (int i = m_start[c]; i < m_start[c + 1]; i++) {
+          double dx = m_points[i].x - x;
+          double dy = m_points[i].y - y;
+          double d = dx * dx + dy * dy;
+          if (m_points[i].id != exclude && d <= best) {
+            best = d;
+            id = m_points[i].id;
+          }
+        }
+      }
+    }
+  }
+  return id;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,112 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _TARGET_STORE_H_
+#define _TARGET_STORE_H_
+
+#include <vector>
+
+#include "RadarCore.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Storage for the contours of ARPA targets, indexed by the slot of the target.
+//
+// All contours are kept in one array. Storing a contour appends it and leaves the
+// previous one as garbage; once more than half of the array is garbage the live
+// contours are moved together. Pointers returned by Get() are valid until the next
+// Store().
+//
+class ContourArena {
+ public:
+  ContourArena();
+
+  void Store(size_t slot, const Polar *contour, int length);
+  void Release(size_t slot);
+  const Polar *Get(size_t slot, int *length) const;
+
+  size_t GetSize() const { return m_points.size(); }  // Points in use, including garbage
+
+ private:
+  struct Entry {
+    size_t first;
+    int length;
+  };
+
+  void Compact();
+
+  std::vector<Polar> m_points;
+  std::vector<Polar> m_spare;  // Compact() moves the live contours here, then swaps
+  std::vector<Entry> m_entries;
+  size_t m_garbage;
+};
+
+//
+// A uniform grid over the positions of the targets, for nearest neighbour queries.
+//
+// Positions are in meters in any flat frame. Build() chooses the cell size so that
+// there are about two points per cell, which makes a query look at a few cells
+// instead of at every target.
+//
+struct TargetGridPoint {
+  double x;
+  double y;
+  int id;
+};
+
+class TargetGrid {
+ public:
+  TargetGrid();
+
+  void Build(const std::vector<TargetGridPoint> &points);
+
+  // The id of the point nearest to (x, y) other than 'exclude', or -1 when there is none
+  // within 'max_dist' meters
+  int Nearest(double x, double y, double max_dist, int exclude) const;
+
+ private:
+  int CellX(double x) const;
+  int CellY(double y) const;
+
+  std::vector<TargetGridPoint> m_points;  // Sorted by cell
+  std::vector<int> m_start;               // First point of each cell, m_columns * m_rows + 1
+  int m_columns;
+  int m_rows;
+  double m_x0;
+  double m_y0;
+  double m_cell;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _TARGET_STORE_H_ */
@@ -32,6 +32,7 @@
 
 #include "EmulatorReceive.h"
 #include "RadarFactory.h"
+#include "SpokeQueue.h"
 
 #define SCALE_RAW_TO_DEGREES(raw) ((raw) * (double)DEGREES_PER_ROTATION / EMULATOR_SPOKES)
 #define SCALE_DEGREES_TO_RAW(angle) ((int)((angle) * (double)EMULATOR_SPOKES / DEGREES_PER_ROTATION))
@@ -56,9 +57,6 @@ PLUGIN_BEGIN_NAMESPACE
 
 void EmulatorReceive::EmulateFakeBuffer(void) {
   time_t now = time(0);
-  uint8_t data[EMULATOR_MAX_SPOKE_LEN];
-
-  wxCriticalSectionLocker lock(m_ri->m_exclusive);
 
   m_ri->m_radar_timeout = now + WATCHDOG_TIMEOUT;
 
@@ -98,9 +96,16 @@ void EmulatorReceive::EmulateFakeBuffer(void) {
     m_next_spoke = MOD_SPOKES(m_next_spoke + 1);
     m_ri->m_statistics.spokes++;
 
+    SpokeQueueItem *slot = m_ri->m_spoke_queue->Reserve();
+    if (!slot) {
+      m_ri->m_statistics.overflow_spokes++;
+      continue;
+    }
+    uint8_t *data = slot->data;
+
     if (range_meters == ranges[count - 1]) {
       // New pattern suited for arpa / guard zone detection
-      CLEAR_STRUCT(data);
+      memset(data, 0, EMULATOR_MAX_SPOKE_LEN);
       if (scanline < 8) {
         for (size_t range = 384; range < 410; range++) {
           data[range] = 255;
@@ -110,11 +115,11 @@ void EmulatorReceive::EmulateFakeBuffer(void) {
     } else {
       // The blotchy pattern
       // Invent a pattern. Outermost ring, then a square pattern
-      for (size_t range = 0; range < sizeof(data); range++) {
+      for (size_t range = 0; range < EMULATOR_MAX_SPOKE_LEN; range++) {
         size_t bit = range >> 7;
         // use bit 'bit' of angle_raw
         uint8_t colour = (((angle + m_next_rotation) >> 5) & (2 << bit)) > 0 ? (range / 2) : 0;
-        if (range > sizeof(data) - 10) {
+        if (range > EMULATOR_MAX_SPOKE_LEN - 10) {
           colour = ((angle + m_next_rotation) % EMULATOR_SPOKES) <= 8 ? 255 : 0;
         }
         data[range] = colour;
@@ -127,9 +132,14 @@ void EmulatorReceive::EmulateFakeBuffer(void) {
     int hdt = SCALE_DEGREES_TO_SPOKES(m_pi->GetHeadingTrue());
     int bearing = MOD_SPOKES(angle + hdt);
 
-    wxLongLong time_rec = wxGetUTCTimeMillis();
-    m_ri->ProcessRadarSpoke(angle, bearing, data, sizeof(data), range_meters, time_rec);
+    slot->angle = angle;
+    slot->bearing = bearing;
+    slot->len = EMULATOR_MAX_SPOKE_LEN;
+    slot->range_meters = range_meters;
+    slot->time_rec = wxGetUTCTimeMillis();
+    m_ri->m_spoke_queue->Commit();
   }
+  m_ri->m_spoke_queue->Signal();
 
   LOG_VERBOSE(wxT("radar_pi: emulating %d spokes at range %d with %d spots"), scanlines_in_packet, range_meters, spots);
 }
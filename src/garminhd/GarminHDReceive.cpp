@@ -31,6 +31,7 @@
  */
 
 #include "GarminHDReceive.h"
+#include "SpokeQueue.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -84,9 +85,7 @@ void GarminHDReceive::ProcessFrame(radar_line *packet) {
   // log_line.time_rec = wxGetUTCTimeMillis();
   wxLongLong time_rec = wxGetUTCTimeMillis();
   time_t now = (time_t)(time_rec.GetValue() / MILLISECONDS_PER_SECOND);
-  uint8_t line[GARMIN_HD_MAX_SPOKE_LEN];
-  int i;
-  uint8_t *p, *s;
+  uint8_t *s;
 
   if (packet->scan_length * 2 > GARMIN_HD_MAX_SPOKE_LEN) {
     LOG_INFO(wxT("radar_pi: %s truncating data, %d longer than expected max length %d"), packet->scan_length * 8,
@@ -123,20 +122,19 @@ void GarminHDReceive::ProcessFrame(radar_line *packet) {
     wxLongLong startup_elapsed = wxGetUTCTimeMillis() - m_pi->GetBootMillis();
     LOG_INFO(wxT("radar_pi: %s first radar spoke received after %llu ms\n"), m_ri->m_name.c_str(), startup_elapsed);
   }
-  wxCriticalSectionLocker lock(m_ri->m_exclusive);
-
   for (int j = 0; j < 4; j++) {
-    s = &packet->line_data[packet->scan_length / 4 * j];
-    for (p = line, i = 0; i < packet->scan_length / 4; i++, s++) {
-      *p++ = (*s & 0x01) > 0 ? 255 : 0;
-      *p++ = (*s & 0x02) > 0 ? 255 : 0;
-      *p++ = (*s & 0x04) > 0 ? 255 : 0;
-      *p++ = (*s & 0x08) > 0 ? 255 : 0;
-      *p++ = (*s & 0x10) > 0 ? 255 : 0;
-      *p++ = (*s & 0x20) > 0 ? 255 : 0;
-      *p++ = (*s & 0x40) > 0 ? 255 : 0;
-      *p++ = (*s & 0x80) > 0 ? 255 : 0;
+    SpokeQueueItem *slot = m_ri->m_spoke_queue->Reserve();
+    if (!slot) {
+      m_ri->m_statistics.overflow_spokes++;
+      m_next_spoke = (spoke + 1) % GARMIN_HD_SPOKES;
+      angle_raw++;
+      spoke++;
+      continue;
     }
+    uint8_t *line = slot->data;
+
+    s = &packet->line_data[packet->scan_length / 4 * j];
+    GarminHDExpandSpoke(line, s, packet->scan_length / 4);
 
     m_next_spoke = (spoke + 1) % GARMIN_HD_SPOKES;
 
@@ -149,11 +147,17 @@ void GarminHDReceive::ProcessFrame(radar_line *packet) {
     SpokeBearing a = MOD_SPOKES(angle_raw);
     SpokeBearing b = MOD_SPOKES(bearing_raw);
 
-    m_ri->ProcessRadarSpoke(a, b, line, p - line, packet->display_meters, time_rec);
+    slot->angle = a;
+    slot->bearing = b;
+    slot->len = packet->scan_length / 4 * 8;
+    slot->range_meters = packet->display_meters;
+    slot->time_rec = time_rec;
+    m_ri->m_spoke_queue->Commit();
 
     angle_raw++;
     spoke++;
   }
+  m_ri->m_spoke_queue->Signal();
 }
 
 // Check that this interface is valid for
@@ -321,6 +325,7 @@ void *GarminHDReceive::Entry(void) {
         rx_len = sizeof(rx_addr);
         r = recvfrom(reportSocket, (char *)data, sizeof(data), 0, (struct sockaddr *)&rx_addr, &rx_len);
         if (r > 0) {
+          RecordPacket(RECORD_REPORT, data, (size_t)r);
           NetworkAddress radar_address;
           radar_address.addr = rx_addr.ipv4.sin_addr;
           radar_address.port = rx_addr.ipv4.sin_port;
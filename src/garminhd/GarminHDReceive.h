@@ -33,6 +33,7 @@
 #define _GARMIN_HD_RECEIVE_H_
 
 #include "RadarReceive.h"
+#include "core/SpokeDecode.h"
 #include "socketutil.h"
 
 PLUGIN_BEGIN_NAMESPACE
@@ -57,6 +58,7 @@ class GarminHDReceive : public RadarReceive {
     m_send_socket = GetLocalhostSendTCPSocket(m_receive_socket);
     SetInfoStatus(wxString::Format(wxT("%s: %s"), m_ri->m_name.c_str(), _("Initializing")));
     m_ri->m_showManualValueInAuto = true;
+    SpokeDecodeInit();
 
     LOG_RECEIVE(wxT("radar_pi: %s receive thread created"), m_ri->m_name.c_str());
   };
@@ -66,6 +68,11 @@ class GarminHDReceive : public RadarReceive {
   void *Entry(void);
   void Shutdown(void);
   wxString GetInfoStatus();
+  void ProcessPacket(RecordSocketRole role, const uint8_t *data, size_t len) {
+    if (role == RECORD_REPORT) {  // Spokes arrive on the report socket as well
+      ProcessReport(data, len);
+    }
+  }
 
   NetworkAddress m_interface_addr;
   NetworkAddress m_report_addr;
@@ -31,6 +31,7 @@
  */
 
 #include "GarminxHDReceive.h"
+#include "SpokeQueue.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -74,14 +75,15 @@ struct radar_line {
 // Process one radar line, which contains exactly one line or spoke of data extending outwards
 // from the radar up to the range indicated in the packet.
 //
-void GarminxHDReceive::ProcessFrame(const uint8_t *data, size_t len) {
-  // log_line.time_rec = wxGetUTCTimeMillis();
-  wxLongLong time_rec = wxGetUTCTimeMillis();
+void GarminxHDReceive::ProcessFrame(const uint8_t *data, size_t len, wxLongLong time_rec) {
+  if (time_rec == 0) {  // No kernel receive time, see ReceiveBatch::GetTime()
+    time_rec = wxGetUTCTimeMillis();
+  }
   time_t now = (time_t)(time_rec.GetValue() / MILLISECONDS_PER_SECOND);
 
   radar_line *packet = (radar_line *)data;
 
-  wxCriticalSectionLocker lock(m_ri->m_exclusive);
+  // No lock on m_ri->m_exclusive here: the spoke is handed over via m_ri->m_spoke_queue
 
   m_ri->m_radar_timeout = now + WATCHDOG_TIMEOUT;
   m_ri->m_data_timeout = now + DATA_TIMEOUT;
@@ -125,7 +127,23 @@ void GarminxHDReceive::ProcessFrame(const uint8_t *data, size_t len) {
   SpokeBearing b = MOD_SPOKES(bearing_raw);
 
   m_ri->m_range.Update(packet->range_meters);
-  m_ri->ProcessRadarSpoke(a, b, packet->line_data, len, packet->display_meters, time_rec);
+
+  SpokeQueueItem *slot = m_ri->m_spoke_queue->Reserve();
+  if (!slot) {
+    m_ri->m_statistics.overflow_spokes++;
+    return;
+  }
+  if (len > m_ri->m_spoke_queue->GetSpokeLenMax()) {
+    len = m_ri->m_spoke_queue->GetSpokeLenMax();
+  }
+  memcpy(slot->data, packet->line_data, len);
+  slot->angle = a;
+  slot->bearing = b;
+  slot->len = len;
+  slot->range_meters = packet->display_meters;
+  slot->time_rec = time_rec;
+  m_ri->m_spoke_queue->Commit();
+  m_ri->m_spoke_queue->Signal();
 }
 
 // Check that this interface is valid for
@@ -261,6 +279,7 @@ void *GarminxHDReceive::Entry(void) {
   socklen_t rx_len;
 
   uint8_t data[sizeof(radar_line)];
+  ReceiveBatch batch(sizeof(radar_line));  // Reused for every burst of frames on the data socket
   m_interface_array = 0;
   m_interface = 0;
   struct sockaddr_in radarFoundAddr;
@@ -331,12 +350,18 @@ void *GarminxHDReceive::Entry(void) {
       }
 
       if (dataSocket != INVALID_SOCKET && FD_ISSET(dataSocket, &fdin)) {
-        rx_len = sizeof(rx_addr);
-        r = recvfrom(dataSocket, (char *)data, sizeof(data), 0, (struct sockaddr *)&rx_addr, &rx_len);
-        if (r > 0) {
-          ProcessFrame(data, (size_t)r);
-          no_data_timeout = -15;
-          no_spoke_timeout = -5;
+        r = batch.Receive(dataSocket);
+        if (r >= 0) {
+          m_ri->m_statistics.receive_calls++;
+          m_ri->m_statistics.kernel_drops += batch.GetDropped();
+          for (int i = 0; i < r; i++) {
+            RecordPacket(RECORD_DATA, batch.GetData(i), batch.GetLength(i));
+            ProcessFrame(batch.GetData(i), batch.GetLength(i), batch.GetTime(i));
+          }
+          if (r > 0) {
+            no_data_timeout = -15;
+            no_spoke_timeout = -5;
+          }
         } else {
           closesocket(dataSocket);
           dataSocket = INVALID_SOCKET;
@@ -348,6 +373,7 @@ void *GarminxHDReceive::Entry(void) {
         rx_len = sizeof(rx_addr);
         r = recvfrom(reportSocket, (char *)data, sizeof(data), 0, (struct sockaddr *)&rx_addr, &rx_len);
         if (r > 0) {
+          RecordPacket(RECORD_REPORT, data, (size_t)r);
           NetworkAddress radar_address;
           radar_address.addr = rx_addr.ipv4.sin_addr;
           radar_address.port = rx_addr.ipv4.sin_port;
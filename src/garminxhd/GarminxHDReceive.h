@@ -66,6 +66,13 @@ class GarminxHDReceive : public RadarReceive {
   void *Entry(void);
   void Shutdown(void);
   wxString GetInfoStatus();
+  void ProcessPacket(RecordSocketRole role, const uint8_t *data, size_t len) {
+    if (role == RECORD_DATA) {
+      ProcessFrame(data, len);
+    } else {
+      ProcessReport(data, len);
+    }
+  }
 
   NetworkAddress m_interface_addr;
   NetworkAddress m_data_addr;
@@ -75,7 +82,7 @@ class GarminxHDReceive : public RadarReceive {
   volatile bool m_is_shutdown;
 
  private:
-  void ProcessFrame(const uint8_t *data, size_t len);
+  void ProcessFrame(const uint8_t *data, size_t len, wxLongLong time_rec = 0);
   bool ProcessReport(const uint8_t *data, size_t len);
 
   bool IsValidGarminAddress(struct ifaddrs * nif);
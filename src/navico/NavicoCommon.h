@@ -3,6 +3,22 @@
 #define NAVICO_SPOKES 2048
 #endif
 
+// Navico radars number their spokes [0..4096>. By default two of those are mapped
+// onto one spoke, which is enough for the radars that only send half of them.
+// With RadarInfo::m_full_resolution every spoke ID gets its own spoke.
+// That doubles the memory that scales with the number of spokes, which for
+// NAVICO_SPOKE_LEN samples per spoke is:
+//   history (m_history)               0.5 MB ->  1 MB
+//   PolarToCartesianLookup              2 MB ->  4 MB (shared by radars of the same size)
+//   relative trails (and their copy)    4 MB ->  8 MB
+//   shader texture (RGBA)               8 MB -> 16 MB
+//   spoke queue                         2 MB ->  4 MB
+// The process thread and ARPA handle twice as many spokes per rotation when
+// the radar actually sends all of them.
+#ifndef NAVICO_SPOKES_FULL
+#define NAVICO_SPOKES_FULL 4096
+#endif
+
 #ifndef NAVICO_SPOKE_LEN
 #define NAVICO_SPOKE_LEN 1024
 #endif
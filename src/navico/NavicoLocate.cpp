@@ -51,6 +51,9 @@ void NavicoLocate::CleanupCards() {
   if (m_socket) {
     for (size_t i = 0; i < m_interface_count; i++) {
       if (m_socket[i] != INVALID_SOCKET) {
+        if (m_reactor) {
+          m_reactor->RemoveSocket(m_socket[i]);
+        }
         closesocket(m_socket[i]);
       }
     }
@@ -87,6 +90,9 @@ void NavicoLocate::UpdateEthernetCards() {
           m_interface_addr[i].addr = sa->sin_addr;
           m_interface_addr[i].port = 0;
           m_socket[i] = startUDPMulticastReceiveSocket(m_interface_addr[i], reportNavicoCommon, error);
+          if (m_reactor) {
+            m_reactor->AddSocket(this, m_socket[i]);
+          }
           LOG_VERBOSE(wxT("radar_pi: NavicoLocate scanning interface %s for radars"), m_interface_addr[i].FormatNetworkAddress());
           i++;
         }
@@ -99,6 +105,42 @@ void NavicoLocate::UpdateEthernetCards() {
   WakeRadar();
 }
 
+bool NavicoLocate::ReceiveReport(size_t i) {
+  union {
+    sockaddr_storage addr;
+    sockaddr_in ipv4;
+  } rx_addr;
+  socklen_t rx_len = sizeof(rx_addr);
+  uint8_t data[1500];
+
+  int r = recvfrom(m_socket[i], (char *)data, sizeof(data), 0, (struct sockaddr *)&rx_addr, &rx_len);
+  if (r > 2) {  // we are not interested in 2 byte messages
+    NetworkAddress radar_address;
+    radar_address.addr = rx_addr.ipv4.sin_addr;
+    radar_address.port = rx_addr.ipv4.sin_port;
+
+    if (ProcessReport(radar_address, m_interface_addr[i], data, (size_t)r)) {
+      m_rescan_network_cards = -PERIOD_UNTIL_CARD_REFRESH;  // Give double time until we rescan
+      m_wake_timeout = -PERIOD_UNTIL_WAKE_RADAR;
+      return true;
+    }
+  }
+  return false;
+}
+
+void NavicoLocate::NoDataTimeout() {
+  if (++m_rescan_network_cards >= PERIOD_UNTIL_CARD_REFRESH) {
+    UpdateEthernetCards();
+    m_rescan_network_cards = 0;
+    m_wake_timeout = PERIOD_UNTIL_WAKE_RADAR - 2;  // Wake radar soon, but not immediately
+  }
+
+  if (++m_wake_timeout >= PERIOD_UNTIL_WAKE_RADAR) {
+    WakeRadar();
+    m_wake_timeout = 0;
+  }
+}
+
 /*
  * Entry
  *
@@ -107,15 +149,6 @@ void NavicoLocate::UpdateEthernetCards() {
  */
 void *NavicoLocate::Entry(void) {
   int r = 0;
-  int rescan_network_cards = 0;
-  int wake_timeout = 0;
-  union {
-    sockaddr_storage addr;
-    sockaddr_in ipv4;
-  } rx_addr;
-  socklen_t rx_len;
-
-  uint8_t data[1500];
 
   LOG_VERBOSE(wxT("radar_pi: NavicoLocate thread starting"));
 
@@ -124,7 +157,7 @@ void *NavicoLocate::Entry(void) {
   UpdateEthernetCards();
 
   while (!m_shutdown) {
-    struct timeval tv = { (long)1, (long)(0) };
+    struct timeval tv = { (long)SECONDS_PER_SELECT, (long)(0) };
     fd_set fdin;
     FD_ZERO(&fdin);
 
@@ -138,39 +171,18 @@ void *NavicoLocate::Entry(void) {
 
     r = select(maxFd + 1, &fdin, 0, 0, &tv);
     if (r == -1 && errno != 0) {
-      int err = errno;
       UpdateEthernetCards();
-      rescan_network_cards = 0;
+      m_rescan_network_cards = 0;
     }
     if (r > 0) {
       for (size_t i = 0; i < m_interface_count; i++) {
         if (m_socket[i] != INVALID_SOCKET && FD_ISSET(m_socket[i], &fdin)) {
-          rx_len = sizeof(rx_addr);
-          r = recvfrom(m_socket[i], (char *)data, sizeof(data), 0, (struct sockaddr *)&rx_addr, &rx_len);
-          if (r > 2) {   // we are not interested in 2 byte messages
-            NetworkAddress radar_address;
-            radar_address.addr = rx_addr.ipv4.sin_addr;
-            radar_address.port = rx_addr.ipv4.sin_port;
-
-            if (ProcessReport(radar_address, m_interface_addr[i], data, (size_t)r)) {
-              rescan_network_cards = -PERIOD_UNTIL_CARD_REFRESH;  // Give double time until we rescan
-              wake_timeout = -PERIOD_UNTIL_WAKE_RADAR;
-            }
-          }
+          ReceiveReport(i);
         }
       }
     }
     else {  // no data received -> select timeout
-      if (++rescan_network_cards >= PERIOD_UNTIL_CARD_REFRESH) {
-        UpdateEthernetCards();
-        rescan_network_cards = 0;
-        wake_timeout = PERIOD_UNTIL_WAKE_RADAR - 2;  // Wake radar soon, but not immediately
-      }
-
-      if (++wake_timeout >= PERIOD_UNTIL_WAKE_RADAR) {
-        WakeRadar();
-        wake_timeout = 0;
-      }
+      NoDataTimeout();
     }
 
   }  // endless loop until thread destroy
@@ -182,6 +194,43 @@ void *NavicoLocate::Entry(void) {
   return 0;
 }
 
+bool NavicoLocate::Attach(RadarReactor *reactor) {
+  m_reactor = reactor;
+  m_rescan_network_cards = PERIOD_UNTIL_CARD_REFRESH;  // Open the sockets on the first tick, on the reactor thread
+  if (!m_reactor->AddTimer(this, 0, SECONDS_PER_SELECT * MILLISECONDS_PER_SECOND)) {
+    m_reactor = 0;
+    return false;
+  }
+  LOG_VERBOSE(wxT("radar_pi: NavicoLocate running on reactor thread"));
+  return true;
+}
+
+void NavicoLocate::Detach() {
+  if (m_reactor) {
+    m_reactor->RemoveHandler(this);
+    CleanupCards();
+    m_reactor = 0;
+    LOG_VERBOSE(wxT("radar_pi: NavicoLocate detached from reactor thread"));
+  }
+}
+
+void NavicoLocate::OnReadable(SOCKET socket) {
+  for (size_t i = 0; i < m_interface_count; i++) {
+    if (m_socket[i] == socket) {
+      ReceiveReport(i);
+      m_activity = true;
+      return;
+    }
+  }
+}
+
+void NavicoLocate::OnTimer(int timer) {
+  if (!m_activity) {
+    NoDataTimeout();
+  }
+  m_activity = false;
+}
+
 /*
  RADAR REPORTS
 
@@ -35,6 +35,7 @@
 #include <map>
 
 #include "NavicoCommon.h"
+#include "RadarReactor.h"
 #include "radar_pi.h"
 #include "socketutil.h"
 
@@ -48,8 +49,10 @@ PLUGIN_BEGIN_NAMESPACE
 // It will fill a map that given a radar IP address will give its listening ports.
 // The individual radars will then listen to multicast data on those ports.
 //
+// Instead of running its own thread it can also be attached to the RadarReactor.
+//
 
-class NavicoLocate : public wxThread {
+class NavicoLocate : public wxThread, public ReactorHandler {
 #define MAX_REPORT 10
  public:
   NavicoLocate(radar_pi *pi) : wxThread(wxTHREAD_JOINABLE) {
@@ -62,6 +65,10 @@ class NavicoLocate : public wxThread {
     m_socket = 0;
     m_interface_count = 0;
     m_report_count = 0;
+    m_rescan_network_cards = 0;
+    m_wake_timeout = 0;
+    m_reactor = 0;
+    m_activity = false;
 
     LOG_INFO(wxT("radar_pi: NavicoLocate thread created, prio= %i"), GetPriority());
   }
@@ -74,6 +81,13 @@ class NavicoLocate : public wxThread {
    */
   void Shutdown(void) { m_shutdown = true; }
 
+  // Run on the reactor thread instead; Detach() is the equivalent of Shutdown() + Wait()
+  bool Attach(RadarReactor *reactor);
+  void Detach(void);
+  bool IsAttached() { return m_reactor != 0; }
+  void OnReadable(SOCKET socket);
+  void OnTimer(int timer);
+
   ~NavicoLocate() {
     while (!m_is_shutdown) {
       wxMilliSleep(50);
@@ -89,6 +103,8 @@ class NavicoLocate : public wxThread {
   bool ProcessReport(const NetworkAddress &radar_address, const NetworkAddress &interface_address, const uint8_t *data, size_t len);
   bool DetectedRadar(const NetworkAddress &radar_address);
   void WakeRadar();
+  bool ReceiveReport(size_t i);
+  void NoDataTimeout();
 
   void UpdateEthernetCards();
   void CleanupCards();
@@ -103,6 +119,11 @@ class NavicoLocate : public wxThread {
   size_t m_interface_count;
   size_t m_report_count;
 
+  int m_rescan_network_cards;
+  int m_wake_timeout;
+  RadarReactor *m_reactor;  // Set when attached to the reactor instead of running Entry()
+  bool m_activity;          // A report was received since the previous reactor tick
+
   wxCriticalSection m_exclusive;
 };
 
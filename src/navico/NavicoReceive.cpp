@@ -33,6 +33,7 @@
 #include "NavicoReceive.h"
 #include "MessageBox.h"
 #include "NavicoControl.h"
+#include "SpokeQueue.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -49,7 +50,7 @@ PLUGIN_BEGIN_NAMESPACE
 // Navico radars use an internal spoke ID that has range [0..4096> but they
 // only send half of them
 //
-#define SPOKES (4096)
+#define SPOKES (NAVICO_SPOKES_FULL)
 #define SCALE_RAW_TO_DEGREES(raw) ((raw) * (double)DEGREES_PER_ROTATION / SPOKES)
 #define SCALE_DEGREES_TO_RAW(angle) ((int)((angle) * (double)SPOKES / DEGREES_PER_ROTATION))
 
@@ -127,75 +128,21 @@ struct radar_frame_pkt {
 };
 #pragma pack(pop)
 
-enum LookupSpokeEnum {
-  LOOKUP_SPOKE_LOW_NORMAL,
-  LOOKUP_SPOKE_LOW_BOTH,
-  LOOKUP_SPOKE_LOW_APPROACHING,
-  LOOKUP_SPOKE_HIGH_NORMAL,
-  LOOKUP_SPOKE_HIGH_BOTH,
-  LOOKUP_SPOKE_HIGH_APPROACHING
-};
-
-static uint8_t lookupData[6][256];
-
-void NavicoReceive::InitializeLookupData() {
-  if (lookupData[5][255] == 0) {
-    for (int j = 0; j <= UINT8_MAX; j++) {
-      uint8_t low = (j & 0x0f) << 4;
-      uint8_t high = (j & 0xf0);
-
-      lookupData[LOOKUP_SPOKE_LOW_NORMAL][j] = low;
-      lookupData[LOOKUP_SPOKE_HIGH_NORMAL][j] = high;
-
-      switch (low) {
-        case 0xf0:
-          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = 0xff;
-          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = 0xff;
-          break;
-
-        case 0xe0:
-          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = 0xfe;
-          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = low;
-          break;
-
-        default:
-          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = low;
-          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = low;
-      }
-
-      switch (high) {
-        case 0xf0:
-          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = 0xff;
-          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = 0xff;
-          break;
-
-        case 0xe0:
-          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = 0xfe;
-          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = high;
-          break;
-
-        default:
-          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = high;
-          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = high;
-      }
-    }
-  }
-}
-
 // ProcessFrame
 // ------------
 // Process one radar frame packet, which can contain up to 32 'spokes' or lines extending outwards
 // from the radar up to the range indicated in the packet.
 //
-void NavicoReceive::ProcessFrame(const uint8_t *data, size_t len) {
+void NavicoReceive::ProcessFrame(const uint8_t *data, size_t len, wxLongLong time_rec) {
   time_t now = time(0);
 
-  // log_line.time_rec = wxGetUTCTimeMillis();
-  wxLongLong time_rec = wxGetUTCTimeMillis();
+  if (time_rec == 0) {  // No kernel receive time, see ReceiveBatch::GetTime()
+    time_rec = wxGetUTCTimeMillis();
+  }
 
   radar_frame_pkt *packet = (radar_frame_pkt *)data;
 
-  wxCriticalSectionLocker lock(m_ri->m_exclusive);
+  // No lock on m_ri->m_exclusive here: spokes are handed over via m_ri->m_spoke_queue
 
   m_ri->m_radar_timeout = now + WATCHDOG_TIMEOUT;
   m_ri->m_data_timeout = now + DATA_TIMEOUT;
@@ -321,23 +268,41 @@ void NavicoReceive::ProcessFrame(const uint8_t *data, size_t len) {
     bearing_raw = angle_raw + heading_raw;
     // until here all is based on 4096 (SPOKES) scanlines
 
-    SpokeBearing a = MOD_SPOKES(angle_raw / 2);    // divide by 2 to map on 2048 scanlines
-    SpokeBearing b = MOD_SPOKES(bearing_raw / 2);  // divide by 2 to map on 2048 scanlines
-    size_t len = NAVICO_SPOKE_LEN;
-    uint8_t data_highres[NAVICO_SPOKE_LEN];
+    int scale = SPOKES / (int)m_ri->m_spokes;  // 2 to map on 2048 scanlines, 1 in full resolution mode
+    SpokeBearing a = MOD_SPOKES(angle_raw / scale);
+    SpokeBearing b = MOD_SPOKES(bearing_raw / scale);
 
-    int doppler = m_ri->m_doppler.GetValue();
-    if (doppler < 0 || doppler > 2) {
-      doppler = 0;
+    if (scale == 1) {
+      if (angle_raw & 1) {
+        m_odd_spokes++;
+      }
+      if (angle_raw < m_previous_angle_raw) {  // New rotation
+        if (m_odd_spokes == 0 && !m_full_resolution_warned) {
+          LOG_INFO(wxT("radar_pi: %s full resolution is on, but radar only sends %d spokes per rotation"), m_ri->m_name.c_str(),
+                   NAVICO_SPOKES);
+          m_full_resolution_warned = true;
+        }
+        m_odd_spokes = 0;
+      }
+      m_previous_angle_raw = angle_raw;
     }
-    uint8_t *lookup_low = lookupData[LOOKUP_SPOKE_LOW_NORMAL + doppler];
-    uint8_t *lookup_high = lookupData[LOOKUP_SPOKE_HIGH_NORMAL + doppler];
-    for (int i = 0; i < NAVICO_SPOKE_LEN / 2; i++) {
-      data_highres[2 * i] = lookup_low[line->data[i]];
-      data_highres[2 * i + 1] = lookup_high[line->data[i]];
+
+    SpokeQueueItem *slot = m_ri->m_spoke_queue->Reserve();
+    if (!slot) {
+      m_ri->m_statistics.overflow_spokes++;
+      continue;
     }
-    m_ri->ProcessRadarSpoke(a, b, data_highres, len, range_meters, time_rec);
+    uint8_t *data_highres = slot->data;
+
+    NavicoUnpackSpoke(data_highres, line->data, NAVICO_SPOKE_LEN / 2, m_ri->m_doppler.GetValue());
+    slot->angle = a;
+    slot->bearing = b;
+    slot->len = NAVICO_SPOKE_LEN;
+    slot->range_meters = range_meters;
+    slot->time_rec = time_rec;
+    m_ri->m_spoke_queue->Commit();
   }
+  m_ri->m_spoke_queue->Signal();
 }
 
 SOCKET NavicoReceive::PickNextEthernetCard() {
@@ -438,6 +403,164 @@ SOCKET NavicoReceive::GetNewDataSocket() {
   return socket;
 }
 
+void NavicoReceive::WatchSocket(SOCKET socket) {
+  if (m_reactor && socket != INVALID_SOCKET) {
+    m_reactor->AddSocket(this, socket);
+  }
+}
+
+void NavicoReceive::CloseSocket(SOCKET &socket) {
+  if (socket != INVALID_SOCKET) {
+    if (m_reactor) {
+      m_reactor->RemoveSocket(socket);
+    }
+    closesocket(socket);
+    socket = INVALID_SOCKET;
+  }
+}
+
+void NavicoReceive::OpenSockets() {
+  m_batch = new ReceiveBatch(sizeof(radar_frame_pkt));
+  m_report_socket = GetNewReportSocket();  // Start using the same interface_addr as previous time
+  WatchSocket(m_report_socket);
+}
+
+void NavicoReceive::CheckSockets() {
+  if (m_report_socket == INVALID_SOCKET) {
+    m_report_socket = PickNextEthernetCard();
+    if (m_report_socket != INVALID_SOCKET) {
+      WatchSocket(m_report_socket);
+      m_no_data_timeout = 0;
+      m_no_spoke_timeout = 0;
+    }
+  }
+  if (m_radar_detected) {
+    // If we have detected a radar antenna at this address, start opening more sockets.
+    // We do this later for 2 reasons:
+    // - Resource consumption
+    // - Timing. If we start processing radar data before the rest of the system
+    //           is initialized then we get ordering/race condition issues.
+    if (m_data_socket == INVALID_SOCKET) {
+      m_data_socket = GetNewDataSocket();
+      WatchSocket(m_data_socket);
+    }
+  } else {
+    CloseSocket(m_data_socket);
+  }
+}
+
+void NavicoReceive::ReceiveData() {
+  int r = m_batch->Receive(m_data_socket);
+
+  if (r >= 0) {
+    m_ri->m_statistics.receive_calls++;
+    m_ri->m_statistics.kernel_drops += m_batch->GetDropped();
+    for (int i = 0; i < r; i++) {
+      RecordPacket(RECORD_DATA, m_batch->GetData(i), m_batch->GetLength(i));
+      ProcessFrame(m_batch->GetData(i), m_batch->GetLength(i), m_batch->GetTime(i));
+    }
+    if (r > 0) {
+      m_no_data_timeout = -15;
+      m_no_spoke_timeout = -5;
+    }
+  } else {
+    CloseSocket(m_data_socket);
+    wxLogError(wxT("radar_pi: %s illegal frame"), m_ri->m_name.c_str());
+  }
+}
+
+void NavicoReceive::ReceiveReport() {
+  union {
+    sockaddr_storage addr;
+    sockaddr_in ipv4;
+  } rx_addr;
+  socklen_t rx_len = sizeof(rx_addr);
+  uint8_t data[sizeof(radar_frame_pkt)];
+
+  int r = recvfrom(m_report_socket, (char *)data, sizeof(data), 0, (struct sockaddr *)&rx_addr, &rx_len);
+  if (r > 0) {
+    RecordPacket(RECORD_REPORT, data, (size_t)r);
+    NetworkAddress radar_address;
+    radar_address.addr = rx_addr.ipv4.sin_addr;
+    radar_address.port = rx_addr.ipv4.sin_port;
+
+    if (ProcessReport(data, (size_t)r)) {
+      if (!m_radar_detected) {
+        wxCriticalSectionLocker lock(m_lock);
+        m_ri->DetectedRadar(m_interface_addr, radar_address);  // enables transmit data
+        UpdateSendCommand();
+
+        // the data socket is opened by the next CheckSockets()
+        m_radar_detected = true;
+
+        if (m_ri->m_state.GetValue() == RADAR_OFF) {
+          LOG_INFO(wxT("radar_pi: %s detected at %s"), m_ri->m_name.c_str(), radar_address.FormatNetworkAddress());
+          m_ri->m_state.Update(RADAR_STANDBY);
+        }
+      }
+      m_no_data_timeout = SECONDS_SELECT(-15);
+    }
+  } else {
+    wxLogError(wxT("radar_pi: %s illegal report"), m_ri->m_name.c_str());
+    CloseSocket(m_report_socket);
+  }
+}
+
+void NavicoReceive::NoDataTimeout() {
+  if (m_no_data_timeout >= SECONDS_SELECT(2)) {
+    m_no_data_timeout = 0;
+    if (m_report_socket != INVALID_SOCKET) {
+      CloseSocket(m_report_socket);
+      m_ri->m_state.Update(RADAR_OFF);
+      CLEAR_STRUCT(m_interface_addr);
+      m_radar_detected = false;
+    }
+  } else {
+    m_no_data_timeout++;
+  }
+
+  if (m_no_spoke_timeout >= SECONDS_SELECT(2)) {
+    m_no_spoke_timeout = 0;
+    m_ri->ResetRadarImage();
+  } else {
+    m_no_spoke_timeout++;
+  }
+}
+
+void NavicoReceive::CheckRadarInfo() {
+  if (!(m_info == m_pi->GetNavicoRadarInfo(m_ri->m_radar))) {
+    // Navicolocate modified the RadarInfo in settings
+    CloseSocket(m_report_socket);
+  };
+
+  if (m_report_socket == INVALID_SOCKET) {
+    // If we closed the report socket then close the command and data socket
+    CloseSocket(m_data_socket);
+  }
+}
+
+void NavicoReceive::CloseSockets() {
+  CloseSocket(m_data_socket);
+  CloseSocket(m_report_socket);
+  if (m_send_socket != INVALID_SOCKET) {
+    closesocket(m_send_socket);
+    m_send_socket = INVALID_SOCKET;
+  }
+  if (m_receive_socket != INVALID_SOCKET) {
+    closesocket(m_receive_socket);
+    m_receive_socket = INVALID_SOCKET;
+  }
+
+  if (m_interface_array) {
+    freeifaddrs(m_interface_array);
+    m_interface_array = 0;
+  }
+  if (m_batch) {
+    delete m_batch;
+    m_batch = 0;
+  }
+}
+
 /*
  * Entry
  *
@@ -446,50 +569,18 @@ SOCKET NavicoReceive::GetNewDataSocket() {
  */
 void *NavicoReceive::Entry(void) {
   int r = 0;
-  int no_data_timeout = 0;
-  int no_spoke_timeout = 0;
   union {
     sockaddr_storage addr;
     sockaddr_in ipv4;
   } rx_addr;
   socklen_t rx_len;
-
-  uint8_t data[sizeof(radar_frame_pkt)];
-  m_interface_array = 0;
-  m_interface = 0;
-  struct sockaddr_in radarFoundAddr;
-  sockaddr_in *radar_addr = 0;
-
-  SOCKET dataSocket = INVALID_SOCKET;
-  SOCKET reportSocket = INVALID_SOCKET;
+  uint8_t data[16];
 
   LOG_VERBOSE(wxT("radar_pi: NavicoReceive thread %s starting"), m_ri->m_name.c_str());
-  reportSocket = GetNewReportSocket();  // Start using the same interface_addr as previous time
+  OpenSockets();
 
   while (m_receive_socket != INVALID_SOCKET) {
-    if (reportSocket == INVALID_SOCKET) {
-      reportSocket = PickNextEthernetCard();
-      if (reportSocket != INVALID_SOCKET) {
-        no_data_timeout = 0;
-        no_spoke_timeout = 0;
-      }
-    }
-    if (radar_addr) {
-      // If we have detected a radar antenna at this address, start opening more sockets.
-      // We do this later for 2 reasons:
-      // - Resource consumption
-      // - Timing. If we start processing radar data before the rest of the system
-      //           is initialized then we get ordering/race condition issues.
-      if (dataSocket == INVALID_SOCKET) {
-        dataSocket = GetNewDataSocket();
-      }
-    }
-    else {
-      if (dataSocket != INVALID_SOCKET) {
-        closesocket(dataSocket);
-        dataSocket = INVALID_SOCKET;
-      }
-    }
+    CheckSockets();
 
     struct timeval tv = { (long)0, (long)(MILLIS_PER_SELECT * 1000) };
 
@@ -501,13 +592,13 @@ void *NavicoReceive::Entry(void) {
       FD_SET(m_receive_socket, &fdin);
       maxFd = MAX(m_receive_socket, maxFd);
     }
-    if (reportSocket != INVALID_SOCKET) {
-      FD_SET(reportSocket, &fdin);
-      maxFd = MAX(reportSocket, maxFd);
+    if (m_report_socket != INVALID_SOCKET) {
+      FD_SET(m_report_socket, &fdin);
+      maxFd = MAX(m_report_socket, maxFd);
     }
-    if (dataSocket != INVALID_SOCKET) {
-      FD_SET(dataSocket, &fdin);
-      maxFd = MAX(dataSocket, maxFd);
+    if (m_data_socket != INVALID_SOCKET) {
+      FD_SET(m_data_socket, &fdin);
+      maxFd = MAX(m_data_socket, maxFd);
     }
 
     wxLongLong start = wxGetUTCTimeMillis();
@@ -524,113 +615,22 @@ void *NavicoReceive::Entry(void) {
         }
       }
 
-      if (dataSocket != INVALID_SOCKET && FD_ISSET(dataSocket, &fdin)) {
-        rx_len = sizeof(rx_addr);
-        r = recvfrom(dataSocket, (char *)data, sizeof(data), 0, (struct sockaddr *)&rx_addr, &rx_len);
-        if (r > 0) {
-          ProcessFrame(data, (size_t)r);
-          no_data_timeout = -15;
-          no_spoke_timeout = -5;
-        }
-        else {
-          closesocket(dataSocket);
-          dataSocket = INVALID_SOCKET;
-          wxLogError(wxT("radar_pi: %s illegal frame"), m_ri->m_name.c_str());
-        }
+      if (m_data_socket != INVALID_SOCKET && FD_ISSET(m_data_socket, &fdin)) {
+        ReceiveData();
       }
 
-      if (reportSocket != INVALID_SOCKET && FD_ISSET(reportSocket, &fdin)) {
-        rx_len = sizeof(rx_addr);
-        r = recvfrom(reportSocket, (char *)data, sizeof(data), 0, (struct sockaddr *)&rx_addr, &rx_len);
-        if (r > 0) {
-          NetworkAddress radar_address;
-          radar_address.addr = rx_addr.ipv4.sin_addr;
-          radar_address.port = rx_addr.ipv4.sin_port;
-
-          if (ProcessReport(data, (size_t)r)) {
-            if (!radar_addr) {
-              wxCriticalSectionLocker lock(m_lock);
-              m_ri->DetectedRadar(m_interface_addr, radar_address);  // enables transmit data
-              UpdateSendCommand();
-
-              // the dataSocket is opened in the next loop
-
-              radarFoundAddr = rx_addr.ipv4;
-              radar_addr = &radarFoundAddr;
-
-              if (m_ri->m_state.GetValue() == RADAR_OFF) {
-                LOG_INFO(wxT("radar_pi: %s detected at %s"), m_ri->m_name.c_str(), radar_address.FormatNetworkAddress());
-                m_ri->m_state.Update(RADAR_STANDBY);
-              }
-            }
-            no_data_timeout = SECONDS_SELECT(-15);
-          }
-        }
-        else {
-          wxLogError(wxT("radar_pi: %s illegal report"), m_ri->m_name.c_str());
-          closesocket(reportSocket);
-          reportSocket = INVALID_SOCKET;
-        }
+      if (m_report_socket != INVALID_SOCKET && FD_ISSET(m_report_socket, &fdin)) {
+        ReceiveReport();
       }
-
     }
     else {  // no data received -> select timeout
-      if (no_data_timeout >= SECONDS_SELECT(2)) {
-        no_data_timeout = 0;
-        if (reportSocket != INVALID_SOCKET) {
-          closesocket(reportSocket);
-          reportSocket = INVALID_SOCKET;
-          m_ri->m_state.Update(RADAR_OFF);
-          CLEAR_STRUCT(m_interface_addr);
-          radar_addr = 0;
-        }
-      }
-      else {
-        no_data_timeout++;
-      }
-
-      if (no_spoke_timeout >= SECONDS_SELECT(2)) {
-        no_spoke_timeout = 0;
-        m_ri->ResetRadarImage();
-      }
-      else {
-        no_spoke_timeout++;
-      }
+      NoDataTimeout();
     }
 
-    if (!(m_info == m_pi->GetNavicoRadarInfo(m_ri->m_radar))) {
-    // Navicolocate modified the RadarInfo in settings
-      closesocket(reportSocket);
-      reportSocket = INVALID_SOCKET;
-    };
-
-    if (reportSocket == INVALID_SOCKET) {
-      // If we closed the reportSocket then close the command and data socket
-      if (dataSocket != INVALID_SOCKET) {
-        closesocket(dataSocket);
-        dataSocket = INVALID_SOCKET;
-      }
-    }
-    
+    CheckRadarInfo();
   }  // endless loop until thread destroy
 
-  if (dataSocket != INVALID_SOCKET) {
-    closesocket(dataSocket);
-  }
-  if (reportSocket != INVALID_SOCKET) {
-    closesocket(reportSocket);
-  }
-  if (m_send_socket != INVALID_SOCKET) {
-    closesocket(m_send_socket);
-    m_send_socket = INVALID_SOCKET;
-  }
-  if (m_receive_socket != INVALID_SOCKET) {
-    closesocket(m_receive_socket);
-  }
-
-  if (m_interface_array) {
-    freeifaddrs(m_interface_array);
-  }
+  CloseSockets();
 
 #ifdef TEST_THREAD_RACES
   LOG_VERBOSE(wxT("radar_pi: %s receive thread sleeping"), m_ri->m_name.c_str());
@@ -641,6 +641,56 @@ void *NavicoReceive::Entry(void) {
   return 0;
 }
 
+/*
+ * Attach
+ *
+ * Instead of Entry() running the loop above, the reactor calls OnReadable() for
+ * every readable socket and OnTimer() every MILLIS_PER_SELECT ms. The timer also
+ * does what the select timeout does, but only if nothing was received in between.
+ */
+bool NavicoReceive::Attach(RadarReactor *reactor) {
+  m_reactor = reactor;
+  if (!m_reactor->AddTimer(this, 0, MILLIS_PER_SELECT)) {
+    m_reactor = 0;
+    return false;
+  }
+  LOG_VERBOSE(wxT("radar_pi: %s receiving on reactor thread"), m_ri->m_name.c_str());
+  return true;
+}
+
+void NavicoReceive::Detach() {
+  if (m_reactor) {
+    m_reactor->RemoveHandler(this);
+    CloseSockets();
+    m_reactor = 0;
+    LOG_VERBOSE(wxT("radar_pi: %s detached from reactor thread"), m_ri->m_name.c_str());
+  }
+  m_is_shutdown = true;
+}
+
+void NavicoReceive::OnReadable(SOCKET socket) {
+  if (socket == m_data_socket) {
+    ReceiveData();
+  } else if (socket == m_report_socket) {
+    ReceiveReport();
+  }
+  m_activity = true;
+}
+
+void NavicoReceive::OnTimer(int timer) {
+  if (!m_batch) {
+    // First tick, open the sockets here so they are only ever touched on the reactor thread
+    OpenSockets();
+  } else {
+    if (!m_activity) {
+      NoDataTimeout();
+    }
+    m_activity = false;
+    CheckRadarInfo();
+  }
+  CheckSockets();
+}
+
 void NavicoReceive::SetRadarType(RadarType t) {
   m_ri->m_radar_type = t;
   // m_pi->m_pMessageBox->SetRadarType(t);
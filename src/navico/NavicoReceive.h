@@ -34,7 +34,9 @@
 
 #include "NavicoCommon.h"
 #include "NavicoLocate.h"
+#include "RadarReactor.h"
 #include "RadarReceive.h"
+#include "core/SpokeDecode.h"
 #include "socketutil.h"
 
 PLUGIN_BEGIN_NAMESPACE
@@ -43,7 +45,7 @@ PLUGIN_BEGIN_NAMESPACE
 // An intermediary class that implements the common parts of any Navico radar.
 //
 
-class NavicoReceive : public RadarReceive {
+class NavicoReceive : public RadarReceive, public ReactorHandler {
  public:
   NavicoReceive(radar_pi *pi, RadarInfo *ri, NetworkAddress reportAddr, NetworkAddress dataAddr, NetworkAddress sendAddr)
       : RadarReceive(pi, ri) {
@@ -52,18 +54,31 @@ class NavicoReceive : public RadarReceive {
     m_info.report_addr = reportAddr;
     m_info.send_command_addr = sendAddr;
     m_next_spoke = -1;
+    m_previous_angle_raw = 0;
+    m_odd_spokes = 0;
+    m_full_resolution_warned = false;
     m_radar_status = 0;
     m_shutdown_time_requested = 0;
     m_is_shutdown = false;
     m_first_receive = true;
+    m_report_socket = INVALID_SOCKET;
+    m_data_socket = INVALID_SOCKET;
+    m_radar_detected = false;
+    m_no_data_timeout = 0;
+    m_no_spoke_timeout = 0;
+    m_batch = 0;
+    m_interface_array = 0;
+    m_interface = 0;
+    m_reactor = 0;
+    m_activity = false;
     m_interface_addr = m_pi->GetRadarInterfaceAddress(ri->m_radar);
-    
+
     m_receive_socket = GetLocalhostServerTCPSocket();
     m_send_socket = GetLocalhostSendTCPSocket(m_receive_socket);
     SetInfoStatus(wxString::Format(wxT("%s: %s"), m_ri->m_name.c_str(), _("Initializing")));
     SetPriority(wxPRIORITY_MAX);
     LOG_INFO(wxT("radar_pi: %s receive thread created, prio= %i"), m_ri->m_name.c_str(), GetPriority());
-    InitializeLookupData();
+    SpokeDecodeInit();
 
     NavicoRadarInfo info = m_pi->GetNavicoRadarInfo(m_ri->m_radar);
     if (info.report_addr.IsNull() && !m_info.report_addr.IsNull()) {
@@ -81,11 +96,20 @@ class NavicoReceive : public RadarReceive {
 
   ~NavicoReceive(){};
 
-  void InitializeLookupData();
-
   void *Entry(void);
   void Shutdown(void);
+  bool Attach(RadarReactor *reactor);
+  void Detach(void);
+  void OnReadable(SOCKET socket);
+  void OnTimer(int timer);
   wxString GetInfoStatus();
+  void ProcessPacket(RecordSocketRole role, const uint8_t *data, size_t len) {
+    if (role == RECORD_DATA) {
+      ProcessFrame(data, len);
+    } else {
+      ProcessReport(data, len);
+    }
+  }
 
   NetworkAddress m_interface_addr;
   NavicoRadarInfo m_info;
@@ -94,23 +118,47 @@ class NavicoReceive : public RadarReceive {
   volatile bool m_is_shutdown;
 
  private:
-  void ProcessFrame(const uint8_t *data, size_t len);
+  void ProcessFrame(const uint8_t *data, size_t len, wxLongLong time_rec = 0);
   bool ProcessReport(const uint8_t *data, size_t len);
 
   SOCKET PickNextEthernetCard();
   SOCKET GetNewReportSocket();
   SOCKET GetNewDataSocket();
 
+  // The receive loop, split up so that it can run from Entry() or from the reactor
+  void OpenSockets();
+  void CheckSockets();
+  void ReceiveData();
+  void ReceiveReport();
+  void NoDataTimeout();
+  void CheckRadarInfo();
+  void CloseSockets();
+
+  void WatchSocket(SOCKET socket);
+  void CloseSocket(SOCKET &socket);
+
   void UpdateSendCommand();
   void SetRadarType(RadarType t);
 
   SOCKET m_receive_socket;  // Where we listen for message from m_send_socket
   SOCKET m_send_socket;     // A message to this socket will interrupt select() and allow immediate shutdown
+  SOCKET m_report_socket;
+  SOCKET m_data_socket;
+
+  bool m_radar_detected;    // Radar has sent a report, so the data socket may be opened
+  int m_no_data_timeout;    // Counts select timeouts or reactor ticks without any data
+  int m_no_spoke_timeout;   // Idem, reset by spokes only
+  ReceiveBatch *m_batch;    // Reused for every burst of frames on the data socket
+  RadarReactor *m_reactor;  // Set when attached to the reactor instead of running Entry()
+  bool m_activity;          // Something was received since the previous reactor tick
 
   struct ifaddrs *m_interface_array;
   struct ifaddrs *m_interface;
 
   int m_next_spoke;
+  int m_previous_angle_raw;       // Only maintained in full resolution mode
+  int m_odd_spokes;               // # of odd spoke IDs this rotation, in full resolution mode
+  bool m_full_resolution_warned;  // Logged that full resolution is of no use for this radar
   char m_radar_status;
   bool m_first_receive;
 
@@ -86,6 +86,8 @@ extern "C" {
 #include <wx/socket.h>
 #include <fstream>
 
+#include "core/RadarCore.h"
+
 using namespace std;
 
 #ifdef __WXGTK__
@@ -161,18 +163,4 @@ using namespace std;
 
 #define DEGREES_PER_ROTATION (360)  // Classical math
 
-struct GeoPosition {
-  double lat;
-  double lon;
-};
-
-struct ExtendedPosition {
-  GeoPosition pos;
-  double dlat_dt;   // m / sec
-  double dlon_dt;   // m / sec
-  wxLongLong time;  // millis
-  double speed_kn;
-  double sd_speed_kn;  // standard deviation of the speed in knots
-};
-
 #endif
@@ -32,10 +32,11 @@
 #include "radar_pi.h"
 #include "GuardZone.h"
 #include "GuardZoneBogey.h"
-#include "Kalman.h"
+#include "core/Kalman.h"
 #include "MessageBox.h"
 #include "OptionsDialog.h"
 #include "RadarMarpa.h"
+#include "RadarReactor.h"
 #include "SelectDialog.h"
 #include "icons.h"
 #include "navico/NavicoLocate.h"
@@ -109,10 +110,11 @@ static double radar_distance(GeoPosition pos1, GeoPosition pos2, char unit) {
 //
 //---------------------------------------------------------------------------------------------------------
 
-enum { TIMER_ID = 51 };
+enum { TIMER_ID = 51, NMEA_TIMER_ID };
 
 BEGIN_EVENT_TABLE(radar_pi, wxEvtHandler)
 EVT_TIMER(TIMER_ID, radar_pi::OnTimerNotify)
+EVT_TIMER(NMEA_TIMER_ID, radar_pi::OnNMEATimerNotify)
 END_EVENT_TABLE()
 
 //---------------------------------------------------------------------------------------------------------
@@ -136,6 +138,7 @@ radar_pi::radar_pi(void *ppimgr) : opencpn_plugin_116(ppimgr) {
   m_opencpn_gl_context_broken = false;
 
   m_timer = 0;
+  m_nmea_timer = 0;
   for (int r = 0; r < RADARS; r++) {
     m_context_menu_control_id[r] = -1;
   }
@@ -145,6 +148,20 @@ radar_pi::radar_pi(void *ppimgr) : opencpn_plugin_116(ppimgr) {
 
 radar_pi::~radar_pi() {}
 
+/*
+ * Messages logged by the radar_core library arrive here and go to the wxWidgets log,
+ * subject to the same 'verbose' setting as the LOG_xxx macros.
+ */
+static void LogCoreMessage(void *context, CoreLogLevel level, const char *message) {
+  radar_pi *pi = (radar_pi *)context;
+
+  if (level == CORE_LOG_ERROR) {
+    wxLogError(wxT("%s"), wxString(message, wxConvUTF8).c_str());
+  } else if (level == CORE_LOG_INFO || (pi->m_settings.verbose & level) != 0) {
+    wxLogMessage(wxT("%s"), wxString(message, wxConvUTF8).c_str());
+  }
+}
+
 /*
  * Init() is called -every- time that the plugin is enabled. If a user is being nasty
  * they can enable/disable multiple times in the overview. Grrr!
@@ -158,6 +175,8 @@ int radar_pi::Init(void) {
   }
 
   if (m_first_init) {
+    CoreSetLogSink(LogCoreMessage, this);
+
 #ifdef __WXMSW__
     WSADATA wsaData;
 
@@ -249,6 +268,7 @@ int radar_pi::Init(void) {
   LOG_INFO(wxT(PLUGIN_VERSION_WITH_DATE));
 
   m_locator = 0;
+  m_reactor = 0;
 
   // Create objects before config, so config can set data in it
   // This does not start any threads or generate any UI.
@@ -291,12 +311,24 @@ int radar_pi::Init(void) {
 
   // CacheSetToolbarToolBitmaps(BM_ID_RED, BM_ID_BLANK);
 
+  if (m_settings.reactor) {
+    m_reactor = new RadarReactor();
+    if (m_reactor->Init() && m_reactor->Run() == wxTHREAD_NO_ERROR) {
+      LOG_INFO(wxT("radar_pi: Navico radars receive on shared reactor thread"));
+    } else {
+      LOG_INFO(wxT("radar_pi: reactor not available, using a receive thread per radar"));
+      delete m_reactor;
+      m_reactor = 0;
+    }
+  }
+
   // Now that the settings are made we can initialize the RadarInfos
   for (size_t r = 0; r < M_SETTINGS.radar_count; r++) {
     m_radar[r]->Init();
-    if ((m_radar[r]->m_radar_type == RT_3G || m_radar[r]->m_radar_type == RT_4GA || m_radar[r]->m_radar_type == RT_HaloA) && m_locator == NULL) {
+    if ((m_radar[r]->m_radar_type == RT_3G || m_radar[r]->m_radar_type == RT_4GA || m_radar[r]->m_radar_type == RT_HaloA) &&
+        !m_radar[r]->m_replay && m_locator == NULL) {
       m_locator = new NavicoLocate(this);
-      if (m_locator->Run() != wxTHREAD_NO_ERROR) {
+      if ((!m_reactor || !m_locator->Attach(m_reactor)) && m_locator->Run() != wxTHREAD_NO_ERROR) {
         wxLogError(wxT("radar_pi: unable to start Navico Radar Locator thread"));
         return 0;
       }
@@ -351,6 +383,8 @@ int radar_pi::Init(void) {
 
   m_notify_time_ms = 0;
   m_timer = new wxTimer(this, TIMER_ID);
+  m_nmea_timer = new wxTimer(this, NMEA_TIMER_ID);
+  m_nmea_timer->Start(ARPA_NMEA_MILLIS);
 
   return PLUGIN_OPTIONS;
 }
@@ -375,10 +409,19 @@ bool radar_pi::DeInit(void) {
     delete m_timer;
     m_timer = 0;
   }
+  if (m_nmea_timer) {
+    m_nmea_timer->Stop();
+    delete m_nmea_timer;
+    m_nmea_timer = 0;
+  }
 
   if (m_locator) {
-    m_locator->Shutdown();
-    m_locator->Wait();
+    if (m_locator->IsAttached()) {
+      m_locator->Detach();
+    } else {
+      m_locator->Shutdown();
+      m_locator->Wait();
+    }
   }
 
   // Stop processing in all radars.
@@ -388,6 +431,14 @@ bool radar_pi::DeInit(void) {
     m_radar[r]->Shutdown();
   }
 
+  // Nothing is attached to the reactor anymore
+  if (m_reactor) {
+    m_reactor->Shutdown();
+    m_reactor->Wait();
+    delete m_reactor;
+    m_reactor = 0;
+  }
+
   if (m_bogey_dialog) {
     delete m_bogey_dialog;  // This will also save its current pos in m_settings
     m_bogey_dialog = 0;
@@ -470,7 +521,7 @@ bool radar_pi::MakeRadarSelection() {
 
   for (r = 0; r < RADARS; r++) {
     if (m_radar[r]) {
-      oldRadarType[r] = m_radar[r]->m_radar_type;
+      oldRadarType[r] = m_radar[r]->m_replay ? RT_REPLAY : m_radar[r]->m_radar_type;
       LOG_INFO(wxT("OLD radarnr= %i, type = %i"), r, m_radar[r]->m_radar_type);
     } else {
       oldRadarType[r] = RT_MAX;
@@ -1025,6 +1076,19 @@ void radar_pi::OnTimerNotify(wxTimerEvent &event) {
   }
 }
 
+// The ARPA trackers run on their own threads, pass what they found to OCPN from here. This timer
+// runs whether or not the radar is drawn, so the sentences do not pile up without OpenGL.
+void radar_pi::OnNMEATimerNotify(wxTimerEvent &event) {
+  if (!m_initialized) {
+    return;
+  }
+  for (size_t r = 0; r < M_SETTINGS.radar_count; r++) {
+    if (m_radar[r] && m_radar[r]->m_arpa) {
+      m_radar[r]->m_arpa->PushNMEA();
+    }
+  }
+}
+
 // Called between 1 and 10 times per second by RenderGLOverlay call
 void radar_pi::TimedControlUpdate() {
   wxLongLong now = wxGetUTCTimeMillis();
@@ -1079,18 +1143,33 @@ void radar_pi::TimedControlUpdate() {
     PassHeadingToOpenCPN();
   }
 
-  if (m_pMessageBox->IsShown() || (m_settings.verbose != 0)) {
-    wxString t;
-    for (size_t r = 0; r < M_SETTINGS.radar_count; r++) {
-      if (m_radar[r]->m_state.GetValue() != RADAR_OFF) {
-        wxCriticalSectionLocker lock(m_radar[r]->m_exclusive);
-
-        t << wxString::Format(wxT("%s\npackets %d/%d\nspokes %d/%d/%d\n"), m_radar[r]->m_name.c_str(),
-                              m_radar[r]->m_statistics.packets, m_radar[r]->m_statistics.broken_packets,
-                              m_radar[r]->m_statistics.spokes, m_radar[r]->m_statistics.broken_spokes,
-                              m_radar[r]->m_statistics.missing_spokes);
+  // Always take and reset the counters, so they don't show huge numbers after IsShown changes.
+  // The receive threads keep counting meanwhile, so each counter is read and reset in one go.
+  bool show_statistics = m_pMessageBox->IsShown() || (m_settings.verbose != 0);
+  wxString t;
+  for (size_t r = 0; r < M_SETTINGS.radar_count; r++) {
+    receive_statistics &statistics = m_radar[r]->m_statistics;
+    int packets = statistics.packets.exchange(0);
+    int broken_packets = statistics.broken_packets.exchange(0);
+    int spokes = statistics.spokes.exchange(0);
+    int broken_spokes = statistics.broken_spokes.exchange(0);
+    int missing_spokes = statistics.missing_spokes.exchange(0);
+    int overflow_spokes = statistics.overflow_spokes.exchange(0);
+    int kernel_drops = statistics.kernel_drops.exchange(0);
+    int receive_calls = statistics.receive_calls.exchange(0);
+
+    if (show_statistics && m_radar[r]->m_state.GetValue() != RADAR_OFF) {
+      t << wxString::Format(wxT("%s\npackets %d/%d\nspokes %d/%d/%d/%d\n"), m_radar[r]->m_name.c_str(), packets, broken_packets,
+                            spokes, broken_spokes, missing_spokes, overflow_spokes);
+      if (kernel_drops > 0) {
+        t << wxString::Format(wxT("kernel drops %d\n"), kernel_drops);
+      }
+      if (receive_calls > 0) {
+        t << wxString::Format(wxT("packets/call %.1f\n"), (double)packets / receive_calls);
       }
     }
+  }
+  if (show_statistics) {
     m_pMessageBox->SetStatisticsInfo(t);
 
     IF_LOG_AT_LEVEL(LOGLEVEL_RECEIVE) {
@@ -1101,17 +1180,6 @@ void radar_pi::TimedControlUpdate() {
     }
   }
 
-  // Always reset the counters, so they don't show huge numbers after IsShown changes
-  for (size_t r = 0; r < M_SETTINGS.radar_count; r++) {
-    wxCriticalSectionLocker lock(m_radar[r]->m_exclusive);
-
-    m_radar[r]->m_statistics.broken_packets = 0;
-    m_radar[r]->m_statistics.broken_spokes = 0;
-    m_radar[r]->m_statistics.missing_spokes = 0;
-    m_radar[r]->m_statistics.packets = 0;
-    m_radar[r]->m_statistics.spokes = 0;
-  }
-
   wxString info;
   switch (m_heading_source) {
     case HEADING_NONE:
@@ -1234,7 +1302,6 @@ bool radar_pi::RenderGLOverlayMultiCanvas(wxGLContext *pcontext, PlugIn_ViewPort
       m_radar[r]->SetRadarPosition(m_ownship, m_hdt);
     }
   }
-
   wxLongLong now = wxGetUTCTimeMillis();
   // Update m_overlay[canvasIndex] by checking all radars, value may be modified by the buttons
   m_chart_overlay[canvasIndex] = -1;
@@ -1256,26 +1323,6 @@ bool radar_pi::RenderGLOverlayMultiCanvas(wxGLContext *pcontext, PlugIn_ViewPort
     return true;
   }
 
-  // refresh ARPA targets only with canvas 0
-  if (canvasIndex == 0) {
-    for (size_t r = 0; r < M_SETTINGS.radar_count; r++) {
-      bool arpa_on = false;
-      if (m_radar[r]->m_arpa) {
-        for (int i = 0; i < GUARD_ZONES; i++) {
-          if (m_radar[r]->m_guard_zone[i]->m_arpa_on) {
-            arpa_on = true;
-          }
-        }
-        if (m_radar[r]->m_arpa->GetTargetCount() > 0) {
-          arpa_on = true;
-        }
-      }
-      if (arpa_on) {
-        m_radar[r]->m_arpa->RefreshArpaTargets();
-      }
-    }
-  }
-
   m_vp = vp;
 
   LOG_DIALOG(wxT("radar_pi: RenderGLOverlayMultiCanvas context=%p canvas=%d"), pcontext, canvasIndex);
@@ -1419,6 +1466,7 @@ bool radar_pi::LoadConfig(void) {
       ri->m_boot_state.Update(v);
       pConf->Read(wxString::Format(wxT("Radar%dMinContourLength"), r), &ri->m_min_contour_length, 6);
       if (ri->m_min_contour_length > 10) ri->m_min_contour_length = 6;  // Prevent user and system error
+      pConf->Read(wxString::Format(wxT("Radar%dFullResolution"), r), &ri->m_full_resolution, false);
 
       RadarControlItem item;
       pConf->Read(wxString::Format(wxT("Radar%dTrailsState"), r), &state, RCS_OFF);
@@ -1492,6 +1540,10 @@ bool radar_pi::LoadConfig(void) {
     m_settings.doppler_receding_colour = wxColour(s);
     pConf->Read(wxT("DeveloperMode"), &m_settings.developer_mode, false);
     pConf->Read(wxT("DrawingMethod"), &m_settings.drawing_method, 0);
+    pConf->Read(wxT("RecordDirectory"), &m_settings.record_directory, wxEmptyString);
+    pConf->Read(wxT("ReplayFile"), &m_settings.replay_file, wxEmptyString);
+    pConf->Read(wxT("ReplaySpeed"), &v, 1);
+    m_settings.replay_speed = wxMax(v, 0);
     pConf->Read(wxT("GuardZoneDebugInc"), &m_settings.guard_zone_debug_inc, 0);
     pConf->Read(wxT("GuardZoneOnOverlay"), &m_settings.guard_zone_on_overlay, true);
     pConf->Read(wxT("OverlayStandby"), &m_settings.overlay_on_standby, true);
@@ -1499,6 +1551,7 @@ bool radar_pi::LoadConfig(void) {
     pConf->Read(wxT("GuardZonesRenderStyle"), &m_settings.guard_zone_render_style, 0);
     pConf->Read(wxT("GuardZonesThreshold"), &m_settings.guard_zone_threshold, 5L);
     pConf->Read(wxT("IgnoreRadarHeading"), &m_settings.ignore_radar_heading, 0);
+    pConf->Read(wxT("Reactor"), &m_settings.reactor, false);
     pConf->Read(wxT("ShowExtremeRange"), &m_settings.show_extreme_range, false);
     pConf->Read(wxT("MenuAutoHide"), &m_settings.menu_auto_hide, 0);
     pConf->Read(wxT("PassHeadingToOCPN"), &m_settings.pass_heading_to_opencpn, false);
@@ -1549,10 +1602,14 @@ bool radar_pi::SaveConfig(void) {
     pConf->Write(wxT("GuardZonesRenderStyle"), m_settings.guard_zone_render_style);
     pConf->Write(wxT("GuardZonesThreshold"), m_settings.guard_zone_threshold);
     pConf->Write(wxT("IgnoreRadarHeading"), m_settings.ignore_radar_heading);
+    pConf->Write(wxT("Reactor"), m_settings.reactor);
     pConf->Write(wxT("ShowExtremeRange"), m_settings.show_extreme_range);
     pConf->Write(wxT("MenuAutoHide"), m_settings.menu_auto_hide);
     pConf->Write(wxT("PassHeadingToOCPN"), m_settings.pass_heading_to_opencpn);
     pConf->Write(wxT("RangeUnits"), (int)m_settings.range_units);
+    pConf->Write(wxT("RecordDirectory"), m_settings.record_directory);
+    pConf->Write(wxT("ReplayFile"), m_settings.replay_file);
+    pConf->Write(wxT("ReplaySpeed"), m_settings.replay_speed);
     pConf->Write(wxT("Refreshrate"), m_settings.refreshrate.GetValue());
     pConf->Write(wxT("ReverseZoom"), m_settings.reverse_zoom);
     pConf->Write(wxT("ScanMaxAge"), m_settings.max_age);
@@ -1579,7 +1636,7 @@ bool radar_pi::SaveConfig(void) {
     pConf->Write(wxT("DockSize"), m_settings.dock_size);
 
     for (int r = 0; r < (int)m_settings.radar_count; r++) {
-      pConf->Write(wxString::Format(wxT("Radar%dType"), r), RadarTypeName[m_radar[r]->m_radar_type]);
+      pConf->Write(wxString::Format(wxT("Radar%dType"), r), RadarTypeName[m_radar[r]->m_replay ? RT_REPLAY : m_radar[r]->m_radar_type]);
       pConf->Write(wxString::Format(wxT("Radar%dNavicoInfo"), r), m_settings.navico_radar_info[r].to_string());
       pConf->Write(wxString::Format(wxT("Radar%dAddress"), r), m_settings.radar_address[r].FormatNetworkAddress());
       pConf->Write(wxString::Format(wxT("Radar%dInterface"), r), m_settings.radar_interface_address[r].FormatNetworkAddress());
@@ -1601,6 +1658,7 @@ bool radar_pi::SaveConfig(void) {
       pConf->Write(wxString::Format(wxT("Radar%dAntennaForward"), r), m_radar[r]->m_antenna_forward.GetValue());
       pConf->Write(wxString::Format(wxT("Radar%dAntennaStarboard"), r), m_radar[r]->m_antenna_starboard.GetValue());
       pConf->Write(wxString::Format(wxT("Radar%dRunTimeOnIdle"), r), m_radar[r]->m_timed_run.GetValue());
+      pConf->Write(wxString::Format(wxT("Radar%dFullResolution"), r), m_radar[r]->m_full_resolution);
       for (int i = 0; i < MAX_CHART_CANVAS; i++) {
         pConf->Write(wxString::Format(wxT("Radar%dOverlayCanvas%d"), r, i), m_radar[r]->m_overlay_canvas[i].GetValue());
       }
@@ -1826,7 +1884,7 @@ void radar_pi::SetPositionFixEx(PlugIn_Position_Fix_Ex &pfix) {
 
   GPS_position.pos.lat = pfix.Lat;
   GPS_position.pos.lon = pfix.Lon;
-  GPS_position.time = wxGetUTCTimeMillis();
+  GPS_position.time = wxGetUTCTimeMillis().GetValue();
   GPS_position.dlat_dt = 0.;
   GPS_position.dlon_dt = 0.;
   GPS_position.sd_speed_kn = 0.;
@@ -1937,6 +1995,8 @@ void radar_pi::SetPluginMessage(wxString &message_id, wxString &message_body) {
       }
     }
   } else if (message_id == wxS("AIS") || m_ais_in_arpa_zone.size() > 0) {
+    wxCriticalSectionLocker lock(m_exclusive);  // The ARPA tracker threads read m_ais_in_arpa_zone
+
     // Check for ARPA targets
     bool arpa_is_present = false;
     for (size_t r = 0; r < M_SETTINGS.radar_count; r++) {
@@ -1995,6 +2055,7 @@ void radar_pi::SetPluginMessage(wxString &message_id, wxString &message_body) {
 }
 
 bool radar_pi::FindAIS_at_arpaPos(const GeoPosition &pos, const double &arpa_dist) {
+  wxCriticalSectionLocker lock(m_exclusive);
   m_arpa_max_range = MAX(arpa_dist + 200, m_arpa_max_range);  // For AIS search area
   if (m_ais_in_arpa_zone.size() < 1) return false;
   bool hit = false;
@@ -36,6 +36,7 @@
 #define MY_API_VERSION_MINOR 16  // Needed for PluginAISDrawGL().
 
 #include <algorithm>
+#include <atomic>
 #include <vector>
 #include "RadarControlItem.h"
 #include "drawutil.h"
@@ -75,6 +76,7 @@ class GuardZoneBogey;
 class RadarArpa;
 class GPSKalmanFilter;
 class NavicoLocate;
+class RadarReactor;
 
 #define MAX_CHART_CANVAS (2)  // How many canvases OpenCPN supports
 #define RADARS (4)            // Arbitrary limit, anyone running this many is already crazy!
@@ -191,12 +193,26 @@ enum RadarState {
 static ToolbarIconColor g_toolbarIconColor[9] = {TB_SEARCHING, TB_STANDBY, TB_SEEN,   TB_SEEN,  TB_SEEN,
                                                  TB_SEEN,      TB_ACTIVE,  TB_ACTIVE, TB_ACTIVE};
 
+// Counted by the receive threads without a lock, taken and reset by radar_pi::TimedControlUpdate()
 struct receive_statistics {
-  int packets;
-  int broken_packets;
-  int spokes;
-  int broken_spokes;
-  int missing_spokes;
+  std::atomic<int> packets;
+  std::atomic<int> broken_packets;
+  std::atomic<int> spokes;
+  std::atomic<int> broken_spokes;
+  std::atomic<int> missing_spokes;
+  std::atomic<int> kernel_drops;     // Data packets dropped by the kernel because the socket buffer was full, Linux only
+  std::atomic<int> overflow_spokes;  // Spokes dropped because the spoke queue to the process thread was full
+  std::atomic<int> receive_calls;    // System calls made to read 'packets' from the data socket, if counted
+
+  receive_statistics()
+      : packets(0),
+        broken_packets(0),
+        spokes(0),
+        broken_spokes(0),
+        missing_spokes(0),
+        kernel_drops(0),
+        overflow_spokes(0),
+        receive_calls(0) {}
 };
 
 typedef enum GuardZoneType { GZ_ARC, GZ_CIRCLE } GuardZoneType;
@@ -375,6 +391,9 @@ struct PersistentSettings {
   int menu_auto_hide;                              // 0 = none, 1 = 10s, 2 = 30s
   int drawing_method;                              // VertexBuffer, Shader, etc.
   bool developer_mode;                             // Readonly from config, allows head up mode
+  wxString record_directory;                       // When set, received radar packets are recorded to files here
+  wxString replay_file;                            // Capture file played back by the Replay radar type
+  int replay_speed;                                // 0 = as fast as possible, 1 = real time, N = N times real time
   bool show;                                       // whether to show any radar (overlay or window)
   bool show_radar[RADARS];                         // whether to show radar window
   bool dock_radar[RADARS];                         // whether to dock radar window
@@ -384,6 +403,7 @@ struct PersistentSettings {
   bool pass_heading_to_opencpn;                    // Pass heading coming from radar as NMEA data to OpenCPN
   bool enable_cog_heading;                         // Allow COG as heading. Should be taken out back and shot.
   bool ignore_radar_heading;                       // For testing purposes
+  bool reactor;                                    // Linux: receive Navico radars on one epoll thread
   bool reverse_zoom;                               // false = normal, true = reverse
   bool show_extreme_range;                         // Show red ring at extreme range and center
   bool reset_radars;                               // True on exit of OptionsDialog when reset of radars is pressed
@@ -575,12 +595,13 @@ class radar_pi : public opencpn_plugin_116, public wxEvtHandler {
   RadarInfo *m_radar[RADARS];
   wxString m_perspective[RADARS];  // Temporary storage of window location when plugin is disabled
   NavicoLocate *m_locator;
+  RadarReactor *m_reactor;  // Shared receive thread for Navico radars and locator, or 0
 
   MessageBox *m_pMessageBox;
   wxWindow *m_parent_window;
 
   // Check for AIS targets inside ARPA zone
-  vector<AisArpa> m_ais_in_arpa_zone;  // Array for AIS targets in ARPA zone(s)
+  vector<AisArpa> m_ais_in_arpa_zone;  // Array for AIS targets in ARPA zone(s), protected by m_exclusive
   bool FindAIS_at_arpaPos(const GeoPosition &pos, const double &arpa_dist);
 #define BASE_ARPA_DIST (750.)
   double m_arpa_max_range;  //  Temporary distance(m) fron own ship to collect AIS targets.
@@ -599,6 +620,7 @@ class radar_pi : public opencpn_plugin_116, public wxEvtHandler {
   void SetRadarWindowViz(bool reparent = false);
   void UpdateCOGAvg(double cog);
   void OnTimerNotify(wxTimerEvent &event);
+  void OnNMEATimerNotify(wxTimerEvent &event);
   void TimedControlUpdate();
   void ScheduleWindowRefresh();
   void SetOpenGLMode(OpenGLMode mode);
@@ -703,6 +725,7 @@ class radar_pi : public opencpn_plugin_116, public wxEvtHandler {
   bool m_opencpn_gl_context_broken;
 
   wxTimer *m_timer;
+  wxTimer *m_nmea_timer;  // Passes the ARPA sentences to OCPN
 
   DECLARE_EVENT_TABLE()
 };
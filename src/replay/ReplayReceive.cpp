@@ -0,0 +1,296 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "ReplayReceive.h"
+#include "RadarFactory.h"
+#include "SpokeQueue.h"
+
+#ifndef __WXMSW__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define MILLIS_PER_SELECT 250
+
+ReplayReceive::ReplayReceive(radar_pi *pi, RadarInfo *ri) : RadarReceive(pi, ri) {
+  m_filename = m_pi->m_settings.replay_file;
+  m_speed = m_pi->m_settings.replay_speed;
+  m_shutdown = false;
+  m_map = 0;
+  m_map_len = 0;
+#ifdef __WXMSW__
+  m_file_handle = INVALID_HANDLE_VALUE;
+  m_map_handle = 0;
+#endif
+
+  // RadarInfo::Init() has already switched m_radar_type to the recorded type if the file is usable
+  m_decoder = 0;
+  if (m_ri->m_replay) {
+    m_decoder = RadarFactory::MakeRadarReceive(m_ri->m_radar_type, pi, ri);
+  }
+  SetInfoStatus(wxString::Format(wxT("%s: %s"), m_ri->m_name.c_str(), _("Initializing")));
+  LOG_RECEIVE(wxT("radar_pi: %s replay thread created for %s"), m_ri->m_name.c_str(), m_filename.c_str());
+}
+
+ReplayReceive::~ReplayReceive() {
+  UnmapFile();
+  if (m_decoder) {
+    delete m_decoder;
+    m_decoder = 0;
+  }
+}
+
+RadarType ReplayReceive::GetRecordedRadarType(const wxString &filename) {
+  RecordFileHeader header;
+
+  if (filename.IsEmpty() || !wxFileExists(filename)) {
+    return RT_MAX;
+  }
+  wxFFile file(filename, wxT("rb"));
+  if (!file.IsOpened() || file.Read(&header, sizeof(header)) != sizeof(header)) {
+    wxLogError(wxT("radar_pi: cannot read replay file %s"), filename.c_str());
+    return RT_MAX;
+  }
+  if (memcmp(header.magic, RECORD_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != RECORD_FILE_VERSION) {
+    wxLogError(wxT("radar_pi: %s is not a radar capture file"), filename.c_str());
+    return RT_MAX;
+  }
+
+  // Match on name, not on the stored number, as the RadarType enum changes when types are added
+  header.radar_name[sizeof(header.radar_name) - 1] = 0;
+  wxString name(header.radar_name, wxConvUTF8);
+  for (int i = 0; i < RT_MAX; i++) {
+    if (i != RT_REPLAY && i != RT_EMULATOR && name.IsSameAs(RadarTypeName[i])) {
+      return (RadarType)i;
+    }
+  }
+  wxLogError(wxT("radar_pi: replay file %s contains unsupported radar type %s"), filename.c_str(), name.c_str());
+  return RT_MAX;
+}
+
+bool ReplayReceive::MapFile() {
+#ifdef __WXMSW__
+  m_file_handle = CreateFileW(m_filename.wc_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+  if (m_file_handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(m_file_handle, &size) || size.QuadPart < (LONGLONG)sizeof(RecordFileHeader)) {
+    return false;
+  }
+  m_map_handle = CreateFileMapping(m_file_handle, 0, PAGE_READONLY, 0, 0, 0);
+  if (!m_map_handle) {
+    return false;
+  }
+  m_map = (const uint8_t *)MapViewOfFile(m_map_handle, FILE_MAP_READ, 0, 0, 0);
+  if (!m_map) {
+    return false;
+  }
+  m_map_len = (size_t)size.QuadPart;
+#else
+  int fd = open(m_filename.fn_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(RecordFileHeader)) {
+    close(fd);
+    return false;
+  }
+  void *map = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+  m_map = (const uint8_t *)map;
+  m_map_len = (size_t)st.st_size;
+#endif
+  return true;
+}
+
+void ReplayReceive::UnmapFile() {
+#ifdef __WXMSW__
+  if (m_map) {
+    UnmapViewOfFile(m_map);
+  }
+  if (m_map_handle) {
+    CloseHandle(m_map_handle);
+    m_map_handle = 0;
+  }
+  if (m_file_handle != INVALID_HANDLE_VALUE) {
+    CloseHandle(m_file_handle);
+    m_file_handle = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (m_map) {
+    munmap((void *)m_map, m_map_len);
+  }
+#endif
+  m_map = 0;
+  m_map_len = 0;
+}
+
+/*
+ * Wait until the packet recorded 'recorded_us' after the first packet is due.
+ * Returns false if the thread was asked to stop in the meantime.
+ */
+bool ReplayReceive::Pace(int64_t start_us, int64_t recorded_us) {
+  if (m_speed <= 0) {
+    // As fast as possible, but do not outrun the spoke process thread; dropped spokes
+    // would make the replay useless as a regression test.
+    SpokeQueue *queue = m_ri->m_spoke_queue;
+    while (!m_shutdown && queue && queue->GetCount() > queue->GetSlots() / 2) {
+      wxMilliSleep(1);
+    }
+    return !m_shutdown;
+  }
+
+  int64_t due = start_us + recorded_us / m_speed;
+  while (!m_shutdown) {
+    int64_t wait = due - wxGetUTCTimeUSec().GetValue();
+    if (wait <= 0) {
+      return true;
+    }
+    wxMicroSleep((unsigned long)wxMin(wait, (int64_t)MILLIS_PER_SELECT * 1000));
+  }
+  return false;
+}
+
+/*
+ * Replay the whole file once.
+ * Returns false if the thread should stop, either on request or because nothing could be replayed.
+ */
+bool ReplayReceive::ReplayFile() {
+  size_t offset = sizeof(RecordFileHeader);
+  int64_t start = wxGetUTCTimeUSec().GetValue();
+  int64_t first_time = 0;
+  uint64_t packets = 0;
+  uint64_t bytes = 0;
+
+  while (!m_shutdown && offset + sizeof(uint32_t) <= m_map_len) {
+    uint32_t magic;
+    memcpy(&magic, m_map + offset, sizeof(magic));
+
+    if (magic == RECORD_CHUNK_MAGIC) {
+      RecordChunkHeader chunk;
+      if (offset + sizeof(chunk) > m_map_len) {
+        break;
+      }
+      memcpy(&chunk, m_map + offset, sizeof(chunk));
+      size_t p = offset + sizeof(chunk);
+      size_t end = p + chunk.length;
+      if (end > m_map_len) {
+        break;  // File was not closed properly, the last chunk is incomplete
+      }
+      while (p + sizeof(RecordPacketHeader) <= end) {
+        RecordPacketHeader packet;
+        memcpy(&packet, m_map + p, sizeof(packet));
+        p += sizeof(packet);
+        if (p + packet.length > end) {
+          break;
+        }
+        if (packets == 0) {
+          first_time = packet.time_us;
+        }
+        if (!Pace(start, packet.time_us - first_time)) {
+          return false;
+        }
+        m_decoder->ProcessPacket((RecordSocketRole)packet.role, m_map + p, packet.length);
+        p += packet.length;
+        packets++;
+        bytes += packet.length;
+      }
+      offset = end;
+    } else if (magic == RECORD_INDEX_MAGIC) {
+      RecordIndexHeader index;
+      if (offset + sizeof(index) > m_map_len) {
+        break;
+      }
+      memcpy(&index, m_map + offset, sizeof(index));
+      offset += sizeof(index) + index.entries * sizeof(RecordIndexEntry);
+    } else {
+      break;  // RECORD_TRAILER_MAGIC or garbage, either way the end of the packets
+    }
+  }
+
+  if (m_shutdown) {
+    return false;
+  }
+
+  double seconds = (wxGetUTCTimeUSec().GetValue() - start) / 1e6;
+  double rate = seconds > 0. ? packets / seconds : 0.;
+  LOG_INFO(wxT("radar_pi: %s replayed %llu packets (%llu bytes) in %.3f s = %.0f packets/s"), m_ri->m_name.c_str(),
+           (unsigned long long)packets, (unsigned long long)bytes, seconds, rate);
+  SetInfoStatus(wxString::Format(wxT("%s: %s %.0f packets/s"), m_filename.c_str(), _("Replaying"), rate));
+
+  return packets > 0;
+}
+
+void *ReplayReceive::Entry(void) {
+  NetworkAddress replay(127, 0, 0, 1, 0);
+
+  LOG_VERBOSE(wxT("radar_pi: %s replay thread starting"), m_ri->m_name.c_str());
+
+  if (!m_decoder || !MapFile()) {
+    wxLogError(wxT("radar_pi: %s cannot replay %s"), m_ri->m_name.c_str(), m_filename.c_str());
+    SetInfoStatus(wxString::Format(wxT("%s: %s"), m_filename.c_str(), _("Cannot replay file")));
+    while (!m_shutdown) {
+      wxMilliSleep(MILLIS_PER_SELECT);
+    }
+    return 0;
+  }
+
+  m_ri->DetectedRadar(replay, replay);
+  SetInfoStatus(wxString::Format(wxT("%s: %s"), m_filename.c_str(), _("Replaying")));
+
+  while (ReplayFile()) {
+    // Loop until the thread is stopped
+  }
+  UnmapFile();
+
+  LOG_VERBOSE(wxT("radar_pi: %s replay thread stopping"), m_ri->m_name.c_str());
+  return 0;
+}
+
+void ReplayReceive::Shutdown() { m_shutdown = true; }
+
+wxString ReplayReceive::GetInfoStatus() {
+  wxCriticalSectionLocker lock(m_lock);
+  return m_status;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,97 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _REPLAYRECEIVE_H_
+#define _REPLAYRECEIVE_H_
+
+#include "RadarReceive.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Plays back a capture file written by PacketRecorder.
+//
+// The file is memory mapped and every recorded datagram is passed to the ProcessPacket()
+// method of a receive object of the recorded radar type, so the unmodified Navico or Garmin
+// ProcessFrame() and ProcessReport() produce the spokes. That receive object's own thread
+// is never started; all decoding happens on this thread.
+//
+// The replay speed comes from the ReplaySpeed setting:
+//   0 = as fast as the spoke process thread can keep up with; the spokes/s in the statistics
+//       are then the maximum sustainable rate of the spoke -> trails -> ARPA -> draw path,
+//   1 = real time,
+//   N = N times real time.
+// The file is replayed in a loop until the thread is stopped.
+//
+
+class ReplayReceive : public RadarReceive {
+ public:
+  ReplayReceive(radar_pi *pi, RadarInfo *ri);
+  ~ReplayReceive();
+
+  void *Entry(void);
+  void Shutdown(void);
+  wxString GetInfoStatus();
+
+  // Returns the radar type recorded in the header of 'filename', or RT_MAX if it is not a usable capture file.
+  static RadarType GetRecordedRadarType(const wxString &filename);
+
+ private:
+  bool MapFile();
+  void UnmapFile();
+  bool ReplayFile();
+  bool Pace(int64_t start_us, int64_t recorded_us);
+
+  RadarReceive *m_decoder;  // Receive object of the recorded radar type, not running
+  wxString m_filename;
+  int m_speed;
+  volatile bool m_shutdown;
+
+  const uint8_t *m_map;  // The whole capture file
+  size_t m_map_len;
+#ifdef __WXMSW__
+  HANDLE m_file_handle;
+  HANDLE m_map_handle;
+#endif
+
+  wxCriticalSection m_lock;  // Protects m_status
+  wxString m_status;         // Userfriendly string
+
+  void SetInfoStatus(wxString status) {
+    wxCriticalSectionLocker lock(m_lock);
+    m_status = status;
+  }
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _REPLAYRECEIVE_H_ */
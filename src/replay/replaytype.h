@@ -0,0 +1,39 @@
+#ifdef INITIALIZE_RADAR
+
+PLUGIN_BEGIN_NAMESPACE
+
+PLUGIN_END_NAMESPACE
+
+#endif
+
+#define RANGE_METRIC_RT_REPLAY \
+  { 1000, 4000 }
+#define RANGE_MIXED_RT_REPLAY \
+  { 1852 / 2, 1852 * 2 }
+#define RANGE_NAUTIC_RT_REPLAY \
+  { 1852 / 2, 1852 * 2 }
+
+// A replay takes the spokes, spoke length and ranges of the radar type that was
+// recorded (see RadarInfo::Init). These are only used when the capture file
+// cannot be read.
+#define REPLAY_SPOKES 2048
+#define REPLAY_MAX_SPOKE_LEN 1024
+
+#if SPOKES_MAX < REPLAY_SPOKES
+#undef SPOKES_MAX
+#define SPOKES_MAX REPLAY_SPOKES
+#endif
+#if SPOKE_LEN_MAX < REPLAY_MAX_SPOKE_LEN
+#undef SPOKE_LEN_MAX
+#define SPOKE_LEN_MAX REPLAY_MAX_SPOKE_LEN
+#endif
+
+DEFINE_RADAR(RT_REPLAY,              /* Type */
+             wxT("Replay"),          /* Name */
+             REPLAY_SPOKES,          /* Spokes */
+             REPLAY_MAX_SPOKE_LEN,   /* Spoke length */
+             EmulatorControlsDialog, /* Controls class */
+             ReplayReceive(pi, ri),  /* Receive class */
+             EmulatorControl,        /* Send/Control class */
+             RO_SINGLE               /* This type only has a single radar and does not need locating */
+)
@@ -190,6 +190,14 @@ SOCKET startUDPMulticastReceiveSocket(const NetworkAddress &interface_address, c
     goto fail;
   }
 
+#ifdef __linux__
+  // Optional: ask for the arrival time and kernel drop count of each datagram, see ReceiveBatch
+  if (setsockopt(rx_socket, SOL_SOCKET, SO_TIMESTAMPNS, (const char *)&one, sizeof(one)) ||
+      setsockopt(rx_socket, SOL_SOCKET, SO_RXQ_OVFL, (const char *)&one, sizeof(one))) {
+    wxLogMessage(wxT("radar_pi: kernel receive timestamps or drop counts not available"));
+  }
+#endif
+
   if (socketAddMembership(rx_socket, interface_address, mcast_address)) {
     error_message << _("Invalid IP address for UDP multicast");
     goto fail;
@@ -221,6 +229,120 @@ bool socketAddMembership(SOCKET socket, const NetworkAddress &interface_address,
   return false;
 }
 
+#ifdef __linux__
+// Room for one SCM_TIMESTAMPNS and one SO_RXQ_OVFL message
+#define RECEIVE_CONTROL_LEN (CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t)))
+#endif
+
+ReceiveBatch::ReceiveBatch(size_t packet_size, size_t packets) {
+  m_packet_size = packet_size;
+  m_packets = packets;
+  m_data = (uint8_t *)malloc(m_packet_size * m_packets);
+  m_length = (size_t *)calloc(sizeof(size_t), m_packets);
+  m_time = new wxLongLong[m_packets];
+  m_dropped = 0;
+#ifdef __linux__
+  m_use_recvmmsg = true;
+  m_msgs = (struct mmsghdr *)calloc(sizeof(struct mmsghdr), m_packets);
+  m_iov = (struct iovec *)calloc(sizeof(struct iovec), m_packets);
+  m_control = (uint8_t *)calloc(RECEIVE_CONTROL_LEN, m_packets);
+  m_socket = INVALID_SOCKET;
+  m_overflow = 0;
+  if (!m_msgs || !m_iov || !m_control) {
+    wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
+    wxAbort();
+  }
+  for (size_t i = 0; i < m_packets; i++) {
+    m_iov[i].iov_base = GetData(i);
+    m_iov[i].iov_len = m_packet_size;
+    m_msgs[i].msg_hdr.msg_iov = &m_iov[i];
+    m_msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+#endif
+  if (!m_data || !m_length) {
+    wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
+    wxAbort();
+  }
+}
+
+ReceiveBatch::~ReceiveBatch() {
+  free(m_data);
+  free(m_length);
+  delete[] m_time;
+#ifdef __linux__
+  free(m_msgs);
+  free(m_iov);
+  free(m_control);
+#endif
+}
+
+#ifdef __linux__
+void ReceiveBatch::ReadControl(int i) {
+  struct msghdr *msg = &m_msgs[i].msg_hdr;
+
+  m_time[i] = 0;
+  for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET) {
+      continue;
+    }
+    if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+      struct timespec ts;
+      memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+      m_time[i] = wxLongLong(ts.tv_sec) * MILLISECONDS_PER_SECOND + ts.tv_nsec / 1000000;
+    } else if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+      // Only present once the socket has dropped something
+      uint32_t overflow;
+      memcpy(&overflow, CMSG_DATA(cmsg), sizeof(overflow));
+      m_dropped += (int)(overflow - m_overflow);
+      m_overflow = overflow;
+    }
+  }
+}
+#endif
+
+int ReceiveBatch::Receive(SOCKET socket) {
+  int r;
+
+  m_dropped = 0;
+#ifdef __linux__
+  if (m_use_recvmmsg) {
+    if (socket != m_socket) {  // The drop counter starts at zero for every new socket
+      m_socket = socket;
+      m_overflow = 0;
+    }
+    for (size_t i = 0; i < m_packets; i++) {  // Set again every call, the kernel overwrites the length
+      m_msgs[i].msg_hdr.msg_control = m_control + i * RECEIVE_CONTROL_LEN;
+      m_msgs[i].msg_hdr.msg_controllen = RECEIVE_CONTROL_LEN;
+    }
+    // Don't wait; the caller's select() said at least one datagram is ready, take all that are.
+    r = recvmmsg(socket, m_msgs, m_packets, MSG_DONTWAIT, 0);
+    if (r >= 0) {
+      for (int i = 0; i < r; i++) {
+        m_length[i] = m_msgs[i].msg_len;
+        ReadControl(i);
+      }
+      return r;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 0;
+    }
+    if (errno != ENOSYS) {
+      return -1;
+    }
+    wxLogMessage(wxT("radar_pi: recvmmsg not supported, receiving one packet at a time"));
+    m_use_recvmmsg = false;
+  }
+#endif
+
+  r = recvfrom(socket, (char *)m_data, m_packet_size, 0, 0, 0);
+  if (r <= 0) {
+    return -1;
+  }
+  m_length[0] = (size_t)r;
+  m_time[0] = 0;
+  return 1;
+}
+
 SOCKET GetLocalhostServerTCPSocket() {
   SOCKET server = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
   struct sockaddr_in adr;
@@ -36,6 +36,10 @@
 #include <wx/tokenzr.h>
 #include "pi_common.h"
 
+#ifdef __linux__
+#include <sys/socket.h>  // recvmmsg
+#endif
+
 PLUGIN_BEGIN_NAMESPACE
 
 #define VALID_IPV4_ADDRESS(i)                                                                                                    \
@@ -168,6 +172,55 @@ extern SOCKET GetLocalhostServerTCPSocket();
 extern SOCKET GetLocalhostSendTCPSocket(SOCKET receive_socket);
 extern bool socketAddMembership(SOCKET socket, const NetworkAddress &interface_address, const NetworkAddress &mcast_address);
 
+//
+// A reusable pool of packet buffers that is filled with the datagrams pending on a socket.
+//
+// On Linux all pending datagrams (up to the pool size) are read with a single recvmmsg()
+// call. On other systems, or when the kernel does not support recvmmsg(), one datagram is
+// read per call with recvfrom() into the first buffer.
+//
+// With recvmmsg() it also collects what startUDPMulticastReceiveSocket() asked the kernel
+// to report: the time each datagram arrived (SO_TIMESTAMPNS) and how many datagrams the
+// kernel dropped because the socket's receive buffer was full (SO_RXQ_OVFL).
+//
+#define RECEIVE_BATCH_PACKETS (32)
+
+class ReceiveBatch {
+ public:
+  ReceiveBatch(size_t packet_size, size_t packets = RECEIVE_BATCH_PACKETS);
+  ~ReceiveBatch();
+
+  // Returns the number of datagrams received, 0 if none were pending, or -1 on error.
+  int Receive(SOCKET socket);
+
+  uint8_t *GetData(int i) { return m_data + i * m_packet_size; }
+  size_t GetLength(int i) { return m_length[i]; }
+
+  // Time the kernel received datagram 'i' in UTC millis, or 0 when unknown.
+  wxLongLong GetTime(int i) { return m_time[i]; }
+
+  // # of datagrams dropped by the kernel just before those returned by the last Receive().
+  int GetDropped() { return m_dropped; }
+
+ private:
+  size_t m_packet_size;
+  size_t m_packets;
+  uint8_t *m_data;
+  size_t *m_length;
+  wxLongLong *m_time;
+  int m_dropped;
+#ifdef __linux__
+  bool m_use_recvmmsg;
+  struct mmsghdr *m_msgs;
+  struct iovec *m_iov;
+  uint8_t *m_control;   // Ancillary data buffer for each message
+  SOCKET m_socket;      // Socket that m_overflow belongs to
+  uint32_t m_overflow;  // Last SO_RXQ_OVFL drop count seen, it is cumulative per socket
+
+  void ReadControl(int i);
+#endif
+};
+
 #ifndef __WXMSW__
 
 // Mac and Linux have ifaddrs.